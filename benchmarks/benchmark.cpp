@@ -0,0 +1,146 @@
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include "cppkafka/buffer.h"
+#include "cppkafka/message_builder.h"
+#include "cppkafka/utils/batch_partitioner.h"
+
+using std::string;
+using std::vector;
+using std::to_string;
+using std::cout;
+using std::endl;
+using std::setw;
+using std::atoi;
+
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+using cppkafka::Buffer;
+using cppkafka::MessageBuilder;
+using cppkafka::BatchPartitioner;
+
+// Microbenchmarks for the hot paths that don't need a broker. Besides printing timings, this
+// is the workload to run on a CPPKAFKA_PGO_MODE=GENERATE build
+
+namespace {
+
+const size_t KEY_COUNT = 1024;
+const int32_t PARTITION_COUNT = 24;
+
+// Keeps the compiler from optimizing away the benchmarked code
+volatile size_t sink;
+
+template <typename Functor>
+void run(const string& name, size_t iterations, size_t operations, const Functor& functor) {
+    // Warm up caches and branch predictors first
+    for (size_t i = 0; i < iterations / 10 + 1; ++i) {
+        functor();
+    }
+    const auto start = steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        functor();
+    }
+    const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    cout << std::left << setw(32) << name << std::right << setw(12) << std::fixed
+         << std::setprecision(2) << static_cast<double>(elapsed) / (iterations * operations)
+         << " ns/op" << endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    // The optional argument scales the number of iterations
+    const size_t scale = argc > 1 ? static_cast<size_t>(std::max(atoi(argv[1]), 1)) : 1;
+
+    vector<string> keys_data;
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        keys_data.push_back("user-" + to_string(i * 7919) + string(i % 16, 'x'));
+    }
+    vector<Buffer> keys;
+    for (const string& key : keys_data) {
+        keys.emplace_back(key);
+    }
+    const string topic = "benchmark_topic";
+    const string payload(512, 'p');
+
+    run("buffer construction", 2000 * scale, KEY_COUNT, [&] {
+        size_t total = 0;
+        for (const string& key : keys_data) {
+            const Buffer buffer(key);
+            total += buffer.get_size() + (buffer ? 1 : 0);
+        }
+        sink = total;
+    });
+    run("buffer comparison", 2000 * scale, KEY_COUNT, [&] {
+        size_t total = 0;
+        for (size_t i = 1; i < keys.size(); ++i) {
+            total += keys[i] == keys[i - 1] ? 1 : 0;
+            total += keys[i] != keys[i] ? 1 : 0;
+        }
+        sink = total;
+    });
+    run("buffer to string", 1000 * scale, KEY_COUNT, [&] {
+        size_t total = 0;
+        for (const Buffer& key : keys) {
+            total += static_cast<string>(key).size();
+        }
+        sink = total;
+    });
+
+    run("message builder", 500 * scale, KEY_COUNT, [&] {
+        size_t total = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            MessageBuilder builder(topic);
+            builder.partition(static_cast<int>(i % PARTITION_COUNT))
+                   .key(keys[i])
+                   .payload(payload);
+            total += builder.key().get_size() + builder.payload().get_size();
+        }
+        sink = total;
+    });
+    run("message builder with headers", 200 * scale, KEY_COUNT, [&] {
+        size_t total = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            MessageBuilder builder(topic);
+            builder.key(keys[i]).payload(payload).header("trace-id", keys_data[i]);
+            total += builder.headers().size();
+        }
+        sink = total;
+    });
+
+    vector<int32_t> partitions(KEY_COUNT);
+    for (auto algorithm : { BatchPartitioner::Algorithm::MURMUR2,
+                            BatchPartitioner::Algorithm::FNV1A,
+                            BatchPartitioner::Algorithm::CONSISTENT }) {
+        const BatchPartitioner partitioner(algorithm);
+        string name;
+        switch (algorithm) {
+            case BatchPartitioner::Algorithm::MURMUR2:
+                name = "murmur2";
+                break;
+            case BatchPartitioner::Algorithm::FNV1A:
+                name = "fnv1a";
+                break;
+            default:
+                name = "consistent";
+                break;
+        }
+        run("partition batch " + name, 2000 * scale, KEY_COUNT, [&] {
+            partitioner.partition(keys.data(), keys.size(), PARTITION_COUNT, partitions.data());
+            sink = static_cast<size_t>(partitions[KEY_COUNT / 2]);
+        });
+        run("partition single " + name, 2000 * scale, KEY_COUNT, [&] {
+            size_t total = 0;
+            for (const Buffer& key : keys) {
+                total += static_cast<size_t>(partitioner.partition(key, PARTITION_COUNT));
+            }
+            sink = total;
+        });
+    }
+}
@@ -0,0 +1,27 @@
+find_path(ZSTD_ROOT_DIR
+    NAMES include/zstd.h
+)
+
+find_path(ZSTD_INCLUDE_DIR
+    NAMES zstd.h zdict.h
+    HINTS ${ZSTD_ROOT_DIR}/include
+)
+
+set(HINT_DIR ${ZSTD_ROOT_DIR}/lib)
+
+find_library(ZSTD_LIBRARY
+    NAMES zstd libzstd
+    HINTS ${HINT_DIR}
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZSTD DEFAULT_MSG
+    ZSTD_LIBRARY
+    ZSTD_INCLUDE_DIR
+)
+
+mark_as_advanced(
+    ZSTD_ROOT_DIR
+    ZSTD_INCLUDE_DIR
+    ZSTD_LIBRARY
+)
@@ -0,0 +1,103 @@
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <csignal>
+#include <boost/program_options.hpp>
+#include "cppkafka/consumer.h"
+#include "cppkafka/configuration.h"
+#include "cppkafka/utils/dictionary_trainer.h"
+
+using std::string;
+using std::vector;
+using std::exception;
+using std::ofstream;
+using std::cout;
+using std::endl;
+
+using cppkafka::Consumer;
+using cppkafka::Configuration;
+using cppkafka::Message;
+using cppkafka::DictionaryTrainer;
+
+namespace po = boost::program_options;
+
+bool running = true;
+
+int main(int argc, char* argv[]) {
+    string brokers;
+    string topic_name;
+    string group_id;
+    string output_file;
+    size_t sample_count;
+    size_t dictionary_size;
+
+    po::options_description options("Options");
+    options.add_options()
+        ("help,h",     "produce this help message")
+        ("brokers,b",  po::value<string>(&brokers)->required(), 
+                       "the kafka broker list")
+        ("topic,t",    po::value<string>(&topic_name)->required(),
+                       "the topic to sample payloads from")
+        ("group-id,g", po::value<string>(&group_id)->required(),
+                       "the consumer group id")
+        ("output,o",   po::value<string>(&output_file)->required(),
+                       "the file the dictionary will be written to")
+        ("samples,s",  po::value<size_t>(&sample_count)->default_value(10000),
+                       "the number of payloads to sample")
+        ("size",       po::value<size_t>(&dictionary_size)->default_value(
+                            DictionaryTrainer::DEFAULT_DICTIONARY_SIZE),
+                       "the maximum dictionary size")
+        ;
+
+    po::variables_map vm;
+
+    try {
+        po::store(po::command_line_parser(argc, argv).options(options).run(), vm);
+        po::notify(vm);
+    }
+    catch (exception& ex) {
+        cout << "Error parsing options: " << ex.what() << endl;
+        cout << endl;
+        cout << options << endl;
+        return 1;
+    }
+
+    // Stop sampling on SIGINT
+    signal(SIGINT, [](int) { running = false; });
+
+    // Construct the configuration. Offsets are never committed, we're only taking a sample
+    Configuration config = {
+        { "metadata.broker.list", brokers },
+        { "group.id", group_id },
+        { "enable.auto.commit", false }
+    };
+
+    // Create the consumer and subscribe to the topic
+    Consumer consumer(config);
+    consumer.subscribe({ topic_name });
+
+    cout << "Sampling payloads from topic " << topic_name << endl;
+
+    // Read messages until we have enough samples
+    DictionaryTrainer trainer;
+    size_t payloads_seen = 0;
+    while (running && payloads_seen < sample_count) {
+        Message msg = consumer.poll();
+        if (msg && !msg.get_error()) {
+            trainer.add_sample(msg.get_payload());
+            payloads_seen++;
+        }
+    }
+
+    cout << "Training dictionary using " << trainer.get_sample_count() << " payloads" << endl;
+    try {
+        vector<uint8_t> dictionary = trainer.train(dictionary_size);
+        ofstream output(output_file, std::ios::binary);
+        output.write(reinterpret_cast<const char*>(dictionary.data()), dictionary.size());
+        cout << "Wrote " << dictionary.size() << " bytes dictionary to " << output_file << endl;
+    }
+    catch (exception& ex) {
+        cout << "Failed to train dictionary: " << ex.what() << endl;
+        return 1;
+    }
+}
@@ -111,27 +111,37 @@ public:
     /**
      * Getter for the data pointer
      */
-    const DataType* get_data() const;
+    const DataType* get_data() const {
+        return data_;
+    }
 
     /**
      * Getter for the size of the buffer
      */
-    size_t get_size() const;
+    size_t get_size() const {
+        return size_;
+    }
 
     /**
      * Gets an iterator to the beginning of this buffer
      */
-    const_iterator begin() const;
+    const_iterator begin() const {
+        return data_;
+    }
 
     /**
      * Gets an iterator to the end of this buffer
      */
-    const_iterator end() const;
+    const_iterator end() const {
+        return data_ + size_;
+    }
 
     /**
      * Checks whether this is a non empty buffer
      */
-    explicit operator bool() const;
+    explicit operator bool() const {
+        return size_ != 0;
+    }
 
     /**
      * Converts the contents of the buffer into a string
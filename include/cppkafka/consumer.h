@@ -36,6 +36,7 @@
 #include <functional>
 #include "kafka_handle_base.h"
 #include "message.h"
+#include "queue.h"
 #include "macros.h"
 #include "error.h"
 
@@ -147,6 +148,10 @@ public:
      * anything like that. That's handled automatically by cppkafka. This is just a notifitation
      * so your application code can react to revocations
      *
+     * \note When using the cooperative rebalance protocol (e.g. partition.assignment.strategy
+     * set to cooperative-sticky), both the assignment and revocation callbacks only receive
+     * the partitions being added or removed, and the rest of the assignment is left untouched.
+     *
      * \param callback The topic/partition revocation callback
      */
     void set_revocation_callback(RevocationCallback callback);
@@ -193,6 +198,51 @@ public:
      */ 
     void unassign();
 
+#if RD_KAFKA_VERSION >= 0x010600ff
+    /**
+     * \brief Adds the given topic/partitions to the current assignment
+     *
+     * This translates into a call to rd_kafka_incremental_assign and is meant to be used
+     * along with the cooperative rebalance protocol.
+     *
+     * \param topic_partitions The topic/partitions to be added
+     */
+    void incremental_assign(const TopicPartitionList& topic_partitions);
+
+    /**
+     * \brief Removes the given topic/partitions from the current assignment
+     *
+     * This translates into a call to rd_kafka_incremental_unassign and is meant to be used
+     * along with the cooperative rebalance protocol.
+     *
+     * \param topic_partitions The topic/partitions to be removed
+     */
+    void incremental_unassign(const TopicPartitionList& topic_partitions);
+
+    /**
+     * \brief Gets the rebalance protocol currently in use
+     *
+     * This translates into a call to rd_kafka_rebalance_protocol. The returned value is
+     * either "NONE", "EAGER" or "COOPERATIVE".
+     */
+    std::string get_rebalance_protocol() const;
+
+    /**
+     * Indicates whether the cooperative rebalance protocol is being used
+     */
+    bool is_cooperative() const;
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+
+    /**
+     * \brief Seeks the given topic/partition to its offset
+     *
+     * The topic/partition must be currently assigned. This translates into a call to
+     * rd_kafka_seek, using the timeout configured via Consumer::set_timeout.
+     *
+     * \param topic_partition The topic/partition, including the offset to seek to
+     */
+    void seek(const TopicPartition& topic_partition);
+
     /**
      * \brief Commits the given message synchronously
      *
@@ -324,6 +374,26 @@ public:
      * \param timeout The timeout to be used on this call
      */
     Message poll(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Gets the consumer queue
+     *
+     * This is the queue Consumer::poll consumes from. Every assigned partition's queue is
+     * forwarded to it unless its forwarding is changed.
+     *
+     * This translates into a call to rd_kafka_queue_get_consumer
+     */
+    Queue get_consumer_queue() const;
+
+    /**
+     * \brief Gets the queue for a specific partition
+     *
+     * This translates into a call to rd_kafka_queue_get_partition. Forwarding this queue to
+     * a different one allows consuming this partition's messages separately.
+     *
+     * \param topic_partition The topic/partition
+     */
+    Queue get_partition_queue(const TopicPartition& topic_partition) const;
 private:
     static void rebalance_proxy(rd_kafka_t *handle, rd_kafka_resp_err_t error,
                                 rd_kafka_topic_partition_list_t *partitions, void *opaque);
@@ -332,6 +402,12 @@ private:
     void commit(const Message& msg, bool async);
     void commit(const TopicPartitionList& topic_partitions, bool async);
     void handle_rebalance(rd_kafka_resp_err_t err, TopicPartitionList& topic_partitions);
+#if RD_KAFKA_VERSION >= 0x010600ff
+    void handle_incremental_rebalance(rd_kafka_resp_err_t err,
+                                      TopicPartitionList& topic_partitions);
+    void check_error(rd_kafka_error_t* error) const;
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+    using KafkaHandleBase::check_error;
 
     AssignmentCallback assignment_callback_;
     RevocationCallback revocation_callback_;
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_CHUNK_HEADER_H
+#define CPPKAFKA_CHUNK_HEADER_H
+
+#include <cstdint>
+#include <cstring>
+#include "endianness.h"
+
+namespace cppkafka {
+namespace detail {
+
+/**
+ * \brief Header prepended to the payload of every chunk produced by a ChunkedProducer
+ *
+ * All fields are encoded in big endian order.
+ */
+struct ChunkHeader {
+    static constexpr uint16_t MAGIC = 0xCC4B;
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t SIZE = 36;
+
+    uint64_t group_id;
+    uint32_t index;
+    uint32_t count;
+    uint64_t total_size;
+    uint64_t data_offset;
+
+    void encode(uint8_t* output) const {
+        const uint16_t magic = htobe16(MAGIC);
+        const uint64_t group = htobe64(group_id);
+        const uint32_t chunk_index = htobe32(index);
+        const uint32_t chunk_count = htobe32(count);
+        const uint64_t size = htobe64(total_size);
+        const uint64_t offset = htobe64(data_offset);
+        memcpy(output, &magic, 2);
+        output[2] = VERSION;
+        output[3] = 0;
+        memcpy(output + 4, &group, 8);
+        memcpy(output + 12, &chunk_index, 4);
+        memcpy(output + 16, &chunk_count, 4);
+        memcpy(output + 20, &size, 8);
+        memcpy(output + 28, &offset, 8);
+    }
+
+    bool decode(const uint8_t* input, size_t input_size) {
+        uint16_t magic;
+        if (input_size < SIZE) {
+            return false;
+        }
+        memcpy(&magic, input, 2);
+        if (be16toh(magic) != MAGIC || input[2] != VERSION) {
+            return false;
+        }
+        memcpy(&group_id, input + 4, 8);
+        memcpy(&index, input + 12, 4);
+        memcpy(&count, input + 16, 4);
+        memcpy(&total_size, input + 20, 8);
+        memcpy(&data_offset, input + 28, 8);
+        group_id = be64toh(group_id);
+        index = be32toh(index);
+        count = be32toh(count);
+        total_size = be64toh(total_size);
+        data_offset = be64toh(data_offset);
+        // Make sure the chunk is consistent with the rest of the group
+        const uint64_t data_size = input_size - SIZE;
+        return count > 0 && index < count && data_offset <= total_size &&
+               data_size <= total_size - data_offset;
+    }
+};
+
+} // detail
+} // cppkafka
+
+#endif // CPPKAFKA_CHUNK_HEADER_H
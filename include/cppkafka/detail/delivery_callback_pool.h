@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_DELIVERY_CALLBACK_POOL_H
+#define CPPKAFKA_DELIVERY_CALLBACK_POOL_H
+
+#include <memory>
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include "../message.h"
+
+namespace cppkafka {
+namespace detail {
+
+/**
+ * \brief Pool of slots holding per message delivery callbacks
+ *
+ * Slots are allocated in chunks and recycled through a free list, and callables that fit
+ * in a slot's storage are constructed in place, so attaching a callback to a message doesn't
+ * allocate once the pool is warm. A slot's address is used as the message's opaque pointer,
+ * which is how the delivery report proxy finds it.
+ *
+ * Chunks are never freed nor moved until the pool is destroyed and each one is twice as
+ * large as the previous one, so finding a slot only requires checking a few address ranges
+ * and doesn't take any locks.
+ */
+class DeliveryCallbackPool {
+public:
+    static constexpr size_t STORAGE_SIZE = 64;
+    static constexpr size_t INITIAL_CHUNK_SIZE = 256;
+    static constexpr size_t MAX_CHUNKS = 32;
+
+    struct Slot {
+        using Storage = typename std::aligned_storage<STORAGE_SIZE>::type;
+
+        Storage storage;
+        void (*invoke)(Slot&, const Message&);
+        void (*destroy)(Slot&);
+        void* user_data;
+        Slot* next;
+    };
+
+    DeliveryCallbackPool() = default;
+    DeliveryCallbackPool(const DeliveryCallbackPool&) = delete;
+    DeliveryCallbackPool& operator=(const DeliveryCallbackPool&) = delete;
+
+    ~DeliveryCallbackPool() {
+        // Release the captures of any callbacks whose delivery report never arrived
+        const size_t chunk_count = chunk_count_.load();
+        for (size_t i = 0; i < chunk_count; ++i) {
+            for (size_t j = 0; j < chunks_[i].size; ++j) {
+                Slot& slot = chunks_[i].slots[j];
+                if (slot.destroy) {
+                    slot.destroy(slot);
+                }
+            }
+        }
+    }
+
+    template <typename Functor>
+    Slot* acquire(Functor&& callback, void* user_data) {
+        using CallbackType = typename std::decay<Functor>::type;
+        Slot* slot = take_slot();
+        construct(*slot, std::forward<Functor>(callback),
+                  std::integral_constant<bool, fits_in_slot<CallbackType>()>());
+        slot->user_data = user_data;
+        return slot;
+    }
+
+    // Finds the slot an opaque pointer refers to, if any
+    Slot* find(void* opaque) const {
+        const size_t chunk_count = chunk_count_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < chunk_count; ++i) {
+            const Slot* first = chunks_[i].slots.get();
+            if (opaque >= static_cast<const void*>(first) &&
+                opaque < static_cast<const void*>(first + chunks_[i].size)) {
+                return static_cast<Slot*>(opaque);
+            }
+        }
+        return nullptr;
+    }
+
+    void run(Slot* slot, const Message& message) {
+        try {
+            slot->invoke(*slot, message);
+        }
+        catch (...) {
+            release(slot);
+            throw;
+        }
+        release(slot);
+    }
+
+    void release(Slot* slot) {
+        slot->destroy(*slot);
+        slot->destroy = nullptr;
+        std::lock_guard<std::mutex> _(mutex_);
+        slot->next = free_slots_;
+        free_slots_ = slot;
+    }
+private:
+    template <typename T>
+    static constexpr bool fits_in_slot() {
+        return sizeof(T) <= STORAGE_SIZE &&
+               alignof(T) <= alignof(typename Slot::Storage) &&
+               std::is_nothrow_move_constructible<T>::value;
+    }
+
+    // The callable is stored inside the slot
+    template <typename Functor>
+    static void construct(Slot& slot, Functor&& callback, std::true_type) {
+        using CallbackType = typename std::decay<Functor>::type;
+        new (&slot.storage) CallbackType(std::forward<Functor>(callback));
+        slot.invoke = [](Slot& self, const Message& message) {
+            (*reinterpret_cast<CallbackType*>(&self.storage))(message);
+        };
+        slot.destroy = [](Slot& self) {
+            reinterpret_cast<CallbackType*>(&self.storage)->~CallbackType();
+        };
+    }
+
+    // The callable is too large, so only a pointer to it is stored inside the slot
+    template <typename Functor>
+    static void construct(Slot& slot, Functor&& callback, std::false_type) {
+        using CallbackType = typename std::decay<Functor>::type;
+        CallbackType* ptr = new CallbackType(std::forward<Functor>(callback));
+        new (&slot.storage) CallbackType*(ptr);
+        slot.invoke = [](Slot& self, const Message& message) {
+            (**reinterpret_cast<CallbackType**>(&self.storage))(message);
+        };
+        slot.destroy = [](Slot& self) {
+            delete *reinterpret_cast<CallbackType**>(&self.storage);
+        };
+    }
+
+    Slot* take_slot() {
+        std::lock_guard<std::mutex> _(mutex_);
+        if (!free_slots_) {
+            add_chunk();
+        }
+        Slot* slot = free_slots_;
+        free_slots_ = slot->next;
+        return slot;
+    }
+
+    void add_chunk() {
+        const size_t chunk_count = chunk_count_.load(std::memory_order_relaxed);
+        if (chunk_count == MAX_CHUNKS) {
+            throw std::bad_alloc();
+        }
+        Chunk& chunk = chunks_[chunk_count];
+        chunk.size = INITIAL_CHUNK_SIZE << chunk_count;
+        chunk.slots.reset(new Slot[chunk.size]());
+        for (size_t i = 0; i + 1 < chunk.size; ++i) {
+            chunk.slots[i].next = &chunk.slots[i + 1];
+        }
+        free_slots_ = chunk.slots.get();
+        // Publish it only once it's fully built, as find doesn't take the lock
+        chunk_count_.store(chunk_count + 1, std::memory_order_release);
+    }
+
+    struct Chunk {
+        std::unique_ptr<Slot[]> slots;
+        size_t size{0};
+    };
+
+    Chunk chunks_[MAX_CHUNKS];
+    std::atomic<size_t> chunk_count_{0};
+    Slot* free_slots_{nullptr};
+    std::mutex mutex_;
+};
+
+} // detail
+} // cppkafka
+
+#endif // CPPKAFKA_DELIVERY_CALLBACK_POOL_H
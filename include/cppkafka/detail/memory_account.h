@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_MEMORY_ACCOUNT_H
+#define CPPKAFKA_MEMORY_ACCOUNT_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+namespace cppkafka {
+namespace detail {
+
+/**
+ * \brief Number of bytes held by the messages charged to it
+ *
+ * Accounts can have a parent account that every charge is also applied to, which is how the
+ * process wide usage is kept up to date by every MemoryGovernor's account.
+ */
+class MemoryAccount {
+public:
+    MemoryAccount(std::shared_ptr<MemoryAccount> parent = nullptr)
+    : parent_(std::move(parent)) {
+
+    }
+
+    void charge(size_t size) {
+        usage_ += size;
+        if (parent_) {
+            parent_->charge(size);
+        }
+    }
+
+    void release(size_t size) {
+        usage_ -= size;
+        if (parent_) {
+            parent_->release(size);
+        }
+    }
+
+    size_t get_usage() const {
+        return usage_;
+    }
+private:
+    std::shared_ptr<MemoryAccount> parent_;
+    std::atomic<size_t> usage_{0};
+};
+
+/**
+ * \brief Movable handle to the bytes a Message charged to an account
+ *
+ * The bytes are released when the lease is destroyed or assigned to, so a Message that holds
+ * one gives back its bytes as soon as it's destroyed. The lease keeps the account alive, so
+ * messages can safely outlive the MemoryGovernor that tracked them.
+ */
+class MemoryLease {
+public:
+    MemoryLease() = default;
+
+    MemoryLease(std::shared_ptr<MemoryAccount> account, size_t size)
+    : account_(std::move(account)), size_(size) {
+        account_->charge(size_);
+    }
+
+    MemoryLease(const MemoryLease&) = delete;
+    MemoryLease& operator=(const MemoryLease&) = delete;
+
+    MemoryLease(MemoryLease&& rhs) noexcept
+    : account_(std::move(rhs.account_)), size_(rhs.size_) {
+        rhs.size_ = 0;
+    }
+
+    MemoryLease& operator=(MemoryLease&& rhs) noexcept {
+        if (this != &rhs) {
+            reset();
+            account_ = std::move(rhs.account_);
+            size_ = rhs.size_;
+            rhs.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~MemoryLease() {
+        reset();
+    }
+
+    void reset() {
+        if (account_) {
+            account_->release(size_);
+            account_.reset();
+        }
+        size_ = 0;
+    }
+private:
+    std::shared_ptr<MemoryAccount> account_;
+    size_t size_{0};
+};
+
+} // detail
+} // cppkafka
+
+#endif // CPPKAFKA_MEMORY_ACCOUNT_H
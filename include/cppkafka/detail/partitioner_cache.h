@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_PARTITIONER_CACHE_H
+#define CPPKAFKA_PARTITIONER_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace cppkafka {
+namespace detail {
+
+/**
+ * \brief Bounded cache of the partitions computed for topic/key pairs
+ *
+ * This is a direct mapped cache: every topic/key pair can only live in the slot given by
+ * its hash, so a lookup is a single hash plus a comparison and inserting simply overwrites
+ * whatever was in that slot. Every entry remembers the partition count it was computed
+ * for, so entries become stale as soon as the topic's partition count changes.
+ *
+ * This is used by TopicConfiguration's partitioner callback proxy and can be called from
+ * any of rdkafka's threads, hence the mutex.
+ */
+class PartitionerCache {
+public:
+    PartitionerCache(size_t size)
+    : entries_(size) {
+
+    }
+
+    bool find(const char* topic, const char* key, size_t key_size, int32_t partition_count,
+              int32_t& partition) {
+        std::lock_guard<std::mutex> _(mutex_);
+        const Entry& entry = entries_[get_index(key, key_size)];
+        if (entry.partition_count != partition_count || entry.key.size() != key_size ||
+            entry.key.compare(0, key_size, key, key_size) != 0 || entry.topic != topic) {
+            return false;
+        }
+        partition = entry.partition;
+        return true;
+    }
+
+    void store(const char* topic, const char* key, size_t key_size, int32_t partition_count,
+               int32_t partition) {
+        std::lock_guard<std::mutex> _(mutex_);
+        Entry& entry = entries_[get_index(key, key_size)];
+        entry.topic = topic;
+        entry.key.assign(key, key_size);
+        entry.partition_count = partition_count;
+        entry.partition = partition;
+    }
+
+    size_t get_size() const {
+        return entries_.size();
+    }
+private:
+    struct Entry {
+        std::string topic;
+        std::string key;
+        int32_t partition_count{0};
+        int32_t partition{0};
+    };
+
+    size_t get_index(const char* key, size_t key_size) const {
+        // FNV-1a over the key's bytes
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < key_size; ++i) {
+            hash = (hash ^ static_cast<uint8_t>(key[i])) * 1099511628211ULL;
+        }
+        return hash % entries_.size();
+    }
+
+    std::vector<Entry> entries_;
+    std::mutex mutex_;
+};
+
+} // detail
+} // cppkafka
+
+#endif // CPPKAFKA_PARTITIONER_CACHE_H
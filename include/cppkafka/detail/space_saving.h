@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_SPACE_SAVING_H
+#define CPPKAFKA_SPACE_SAVING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+namespace cppkafka {
+namespace detail {
+
+/**
+ * \brief Space-saving summary of the most frequent keys in a stream
+ *
+ * At most capacity keys are monitored. Once full, a key that isn't being monitored replaces
+ * the one with the lowest count and inherits that count as its error, so every count is an
+ * upper bound of the key's real frequency and count - error is a lower bound. Any key whose
+ * frequency is above total / capacity is guaranteed to be monitored.
+ *
+ * Counters are kept in a min heap so finding the one to replace is constant time and
+ * updating a key is logarithmic in the capacity.
+ */
+class SpaceSaving {
+public:
+    struct Counter {
+        std::string key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    SpaceSaving(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+        counters_.reserve(capacity_);
+    }
+
+    void add(const char* data, size_t size, uint64_t weight = 1) {
+        // Reuse the lookup key's storage to avoid allocating on every call
+        lookup_key_.assign(data, size);
+        auto iter = positions_.find(lookup_key_);
+        if (iter != positions_.end()) {
+            counters_[iter->second].count += weight;
+            sift_down(iter->second);
+        }
+        else if (counters_.size() < capacity_) {
+            counters_.push_back(Counter{ lookup_key_, weight, 0 });
+            positions_.emplace(lookup_key_, counters_.size() - 1);
+            sift_up(counters_.size() - 1);
+        }
+        else {
+            Counter& counter = counters_.front();
+            positions_.erase(counter.key);
+            counter.key = lookup_key_;
+            counter.error = counter.count;
+            counter.count += weight;
+            positions_.emplace(lookup_key_, 0);
+            sift_down(0);
+        }
+    }
+
+    // Gets the monitored keys, sorted by decreasing count
+    std::vector<Counter> get_top(size_t count) const {
+        std::vector<Counter> output = counters_;
+        std::sort(output.begin(), output.end(), [](const Counter& lhs, const Counter& rhs) {
+            return lhs.count > rhs.count;
+        });
+        if (output.size() > count) {
+            output.resize(count);
+        }
+        return output;
+    }
+
+    void clear() {
+        counters_.clear();
+        positions_.clear();
+    }
+private:
+    void sift_up(size_t index) {
+        while (index > 0) {
+            const size_t parent = (index - 1) / 2;
+            if (counters_[parent].count <= counters_[index].count) {
+                break;
+            }
+            swap_counters(parent, index);
+            index = parent;
+        }
+    }
+
+    void sift_down(size_t index) {
+        while (true) {
+            const size_t left = 2 * index + 1;
+            const size_t right = left + 1;
+            size_t smallest = index;
+            if (left < counters_.size() && counters_[left].count < counters_[smallest].count) {
+                smallest = left;
+            }
+            if (right < counters_.size() && counters_[right].count < counters_[smallest].count) {
+                smallest = right;
+            }
+            if (smallest == index) {
+                break;
+            }
+            swap_counters(smallest, index);
+            index = smallest;
+        }
+    }
+
+    void swap_counters(size_t lhs, size_t rhs) {
+        std::swap(counters_[lhs], counters_[rhs]);
+        positions_[counters_[lhs].key] = lhs;
+        positions_[counters_[rhs].key] = rhs;
+    }
+
+    std::vector<Counter> counters_;
+    std::unordered_map<std::string, size_t> positions_;
+    std::string lookup_key_;
+    size_t capacity_;
+};
+
+} // detail
+} // cppkafka
+
+#endif // CPPKAFKA_SPACE_SAVING_H
@@ -122,6 +122,14 @@ private:
     Error error_;
 };
 
+/**
+ * Indicates an operation was rejected because a circuit breaker is open
+ */
+class CPPKAFKA_API CircuitOpenException : public Exception {
+public:
+    CircuitOpenException();
+};
+
 } // cppkafka
 
 #endif // CPPKAFKA_EXCEPTIONS_H
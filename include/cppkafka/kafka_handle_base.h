@@ -35,7 +35,9 @@
 #include <chrono>
 #include <unordered_map>
 #include <map>
+#include <vector>
 #include <mutex>
+#include <atomic>
 #include <tuple>
 #include <chrono>
 #include <librdkafka/rdkafka.h>
@@ -117,22 +119,30 @@ public:
     rd_kafka_t* get_handle() const;
 
     /**
-     * \brief Creates a topic handle
+     * \brief Gets a topic handle
      *
-     * This translates into a call to rd_kafka_topic_new. This will use the default topic 
-     * configuration provided in the Configuration object for this consumer/producer handle, 
-     * if any.
+     * The first time a topic is requested, this translates into a call to rd_kafka_topic_new.
+     * This will use the default topic configuration provided in the Configuration object for
+     * this consumer/producer handle, if any.
      *
-     * \param name The name of the topic to be created 
+     * Topic handles are cached and owned by this object, so the returned Topic doesn't own
+     * its handle and can't outlive this object. Looking up a cached handle doesn't take any
+     * locks, so this can be called on every produce/request without much overhead.
+     *
+     * \param name The name of the topic
      */
     Topic get_topic(const std::string& name);
 
     /**
-     * \brief Creates a topic handle
+     * \brief Gets a topic handle
+     *
+     * The first time a topic is requested, this translates into a call to rd_kafka_topic_new
+     * using the given configuration. As with rdkafka, the configuration is ignored if the topic
+     * handle had already been created.
      *
-     * This translates into a call to rd_kafka_topic_new.
+     * \sa KafkaHandleBase::get_topic(const std::string&)
      *
-     * \param name The name of the topic to be created 
+     * \param name The name of the topic
      * \param config The configuration to be used for the new topic
      */
     Topic get_topic(const std::string& name, TopicConfiguration config);
@@ -210,18 +220,32 @@ private:
     static const std::chrono::milliseconds DEFAULT_TIMEOUT;
 
     using HandlePtr = std::unique_ptr<rd_kafka_t, decltype(&rd_kafka_destroy)>;
+    using TopicHandlePtr = std::unique_ptr<rd_kafka_topic_t, decltype(&rd_kafka_topic_destroy)>;
     using TopicConfigurationMap = std::unordered_map<std::string, TopicConfiguration>;
+    using TopicHandleMap = std::unordered_map<std::string, rd_kafka_topic_t*>;
+    using TopicHandleMapPtr = std::unique_ptr<const TopicHandleMap>;
 
     Topic get_topic(const std::string& name, rd_kafka_topic_conf_t* conf);
+    rd_kafka_topic_t* find_topic_handle(const std::string& name) const;
+    void publish_topic_handle(const std::string& name, rd_kafka_topic_t* handle);
     Metadata get_metadata(bool all_topics, rd_kafka_topic_t* topic_ptr) const;
     std::vector<GroupInformation> fetch_consumer_groups(const char* name);
-    void save_topic_config(const std::string& topic_name, TopicConfiguration config);
+    const TopicConfiguration& save_topic_config(const std::string& topic_name,
+                                                TopicConfiguration config);
 
     HandlePtr handle_;
     std::chrono::milliseconds timeout_ms_;
     Configuration config_;
     TopicConfigurationMap topic_configurations_;
     std::mutex topic_configurations_mutex_;
+    // Topic handles are kept in an immutable map which is replaced whenever a topic is added,
+    // so lookups can just read the current one. Replaced maps are only freed once there's no
+    // one reading them. These must be destroyed before the rdkafka handle
+    std::vector<TopicHandlePtr> topic_handles_;
+    TopicHandleMapPtr topic_handle_map_;
+    std::vector<TopicHandleMapPtr> retired_topic_handle_maps_;
+    std::atomic<const TopicHandleMap*> current_topic_handle_map_{nullptr};
+    mutable std::atomic<size_t> topic_handle_readers_{0};
 };
 
 } // cppkafka
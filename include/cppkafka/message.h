@@ -38,10 +38,12 @@
 #include "buffer.h"
 #include "macros.h"
 #include "error.h"
+#include "detail/memory_account.h"
 
 namespace cppkafka {
 
 class MessageTimestamp;
+class MemoryGovernor;
 
 /**
  * \brief Thin wrapper over a rdkafka message handle
@@ -138,6 +140,18 @@ public:
         return handle_->_private;
     }
 
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    /**
+     * \brief Gets the value of the last header with the given name
+     *
+     * If the message has no such header, an empty buffer is returned. The returned buffer
+     * points into this message, so it's only valid while the message is alive.
+     *
+     * \param name The header's name
+     */
+    Buffer get_header(const std::string& name) const;
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
     /**
      * \brief Gets this Message's timestamp
      *
@@ -159,6 +173,8 @@ public:
         return handle_.get();
     }
 private:
+    friend class MemoryGovernor;
+
     using HandlePtr = std::unique_ptr<rd_kafka_message_t, decltype(&rd_kafka_message_destroy)>;
 
     struct NonOwningTag { };
@@ -166,6 +182,8 @@ private:
     Message(rd_kafka_message_t* handle, NonOwningTag);
     Message(HandlePtr handle);
 
+    // Declared first so the bytes are only given back after the handle is destroyed
+    detail::MemoryLease lease_;
     HandlePtr handle_;
     Buffer payload_;
     Buffer key_;
@@ -31,6 +31,9 @@
 #define CPPKAFKA_MESSAGE_BUILDER_H
 
 #include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
 #include "buffer.h"
 #include "topic.h"
 #include "macros.h"
@@ -43,6 +46,11 @@ namespace cppkafka {
 template <typename BufferType, typename Concrete>
 class CPPKAFKA_API BasicMessageBuilder {
 public:
+    /**
+     * The type used to store the message's headers as name/value pairs
+     */
+    using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
     /**
      * Construct a BasicMessageBuilder
      *
@@ -121,6 +129,17 @@ public:
      */
     Concrete& user_data(void* value);
 
+    /**
+     * \brief Adds a header to the message
+     *
+     * Headers are copied into the builder. Note that headers require rdkafka >= 0.11.4 and
+     * are ignored when producing otherwise.
+     *
+     * \param name The header's name
+     * \param value The header's value
+     */
+    Concrete& header(std::string name, std::string value);
+
     /**
      * Gets the topic this message will be produced into
      */
@@ -160,6 +179,16 @@ public:
      * Gets the message's user data pointer
      */
     void* user_data() const;
+
+    /**
+     * Gets the message's headers
+     */
+    const HeaderList& headers() const;
+
+    /**
+     * Gets the message's headers
+     */
+    HeaderList& headers();
 private:
     void construct_buffer(BufferType& lhs, const BufferType& rhs);
     Concrete& get_concrete();
@@ -169,7 +198,8 @@ private:
     BufferType key_;
     BufferType payload_;
     std::chrono::milliseconds timestamp_{0};
-    void* user_data_;
+    void* user_data_{nullptr};
+    HeaderList headers_;
 };
 
 template <typename T, typename C>
@@ -181,7 +211,7 @@ template <typename T, typename C>
 template <typename U, typename V>
 BasicMessageBuilder<T, C>::BasicMessageBuilder(const BasicMessageBuilder<U, V>& rhs)
 : topic_(rhs.topic()), partition_(rhs.partition()), timestamp_(rhs.timestamp()),
-  user_data_(rhs.user_data()) {
+  user_data_(rhs.user_data()), headers_(rhs.headers()) {
     get_concrete().construct_buffer(key_, rhs.key());
     get_concrete().construct_buffer(payload_, rhs.payload());
 }
@@ -234,6 +264,12 @@ C& BasicMessageBuilder<T, C>::user_data(void* value) {
     return get_concrete();
 }
 
+template <typename T, typename C>
+C& BasicMessageBuilder<T, C>::header(std::string name, std::string value) {
+    headers_.emplace_back(std::move(name), std::move(value));
+    return get_concrete();
+}
+
 template <typename T, typename C>
 const std::string& BasicMessageBuilder<T, C>::topic() const {
     return topic_;
@@ -274,6 +310,17 @@ void* BasicMessageBuilder<T, C>::user_data() const {
     return user_data_;
 }
 
+template <typename T, typename C>
+const typename BasicMessageBuilder<T, C>::HeaderList&
+BasicMessageBuilder<T, C>::headers() const {
+    return headers_;
+}
+
+template <typename T, typename C>
+typename BasicMessageBuilder<T, C>::HeaderList& BasicMessageBuilder<T, C>::headers() {
+    return headers_;
+}
+
 template <typename T, typename C>
 void BasicMessageBuilder<T, C>::construct_buffer(T& lhs, const T& rhs) {
     lhs = rhs;
@@ -37,6 +37,8 @@
 #include "topic.h"
 #include "macros.h"
 #include "message_builder.h"
+#include "exceptions.h"
+#include "detail/delivery_callback_pool.h"
 
 namespace cppkafka {
 
@@ -52,6 +54,15 @@ class TopicConfiguration;
  * By default the payloads will be copied (using the RD_KAFKA_MSG_F_COPY flag) but the 
  * behavior can be changed, in which case rdkafka will be reponsible for freeing it.
  *
+ * When using PayloadPolicy::PASSTHROUGH_PAYLOAD, rdkafka will neither copy nor free the
+ * payload. In this case the caller *must* keep the payload alive until the delivery report
+ * for that message is received.
+ *
+ * Delivery reports are only requested from rdkafka when a delivery report callback is set in
+ * the configuration. In that case the producer has to be polled periodically (or flushed):
+ * until their delivery report is served, delivered messages count against
+ * queue.buffering.max.messages and producing eventually fails with a queue full error.
+ *
  * In order to produce messages you could do something like:
  *
  * \code
@@ -81,6 +92,7 @@ public:
      * The policy to use for the payload. The default policy is COPY_PAYLOAD
      */
     enum class PayloadPolicy {
+        PASSTHROUGH_PAYLOAD = 0,            ///< Means no copy and no free
         COPY_PAYLOAD = RD_KAFKA_MSG_F_COPY, ///< Means RD_KAFKA_MSG_F_COPY
         FREE_PAYLOAD = RD_KAFKA_MSG_F_FREE  ///< Means RD_KAFKA_MSG_F_FREE
     };
@@ -113,6 +125,33 @@ public:
      */
     void produce(const MessageBuilder& builder);
 
+    /**
+     * \brief Produces a message and attaches a callback to it
+     *
+     * The callback will be executed with the message once its delivery report is received,
+     * right before the delivery report callback set in the configuration. It's executed only
+     * once and then destroyed.
+     *
+     * Delivery reports are only enabled if the configuration used to construct the producer
+     * has a delivery report callback, so an Exception is thrown otherwise. Note that delivery
+     * reports are served when calling Producer::poll or Producer::flush, so the producer
+     * has to be polled for the callback to be executed.
+     *
+     * Callbacks are kept in a pool of preallocated slots, and callables that are no larger
+     * than detail::DeliveryCallbackPool::STORAGE_SIZE bytes (e.g. lambdas capturing a few
+     * pointers) are stored inside the slot itself, so this doesn't allocate memory once the
+     * pool is warm. Larger callables are moved into a heap allocated object.
+     *
+     * The builder's user data pointer is preserved, so Message::get_private_data will still
+     * return it inside both callbacks.
+     *
+     * \param builder The builder that contains the message to be produced
+     * \param callback The callable to be executed. It must be callable as
+     * void(const Message&)
+     */
+    template <typename Functor>
+    void produce(const MessageBuilder& builder, Functor&& callback);
+
     /**
      * \brief Polls on this handle
      *
@@ -149,9 +188,36 @@ public:
      */
     void flush(std::chrono::milliseconds timeout);
 private:
+    static void delivery_report_proxy(rd_kafka_t*, const rd_kafka_message_t* msg, void* opaque);
+
+    void do_produce(const MessageBuilder& builder, void* opaque);
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    using HeadersPtr = std::unique_ptr<rd_kafka_headers_t, decltype(&rd_kafka_headers_destroy)>;
+
+    static HeadersPtr make_headers(const MessageBuilder::HeaderList& header_list);
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
     PayloadPolicy message_payload_policy_;
+    bool delivery_reports_enabled_;
+    detail::DeliveryCallbackPool delivery_callbacks_;
 };
 
+template <typename Functor>
+void Producer::produce(const MessageBuilder& builder, Functor&& callback) {
+    if (!delivery_reports_enabled_) {
+        throw Exception("Per message callbacks require a delivery report callback to be "
+                        "configured");
+    }
+    auto slot = delivery_callbacks_.acquire(std::forward<Functor>(callback), builder.user_data());
+    try {
+        do_produce(builder, static_cast<void*>(slot));
+    }
+    catch (...) {
+        delivery_callbacks_.release(slot);
+        throw;
+    }
+}
+
 } // cppkafka
 
 #endif // CPPKAFKA_PRODUCER_H
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_QUEUE_H
+#define CPPKAFKA_QUEUE_H
+
+#include <memory>
+#include <chrono>
+#include <librdkafka/rdkafka.h>
+#include "message.h"
+#include "macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Represents a rdkafka queue
+ *
+ * This is a simple wrapper over a rd_kafka_queue_t*
+ */
+class CPPKAFKA_API Queue {
+public:
+    /**
+     * The default timeout used when consuming
+     */
+    static const std::chrono::milliseconds DEFAULT_TIMEOUT;
+
+    /**
+     * \brief Creates a Queue object that doesn't take ownership of the handle
+     *
+     * \param handle The handle to be used
+     */
+    static Queue make_non_owning(rd_kafka_queue_t* handle);
+
+    /**
+     * \brief Constructs an empty queue
+     *
+     * Note that using any methods except Queue::get_handle on an empty queue is undefined
+     * behavior
+     */
+    Queue();
+
+    /**
+     * \brief Constructs a queue using a handle
+     *
+     * This will take ownership of the handle
+     *
+     * \param handle The handle to be used
+     */
+    Queue(rd_kafka_queue_t* handle);
+
+    /**
+     * \brief Forwards every event in this queue to another one
+     *
+     * This translates into a call to rd_kafka_queue_forward
+     *
+     * \param forward_queue The queue events will be forwarded to
+     */
+    void forward_to_queue(const Queue& forward_queue) const;
+
+    /**
+     * \brief Stops forwarding events from this queue
+     *
+     * This translates into a call to rd_kafka_queue_forward using a null destination
+     */
+    void disable_queue_forwarding() const;
+
+    /**
+     * \brief Sets the timeout used by Queue::consume
+     *
+     * \param timeout The timeout to be set
+     */
+    void set_timeout(std::chrono::milliseconds timeout);
+
+    /**
+     * Gets the timeout used by Queue::consume
+     */
+    std::chrono::milliseconds get_timeout() const;
+
+    /**
+     * \brief Consumes a message from this queue
+     *
+     * This translates into a call to rd_kafka_consume_queue using the configured timeout
+     */
+    Message consume() const;
+
+    /**
+     * \brief Consumes a message from this queue
+     *
+     * This translates into a call to rd_kafka_consume_queue
+     *
+     * \param timeout The timeout to be used
+     */
+    Message consume(std::chrono::milliseconds timeout) const;
+
+    /**
+     * Gets the number of events in this queue
+     */
+    size_t get_length() const;
+
+    /**
+     * Returns the rdkakfa handle
+     */
+    rd_kafka_queue_t* get_handle() const;
+
+    /**
+     * Indicates whether this queue has a handle
+     */
+    explicit operator bool() const {
+        return handle_ != nullptr;
+    }
+private:
+    using HandlePtr = std::unique_ptr<rd_kafka_queue_t, decltype(&rd_kafka_queue_destroy)>;
+
+    struct NonOwningTag { };
+
+    Queue(rd_kafka_queue_t* handle, NonOwningTag);
+
+    HandlePtr handle_;
+    std::chrono::milliseconds timeout_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_QUEUE_H
@@ -31,6 +31,7 @@
 #define CPPKAFKA_TOPIC_CONFIGURATION_H
 
 #include <string>
+#include <memory>
 #include <functional>
 #include <initializer_list>
 #include <librdkafka/rdkafka.h>
@@ -43,6 +44,14 @@ namespace cppkafka {
 class Topic;
 class Buffer;
 
+namespace detail {
+class PartitionerCache;
+} // detail
+
+int32_t partitioner_callback_proxy(const rd_kafka_topic_t* handle, const void *key_ptr,
+                                   size_t key_size, int32_t partition_count,
+                                   void* topic_opaque, void* message_opaque);
+
 /**
  * \brief Represents the topic configuration
  *
@@ -97,6 +106,24 @@ public:
      */
     TopicConfiguration& set_partitioner_callback(PartitionerCallback callback);
 
+    /**
+     * \brief Sets the size of the cache of partitions computed by the partitioner callback
+     *
+     * When set to a non zero value, the partition returned by the partitioner callback for
+     * every topic/key pair is cached, and subsequent messages with the same key skip calling
+     * it while the topic's partition count stays the same. This is useful when partitioners
+     * are expensive and a small set of keys accounts for most of the traffic.
+     *
+     * The cache holds at most this many entries and keys compete for them, so the most
+     * recently used ones are kept. Only use this on deterministic partitioners: e.g. one that
+     * depends on Topic::is_partition_available shouldn't be cached.
+     *
+     * This is disabled by default. Setting a new partitioner callback clears the cache.
+     *
+     * \param size The maximum number of entries in the cache, or 0 to disable it
+     */
+    TopicConfiguration& set_partitioner_cache_size(size_t size);
+
     /**
      * \brief Sets the "this" pointer as the opaque pointer for this handle
      *
@@ -110,6 +137,11 @@ public:
      */
     const PartitionerCallback& get_partitioner_callback() const;
 
+    /**
+     * Gets the size of the partitioner cache, 0 if disabled
+     */
+    size_t get_partitioner_cache_size() const;
+
     /**
      * Returns true iff the given property name has been set
      */
@@ -136,11 +168,16 @@ private:
                                   decltype(&rd_kafka_topic_conf_destroy),
                                   decltype(&rd_kafka_topic_conf_dup)>;
 
+    friend int32_t partitioner_callback_proxy(const rd_kafka_topic_t*, const void*, size_t,
+                                              int32_t, void*, void*);
+
     TopicConfiguration(rd_kafka_topic_conf_t* ptr);
     static HandlePtr make_handle(rd_kafka_topic_conf_t* ptr);
 
     HandlePtr handle_;
     PartitionerCallback partitioner_callback_;
+    // Shared by copies, which is fine as it's replaced whenever the callback changes
+    std::shared_ptr<detail::PartitionerCache> partitioner_cache_;
 };
 
 } // cppkafka
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_BATCH_PARTITIONER_H
+#define CPPKAFKA_BATCH_PARTITIONER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <librdkafka/rdkafka.h>
+#include "../buffer.h"
+#include "../macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Computes the partitions for many keys at once
+ *
+ * This replicates rdkafka's built in key based partitioners, so the partitions computed
+ * here are the same ones rdkafka would pick for the same keys and partition count. Since
+ * all keys are hashed in a single pass (murmur2 hashes several keys in lockstep, so the
+ * CPU can overlap their multiplications), this is much cheaper than letting rdkafka call the
+ * partitioner once per message when producing large batches.
+ *
+ * Messages with no key (null data pointer) are mapped to RD_KAFKA_PARTITION_UA when using
+ * one of the random partitioners, meaning rdkafka should pick a random partition for them.
+ *
+ * \code
+ * BatchPartitioner partitioner(BatchPartitioner::Algorithm::MURMUR2_RANDOM);
+ * vector<int32_t> partitions = partitioner.partition(keys, partition_count);
+ * \endcode
+ */
+class CPPKAFKA_API BatchPartitioner {
+public:
+    /**
+     * The partitioners supported, named after the values of rdkafka's "partitioner" property
+     */
+    enum class Algorithm {
+        CONSISTENT,
+        CONSISTENT_RANDOM,
+        MURMUR2,
+        MURMUR2_RANDOM,
+        FNV1A,
+        FNV1A_RANDOM
+    };
+
+    /**
+     * \brief Gets the algorithm for the given value of rdkafka's "partitioner" property
+     *
+     * Throws if the partitioner isn't a key based one (e.g. "random")
+     *
+     * \param name The partitioner's name
+     */
+    static Algorithm get_algorithm(const std::string& name);
+
+    /**
+     * \brief Computes the murmur2 hash of the given data, as done by the java client
+     *
+     * \param data The data to be hashed
+     * \param size The size of the data
+     */
+    static uint32_t murmur2(const void* data, size_t size);
+
+    /**
+     * \brief Computes the CRC32 of the given data, as done by the consistent partitioners
+     *
+     * \param data The data to be hashed
+     * \param size The size of the data
+     */
+    static uint32_t crc32(const void* data, size_t size);
+
+    /**
+     * \brief Computes the 32 bit FNV-1a hash of the given data
+     *
+     * \param data The data to be hashed
+     * \param size The size of the data
+     */
+    static uint32_t fnv1a(const void* data, size_t size);
+
+    /**
+     * \brief Constructs a batch partitioner
+     *
+     * \param algorithm The partitioner to be replicated
+     */
+    BatchPartitioner(Algorithm algorithm = Algorithm::CONSISTENT_RANDOM);
+
+    /**
+     * \brief Computes the partition for a single key
+     *
+     * \param key The key
+     * \param partition_count The number of partitions in the topic
+     */
+    int32_t partition(const Buffer& key, int32_t partition_count) const;
+
+    /**
+     * \brief Computes the partitions for an array of keys
+     *
+     * \param keys Pointer to the first key
+     * \param count The number of keys
+     * \param partition_count The number of partitions in the topic
+     * \param output Where the partition for every key will be written
+     */
+    void partition(const Buffer* keys, size_t count, int32_t partition_count,
+                   int32_t* output) const;
+
+    /**
+     * \brief Computes the partitions for a vector of keys
+     *
+     * \param keys The keys
+     * \param partition_count The number of partitions in the topic
+     */
+    std::vector<int32_t> partition(const std::vector<Buffer>& keys,
+                                   int32_t partition_count) const;
+
+    /**
+     * Gets the algorithm used
+     */
+    Algorithm get_algorithm() const;
+private:
+    void partition_murmur2(const Buffer* keys, size_t count, int32_t partition_count,
+                           int32_t* output) const;
+    bool is_random() const;
+
+    Algorithm algorithm_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_BATCH_PARTITIONER_H
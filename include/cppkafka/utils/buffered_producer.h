@@ -37,9 +37,17 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <map>
+#include <tuple>
+#include <vector>
+#include <chrono>
+#include <memory>
 #include <boost/optional.hpp>
 #include "../producer.h"
 #include "../message.h"
+#include "../metadata.h"
+#include "record_envelope.h"
+#include "batch_partitioner.h"
+#include "circuit_breaker.h"
 
 namespace cppkafka {
 
@@ -56,6 +64,22 @@ namespace cppkafka {
  * When producing messages, this class will handle cases where the producer's queue is full so it\
  * will poll until the production is successful.
  *
+ * Buffered messages can optionally be packed into envelopes (see
+ * BufferedProducer::set_max_envelope_size). In this mode, every buffered message becomes a
+ * record inside an envelope shared with the rest of the messages having the same topic,
+ * partition and key, and only the envelopes are produced. This is useful when producing lots
+ * of tiny messages, as the per message overhead is paid once per envelope rather than once
+ * per record. Envelopes can be unpacked on the consumer side using an EnvelopeReader.
+ *
+ * When a batch partitioner is set (see BufferedProducer::set_batch_partitioner), the
+ * partitions of all buffered messages are computed in a single pass when flushing and
+ * messages are then produced grouped by partition.
+ *
+ * When a circuit breaker is set (see BufferedProducer::set_circuit_breaker), every time the
+ * producer's queue is full and every delivery report is recorded on it. Once it trips,
+ * producing fails fast with a CircuitOpenException instead of polling until the queue has
+ * room, unless the message's priority is high enough to go through while it's open.
+ *
  * This class is not thread safe.
  */
 template <typename BufferType>
@@ -71,6 +95,11 @@ public:
      */
     using ProduceFailureCallback = std::function<bool(const Message&)>;
 
+    /**
+     * Callback to indicate a message was successfully produced.
+     */
+    using ProduceSuccessCallback = std::function<void(const Message&)>;
+
     /**
      * \brief Constructs a buffered producer using the provided configuration
      *
@@ -105,15 +134,22 @@ public:
      * The message will still be tracked so that a call to flush or wait_for_acks will actually
      * wait for it to be acknowledged.
      *
+     * If a circuit breaker is set and it doesn't allow this message's priority, a
+     * CircuitOpenException is thrown and the message isn't tracked.
+     *
      * \param builder The builder that contains the message to be produced
+     * \param priority The priority used when checking the circuit breaker
      */
-    void produce(const MessageBuilder& builder);
+    void produce(const MessageBuilder& builder, unsigned priority = 0);
 
     /**
      * \brief Flushes the buffered messages.
      *
      * This will send all messages and keep waiting until all of them are acknowledged (this is
      * done by calling wait_for_acks).
+     *
+     * If a circuit breaker is set and it's open, a CircuitOpenException is thrown. The messages
+     * that weren't produced yet are kept buffered, so flush can be called again later on.
      */
     void flush();
 
@@ -152,22 +188,138 @@ public:
      * \param callback The callback to be set
      */
     void set_produce_failure_callback(ProduceFailureCallback callback);
+
+    /**
+     * \brief Sets the message produce success callback
+     *
+     * This will be called when the delivery report callback is executed for a message that
+     * was successfully acknowledged by the brokers. This can be used to track messages by
+     * their user data pointer (e.g. to commit the offsets they were generated from).
+     *
+     * \param callback The callback to be set
+     */
+    void set_produce_success_callback(ProduceSuccessCallback callback);
+
+    /**
+     * \brief Sets the maximum size of the envelopes buffered messages are packed into
+     *
+     * When this is greater than 0, messages added via add_message are packed into envelopes
+     * instead of being produced one by one. An envelope is closed once adding another record
+     * would make it larger than this size, while a single record larger than this size
+     * will be put in an envelope of its own. Envelopes are produced when calling flush.
+     *
+     * Note that records lose their timestamp (the envelope uses the one of its first record)
+     * and their user data pointer. Acknowledgements, as well as the produce callbacks, are
+     * tracked per envelope.
+     *
+     * The default is 0, which means envelopes are not used.
+     *
+     * \param value The value to be set
+     */
+    void set_max_envelope_size(size_t value);
+
+    /**
+     * Gets the maximum size of the envelopes buffered messages are packed into
+     */
+    size_t get_max_envelope_size() const;
+
+    /**
+     * \brief Sets the partitioner used to assign partitions to buffered messages
+     *
+     * When set, flushing will compute the partitions of all buffered messages that don't
+     * have an explicit one in a single pass and then produce them grouped by topic and
+     * partition, keeping the order of the messages within each partition. This avoids
+     * having rdkafka call the partitioner once per message.
+     *
+     * The partitioner should use the same algorithm as the topic's "partitioner" property
+     * so messages end up in the same partitions they would have been sent to anyway.
+     * Partition counts are fetched from the brokers and cached for
+     * PARTITION_COUNT_REFRESH_INTERVAL. If they can't be fetched, rdkafka partitions
+     * those messages as usual.
+     *
+     * This doesn't apply to messages packed into envelopes.
+     *
+     * \param partitioner The partitioner to be used
+     */
+    void set_batch_partitioner(BatchPartitioner partitioner);
+
+    /**
+     * \brief Sets the circuit breaker used to stop producing while the brokers are struggling
+     *
+     * Every time the producer's queue is full, a failure is recorded on the breaker, as well as
+     * one for every delivery report having an error. Successful delivery reports are recorded
+     * as successes. Messages re-sent after a failed delivery report are never rejected.
+     *
+     * The breaker can be shared with other producers.
+     *
+     * \param breaker The breaker to be used, or a null pointer to stop using one
+     */
+    void set_circuit_breaker(std::shared_ptr<CircuitBreaker> breaker);
+
+    /**
+     * Gets the circuit breaker, if any
+     */
+    const std::shared_ptr<CircuitBreaker>& get_circuit_breaker() const;
+
+    /**
+     * How long partition counts used by the batch partitioner are cached for
+     */
+    static const std::chrono::milliseconds PARTITION_COUNT_REFRESH_INTERVAL;
 private:
+    using ClockType = std::chrono::steady_clock;
     using QueueType = std::queue<Builder>;
+    // Topic, partition, whether there's a key and the key itself
+    using EnvelopeKey = std::tuple<std::string, int, bool, std::string>;
+
+    struct Envelope {
+        EnvelopeBuilder records;
+        std::chrono::milliseconds timestamp{0};
+    };
+
+    using EnvelopeMap = std::map<EnvelopeKey, Envelope>;
+    using EnvelopeQueue = std::queue<std::pair<EnvelopeKey, Envelope>>;
+
+    static Buffer make_buffer(const Buffer& value) {
+        return Buffer(value.get_data(), value.get_size());
+    }
+
+    template <typename T>
+    static Buffer make_buffer(const T& value) {
+        return Buffer(value);
+    }
 
     template <typename BuilderType>
     void do_add_message(BuilderType&& builder);
-    void produce_message(const MessageBuilder& message);
+    template <typename BuilderType>
+    void add_to_envelope(const BuilderType& builder);
+    void seal_envelope(typename EnvelopeMap::value_type& envelope);
+    void produce_envelopes();
+    void produce_message(const MessageBuilder& message, unsigned priority = 0,
+                         bool can_reject = true);
+    void partition_messages();
+    int get_partition_count(const std::string& topic);
     Configuration prepare_configuration(Configuration config);
     void on_delivery_report(const Message& message);
 
     Producer producer_;
     QueueType messages_;
     ProduceFailureCallback produce_failure_callback_;
+    ProduceSuccessCallback produce_success_callback_;
+    EnvelopeMap open_envelopes_;
+    EnvelopeQueue sealed_envelopes_;
+    typename EnvelopeMap::value_type* last_envelope_{nullptr};
+    size_t max_envelope_size_{0};
     size_t expected_acks_{0};
     size_t messages_acked_{0};
+    boost::optional<BatchPartitioner> batch_partitioner_;
+    std::shared_ptr<CircuitBreaker> circuit_breaker_;
+    std::unordered_map<std::string, std::pair<int, ClockType::time_point>> partition_counts_;
 };
 
+template <typename BufferType>
+const std::chrono::milliseconds
+BufferedProducer<BufferType>::PARTITION_COUNT_REFRESH_INTERVAL = std::chrono::minutes(5);
+
 template <typename BufferType>
 BufferedProducer<BufferType>::BufferedProducer(Configuration config)
 : producer_(prepare_configuration(std::move(config))) {
@@ -185,17 +337,21 @@ void BufferedProducer<BufferType>::add_message(Builder builder) {
 }
 
 template <typename BufferType>
-void BufferedProducer<BufferType>::produce(const MessageBuilder& builder) {
+void BufferedProducer<BufferType>::produce(const MessageBuilder& builder, unsigned priority) {
+    produce_message(builder, priority);
     expected_acks_++;
-    produce_message(builder);
 }
 
 template <typename BufferType>
 void BufferedProducer<BufferType>::flush() {
+    if (batch_partitioner_) {
+        partition_messages();
+    }
     while (!messages_.empty()) {
         produce_message(messages_.front());
         messages_.pop();
     }
+    produce_envelopes();
 
     wait_for_acks();
 }
@@ -224,6 +380,10 @@ template <typename BufferType>
 void BufferedProducer<BufferType>::clear() {
     QueueType tmp;
     std::swap(tmp, messages_);
+    EnvelopeQueue tmp_envelopes;
+    std::swap(tmp_envelopes, sealed_envelopes_);
+    open_envelopes_.clear();
+    last_envelope_ = nullptr;
     expected_acks_ = 0;
     messages_acked_ = 0;
 }
@@ -231,10 +391,75 @@ void BufferedProducer<BufferType>::clear() {
 template <typename BufferType>
 template <typename BuilderType>
 void BufferedProducer<BufferType>::do_add_message(BuilderType&& builder) {
+    if (max_envelope_size_ > 0) {
+        add_to_envelope(builder);
+        return;
+    }
     expected_acks_++;
     messages_.push(std::move(builder));
 }
 
+template <typename BufferType>
+template <typename BuilderType>
+void BufferedProducer<BufferType>::add_to_envelope(const BuilderType& builder) {
+    const Buffer key = make_buffer(builder.key());
+    const Buffer payload = make_buffer(builder.payload());
+    // An empty key is still a key, so tell it apart from a missing one
+    const bool has_key = key.get_data() != nullptr;
+    // Consecutive messages usually go into the same envelope, so avoid the lookup in that case
+    if (!last_envelope_ || std::get<1>(last_envelope_->first) != builder.partition() ||
+        std::get<2>(last_envelope_->first) != has_key ||
+        std::get<0>(last_envelope_->first) != builder.topic() ||
+        Buffer(std::get<3>(last_envelope_->first)) != key) {
+        EnvelopeKey envelope_key(builder.topic(), builder.partition(), has_key,
+                                 std::string(key.begin(), key.end()));
+        last_envelope_ = &*open_envelopes_.emplace(std::move(envelope_key), Envelope()).first;
+    }
+    Envelope& envelope = last_envelope_->second;
+    const size_t record_size = EnvelopeBuilder::get_record_size(payload.get_size());
+    if (!envelope.records.empty() &&
+        envelope.records.get_size() + record_size > max_envelope_size_) {
+        seal_envelope(*last_envelope_);
+    }
+    // Let the envelope grow as records are added. Reserving the maximum size up front would
+    // take that much memory for every distinct key
+    if (envelope.records.empty()) {
+        envelope.timestamp = builder.timestamp();
+    }
+    envelope.records.add_record(payload);
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::seal_envelope(typename EnvelopeMap::value_type& envelope) {
+    expected_acks_++;
+    sealed_envelopes_.emplace(envelope.first, std::move(envelope.second));
+    envelope.second = Envelope();
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::produce_envelopes() {
+    for (auto& envelope : open_envelopes_) {
+        if (!envelope.second.records.empty()) {
+            seal_envelope(envelope);
+        }
+    }
+    while (!sealed_envelopes_.empty()) {
+        const EnvelopeKey& envelope_key = sealed_envelopes_.front().first;
+        const Envelope& envelope = sealed_envelopes_.front().second;
+        const std::string& key = std::get<3>(envelope_key);
+        MessageBuilder builder(std::get<0>(envelope_key));
+        builder.partition(std::get<1>(envelope_key))
+               .payload(envelope.records.get_buffer())
+               .timestamp(envelope.timestamp);
+        // Keep missing and empty keys apart
+        if (std::get<2>(envelope_key)) {
+            builder.key(Buffer(key));
+        }
+        produce_message(builder);
+        sealed_envelopes_.pop();
+    }
+}
+
 template <typename BufferType>
 Producer& BufferedProducer<BufferType>::get_producer() {
     return producer_;
@@ -257,7 +482,115 @@ void BufferedProducer<BufferType>::set_produce_failure_callback(ProduceFailureCa
 }
 
 template <typename BufferType>
-void BufferedProducer<BufferType>::produce_message(const MessageBuilder& builder) {
+void BufferedProducer<BufferType>::set_produce_success_callback(ProduceSuccessCallback callback) {
+    produce_success_callback_ = std::move(callback);
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::set_max_envelope_size(size_t value) {
+    max_envelope_size_ = value;
+}
+
+template <typename BufferType>
+size_t BufferedProducer<BufferType>::get_max_envelope_size() const {
+    return max_envelope_size_;
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::set_batch_partitioner(BatchPartitioner partitioner) {
+    batch_partitioner_ = partitioner;
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::set_circuit_breaker(std::shared_ptr<CircuitBreaker> breaker) {
+    circuit_breaker_ = std::move(breaker);
+}
+
+template <typename BufferType>
+const std::shared_ptr<CircuitBreaker>&
+BufferedProducer<BufferType>::get_circuit_breaker() const {
+    return circuit_breaker_;
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::partition_messages() {
+    std::vector<Builder> builders;
+    builders.reserve(messages_.size());
+    while (!messages_.empty()) {
+        builders.push_back(std::move(messages_.front()));
+        messages_.pop();
+    }
+    // Gather the messages that need a partition, per topic
+    std::map<std::string, std::vector<size_t>> unassigned;
+    for (size_t i = 0; i < builders.size(); ++i) {
+        if (builders[i].partition() == RD_KAFKA_PARTITION_UA) {
+            unassigned[builders[i].topic()].push_back(i);
+        }
+    }
+    std::vector<Buffer> keys;
+    std::vector<int32_t> partitions;
+    for (const auto& topic_indexes : unassigned) {
+        const int partition_count = get_partition_count(topic_indexes.first);
+        if (partition_count <= 0) {
+            continue;
+        }
+        const std::vector<size_t>& indexes = topic_indexes.second;
+        keys.clear();
+        for (size_t index : indexes) {
+            keys.push_back(make_buffer(builders[index].key()));
+        }
+        partitions.resize(indexes.size());
+        batch_partitioner_->partition(keys.data(), keys.size(), partition_count,
+                                      partitions.data());
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            builders[indexes[i]].partition(partitions[i]);
+        }
+    }
+    // Group them by topic/partition. The sort is stable so each partition keeps its order
+    std::vector<size_t> order(builders.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        const Builder& lhs_builder = builders[lhs];
+        const Builder& rhs_builder = builders[rhs];
+        if (lhs_builder.topic() != rhs_builder.topic()) {
+            return lhs_builder.topic() < rhs_builder.topic();
+        }
+        return lhs_builder.partition() < rhs_builder.partition();
+    });
+    for (size_t index : order) {
+        messages_.push(std::move(builders[index]));
+    }
+}
+
+template <typename BufferType>
+int BufferedProducer<BufferType>::get_partition_count(const std::string& topic) {
+    const auto now = ClockType::now();
+    auto iter = partition_counts_.find(topic);
+    if (iter != partition_counts_.end() &&
+        now - iter->second.second < PARTITION_COUNT_REFRESH_INTERVAL) {
+        return iter->second.first;
+    }
+    int partition_count = 0;
+    try {
+        TopicMetadata metadata = producer_.get_metadata(producer_.get_topic(topic));
+        partition_count = static_cast<int>(metadata.get_partitions().size());
+    }
+    catch (const HandleException&) {
+        // Let rdkafka partition these messages, we'll try again on the next flush
+        return 0;
+    }
+    partition_counts_[topic] = std::make_pair(partition_count, now);
+    return partition_count;
+}
+
+template <typename BufferType>
+void BufferedProducer<BufferType>::produce_message(const MessageBuilder& builder,
+                                                   unsigned priority, bool can_reject) {
+    if (circuit_breaker_ && can_reject && !circuit_breaker_->allow(priority)) {
+        throw CircuitOpenException();
+    }
     bool sent = false;
     while (!sent) {
         try {
@@ -267,6 +600,13 @@ void BufferedProducer<BufferType>::produce_message(const MessageBuilder& builder
         catch (const HandleException& ex) {
             const Error error = ex.get_error();
             if (error == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                if (circuit_breaker_) {
+                    circuit_breaker_->record_failure();
+                    // Stop waiting for room if the breaker tripped in the meantime
+                    if (can_reject && !circuit_breaker_->allow(priority)) {
+                        throw CircuitOpenException();
+                    }
+                }
                 // If the output queue is full, then just poll
                 producer_.poll();
             }
@@ -287,6 +627,14 @@ Configuration BufferedProducer<BufferType>::prepare_configuration(Configuration
 
 template <typename BufferType>
 void BufferedProducer<BufferType>::on_delivery_report(const Message& message) {
+    if (circuit_breaker_) {
+        if (message.get_error()) {
+            circuit_breaker_->record_failure();
+        }
+        else {
+            circuit_breaker_->record_success();
+        }
+    }
     // We should produce this message again if it has an error and we either don't have a 
     // produce failure callback or we have one but it returns true
     bool should_produce = message.get_error() &&
@@ -297,13 +645,18 @@ void BufferedProducer<BufferType>::on_delivery_report(const Message& message) {
         const auto& payload = message.get_payload();
         builder.partition(message.get_partition())
                .key(Buffer(key.get_data(), key.get_size()))
-               .payload(Buffer(payload.get_data(), payload.get_size()));
+               .payload(Buffer(payload.get_data(), payload.get_size()))
+               .user_data(message.get_private_data());
         if (message.get_timestamp()) {
             builder.timestamp(message.get_timestamp()->get_timestamp());
         }
-        produce_message(builder);
+        // This runs inside rdkafka's callback, so never throw here
+        produce_message(builder, 0, false);
         return;
     }
+    if (!message.get_error() && produce_success_callback_) {
+        produce_success_callback_(message);
+    }
     // If production was successful or the produce failure callback returned false, then
     // let's consider it to be acked 
     messages_acked_++;
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_CHUNK_REASSEMBLER_H
+#define CPPKAFKA_CHUNK_REASSEMBLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include "../buffer.h"
+#include "../message.h"
+#include "../topic_partition.h"
+#include "../topic_partition_list.h"
+
+namespace cppkafka {
+
+/**
+ * \brief A message put back together out of the chunks produced by a ChunkedProducer
+ *
+ * The payload is always a single contiguous buffer. For payloads that fit in a single
+ * chunk, this is just a view into the consumed message so no copies are performed.
+ */
+class CPPKAFKA_API ReassembledMessage {
+public:
+    ReassembledMessage(ReassembledMessage&&) = default;
+    ReassembledMessage& operator=(ReassembledMessage&&) = default;
+
+    /**
+     * Gets the topic this message was consumed from
+     */
+    const std::string& get_topic() const;
+
+    /**
+     * Gets the partition this message was consumed from
+     */
+    int get_partition() const;
+
+    /**
+     * Gets the message's key
+     */
+    const Buffer& get_key() const;
+
+    /**
+     * Gets the reassembled payload
+     */
+    const Buffer& get_payload() const;
+
+    /**
+     * Gets the lowest offset among this message's chunks
+     */
+    int64_t get_offset() const;
+
+    /**
+     * \brief Gets the highest offset among this message's chunks
+     *
+     * Once this message is processed, it's safe to commit up to this offset as long as
+     * there's no other incomplete message having a lower offset in the same partition.
+     */
+    int64_t get_last_offset() const;
+private:
+    friend class ChunkReassembler;
+
+    ReassembledMessage(std::string topic, int partition, int64_t offset, int64_t last_offset);
+
+    std::string topic_;
+    int partition_;
+    int64_t offset_;
+    int64_t last_offset_;
+    Message message_;
+    std::vector<uint8_t> key_data_;
+    std::unique_ptr<uint8_t[]> payload_data_;
+    Buffer key_;
+    Buffer payload_;
+};
+
+/**
+ * \brief Reassembles the payloads split into chunks by a ChunkedProducer
+ *
+ * Chunks are fed into this class as they're consumed and a ReassembledMessage is handed
+ * to the message callback every time all of the chunks of a payload have been seen. Chunks
+ * belonging to different payloads (e.g. coming from several producers) may be interleaved.
+ *
+ * When the first chunk of a payload arrives, a buffer large enough to hold the whole
+ * payload is allocated and every chunk is copied straight into its position within it, so
+ * no further allocations or copies are performed when the payload is complete.
+ *
+ * Incomplete payloads are dropped once their timeout expires, as well as when the amount
+ * of memory used by incomplete payloads exceeds the configured limit (oldest ones first).
+ * Expired payloads are evicted every time a chunk is added and when calling
+ * ChunkReassembler::evict_expired.
+ *
+ * \code
+ * ChunkReassembler reassembler([&](ReassembledMessage msg) {
+ *     process(msg.get_payload());
+ * });
+ *
+ * while (running) {
+ *     Message msg = consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         reassembler.add(move(msg));
+ *     }
+ *     else {
+ *         reassembler.evict_expired();
+ *     }
+ * }
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API ChunkReassembler {
+public:
+    static const std::chrono::milliseconds DEFAULT_TIMEOUT;
+    static const size_t DEFAULT_MAXIMUM_MESSAGE_SIZE;
+    static const size_t DEFAULT_MAXIMUM_BUFFERED_BYTES;
+
+    /**
+     * Callback executed for every fully reassembled message
+     */
+    using MessageCallback = std::function<void(ReassembledMessage)>;
+
+    /**
+     * \brief Callback executed when an incomplete message is dropped
+     *
+     * The topic/partition/offset provided is the one of the lowest chunk seen for it
+     */
+    using ExpirationCallback = std::function<void(const TopicPartition&)>;
+
+    /**
+     * \brief Callback executed for messages that don't contain a valid chunk
+     *
+     * If no callback is set, an Exception will be thrown when such a message is added
+     */
+    using InvalidMessageCallback = std::function<void(const Message&)>;
+
+    /**
+     * \brief Constructs a chunk reassembler
+     *
+     * \param callback The callback to be executed for every reassembled message
+     */
+    ChunkReassembler(MessageCallback callback);
+
+    /**
+     * \brief Adds a consumed chunk
+     *
+     * If this completes a message, the message callback is executed before returning.
+     * Chunks that were already seen (e.g. because they were re-sent by the producer) are
+     * ignored.
+     *
+     * \param message The consumed chunk
+     */
+    void add(Message message);
+
+    /**
+     * \brief Drops every incomplete message whose timeout has expired
+     */
+    void evict_expired();
+
+    /**
+     * \brief Drops every incomplete message on the given topic/partitions
+     *
+     * This should be called when partitions are revoked, as the rest of their chunks will
+     * be consumed by someone else. The expiration callback is not executed for them.
+     *
+     * \param topic_partitions The topic/partitions to be dropped
+     */
+    void discard(const TopicPartitionList& topic_partitions);
+
+    /**
+     * \brief Drops every incomplete message
+     */
+    void clear();
+
+    /**
+     * \brief Sets the maximum time to wait for all of a message's chunks to arrive
+     *
+     * The time is measured starting when its first chunk is added. The default is
+     * DEFAULT_TIMEOUT.
+     *
+     * \param value The value to be set
+     */
+    void set_timeout(std::chrono::milliseconds value);
+
+    /**
+     * \brief Sets the maximum size of a reassembled message
+     *
+     * Chunks for larger messages will be treated as invalid. This prevents a corrupt or
+     * malicious header from making this allocate an arbitrarily large buffer. The default
+     * is DEFAULT_MAXIMUM_MESSAGE_SIZE.
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_message_size(size_t value);
+
+    /**
+     * \brief Sets the maximum number of bytes allocated for incomplete messages
+     *
+     * If allocating a buffer for a new message would exceed this, the oldest incomplete
+     * messages are dropped until it fits. The default is DEFAULT_MAXIMUM_BUFFERED_BYTES.
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_buffered_bytes(size_t value);
+
+    /**
+     * \brief Sets the expiration callback
+     *
+     * \param callback The callback to be set
+     */
+    void set_expiration_callback(ExpirationCallback callback);
+
+    /**
+     * \brief Sets the invalid message callback
+     *
+     * \param callback The callback to be set
+     */
+    void set_invalid_message_callback(InvalidMessageCallback callback);
+
+    /**
+     * Gets the number of incomplete messages
+     */
+    size_t get_pending_count() const;
+
+    /**
+     * Gets the number of bytes allocated for incomplete messages
+     */
+    size_t get_buffered_bytes() const;
+private:
+    using ClockType = std::chrono::steady_clock;
+    using GroupKey = std::tuple<std::string, int, uint64_t>;
+
+    struct Group {
+        GroupKey key;
+        ClockType::time_point expiration;
+        std::unique_ptr<uint8_t[]> data;
+        uint64_t total_size;
+        uint64_t chunk_stride;
+        uint64_t received_bytes;
+        std::vector<uint8_t> message_key;
+        std::vector<bool> received_chunks;
+        size_t pending_chunks;
+        int64_t first_offset;
+        int64_t last_offset;
+    };
+
+    using GroupList = std::list<Group>;
+
+    void handle_invalid_message(const Message& message);
+    void evict(GroupList::iterator iter, bool notify);
+
+    MessageCallback message_callback_;
+    ExpirationCallback expiration_callback_;
+    InvalidMessageCallback invalid_message_callback_;
+    // Groups are kept in arrival order, which is also expiration order
+    GroupList groups_;
+    std::map<GroupKey, GroupList::iterator> group_index_;
+    std::chrono::milliseconds timeout_;
+    size_t maximum_message_size_;
+    size_t maximum_buffered_bytes_;
+    size_t buffered_bytes_{0};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_CHUNK_REASSEMBLER_H
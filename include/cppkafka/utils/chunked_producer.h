@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_CHUNKED_PRODUCER_H
+#define CPPKAFKA_CHUNKED_PRODUCER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include "../producer.h"
+#include "../message_builder.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Produces payloads of any size by splitting them into chunks
+ *
+ * Payloads larger than the configured chunk size are split into ordered chunks which are
+ * all produced into the same partition. Every chunk carries a small header identifying
+ * the group it belongs to and its position within it, so a ChunkReassembler can put the
+ * original payload back together on the consumer side. This allows producing payloads
+ * larger than message.max.bytes without having to raise that limit on the brokers.
+ *
+ * Every payload produced through this class is framed, even the ones that fit in a single
+ * chunk, so the topic they're produced into should only be consumed using a
+ * ChunkReassembler.
+ *
+ * All chunks of a payload are kept in the same partition:
+ *
+ * * If the message has an explicit partition, that one is used.
+ * * If it has a key, the partition is left for the topic's partitioner to pick, which
+ *   will map every chunk to the same partition as long as it's a deterministic one (e.g.
+ *   the default one).
+ * * Otherwise, if the payload spans more than one chunk, a random partition is picked
+ *   using the topic's metadata.
+ *
+ * Chunks are built in a buffer owned by this class, so the producer has to use
+ * Producer::PayloadPolicy::COPY_PAYLOAD (the default one).
+ *
+ * Note that in order for chunks not to be reordered when retried, the producer should be
+ * configured with "max.in.flight.requests.per.connection" set to 1 or with idempotence
+ * enabled. If any chunk fails to be delivered, the group will be incomplete and will be
+ * dropped by the reassembler once it times out.
+ *
+ * \code
+ * Producer producer(config);
+ * ChunkedProducer chunked_producer(producer);
+ *
+ * // This will be split into ~20 chunks
+ * string payload(20 * 1024 * 1024, 'x');
+ * chunked_producer.produce(MessageBuilder("blobs").key("some_key").payload(payload));
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API ChunkedProducer {
+public:
+    static const size_t DEFAULT_CHUNK_SIZE;
+
+    /**
+     * \brief Constructs a chunked producer
+     *
+     * \param producer The producer to be used
+     */
+    ChunkedProducer(Producer& producer);
+
+    /**
+     * \brief Produces a message, splitting its payload into chunks if needed
+     *
+     * The message's key and timestamp are set on every chunk. The user data pointer, if any,
+     * is only set on the last one.
+     *
+     * If the producer's queue is full, this will poll it until every chunk is enqueued.
+     *
+     * \param builder The message to be produced
+     */
+    void produce(const MessageBuilder& builder);
+
+    /**
+     * \brief Sets the maximum number of payload bytes carried by each chunk
+     *
+     * The chunk header is not included in this size, so this should be lower than
+     * message.max.bytes by some margin. The default is DEFAULT_CHUNK_SIZE.
+     *
+     * \param value The value to be set
+     */
+    void set_chunk_size(size_t value);
+
+    /**
+     * Gets the maximum number of payload bytes carried by each chunk
+     */
+    size_t get_chunk_size() const;
+
+    /**
+     * Gets the Producer object
+     */
+    Producer& get_producer();
+private:
+    int get_random_partition(const std::string& topic);
+    void produce_chunk(const MessageBuilder& builder);
+
+    Producer& producer_;
+    std::map<std::string, size_t> partition_counts_;
+    std::vector<uint8_t> chunk_buffer_;
+    std::mt19937_64 random_engine_;
+    size_t chunk_size_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_CHUNKED_PRODUCER_H
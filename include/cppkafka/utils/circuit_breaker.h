@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_CIRCUIT_BREAKER_H
+#define CPPKAFKA_CIRCUIT_BREAKER_H
+
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include "../macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Stops sending requests to a destination that keeps failing
+ *
+ * The breaker starts closed, letting every request through while counting successes and
+ * failures over a sliding time window. Once the window holds at least the minimum number of
+ * requests and the fraction of them that failed reaches the failure ratio, the breaker trips
+ * and becomes open. While open, requests are rejected unless their priority is at least the
+ * open priority, so low priority traffic is shed while critical traffic keeps going.
+ *
+ * After the open timeout, the next call to CircuitBreaker::allow moves it to half open, which
+ * lets a limited number of probe requests through. If as many successes as probes are
+ * recorded the breaker closes again, while any failure opens it for another open timeout.
+ *
+ * \code
+ * CircuitBreaker breaker;
+ * breaker.set_failure_ratio(0.5);
+ *
+ * if (breaker.allow()) {
+ *     try {
+ *         do_request();
+ *         breaker.record_success();
+ *     }
+ *     catch (...) {
+ *         breaker.record_failure();
+ *     }
+ * }
+ * \endcode
+ *
+ * This class is thread safe, so a single breaker can be shared by several producers sending
+ * to the same cluster.
+ */
+class CPPKAFKA_API CircuitBreaker {
+public:
+    /**
+     * The breaker's state
+     */
+    enum class State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    /**
+     * Callback executed whenever the breaker changes its state
+     */
+    using StateChangeCallback = std::function<void(State)>;
+
+    static const std::chrono::milliseconds DEFAULT_WINDOW_SIZE;
+    static const size_t DEFAULT_MINIMUM_REQUESTS;
+    static const double DEFAULT_FAILURE_RATIO;
+    static const std::chrono::milliseconds DEFAULT_OPEN_TIMEOUT;
+    static const size_t DEFAULT_PROBE_COUNT;
+
+    /**
+     * Constructs a closed circuit breaker using the default settings
+     */
+    CircuitBreaker();
+
+    CircuitBreaker(const CircuitBreaker&) = delete;
+    CircuitBreaker& operator=(const CircuitBreaker&) = delete;
+
+    /**
+     * \brief Indicates whether a request should be attempted
+     *
+     * When the breaker is half open, every call that returns true takes one of the probes.
+     *
+     * \param priority The request's priority
+     */
+    bool allow(unsigned priority = 0);
+
+    /**
+     * Records a successful request
+     */
+    void record_success();
+
+    /**
+     * Records a failed request
+     */
+    void record_failure();
+
+    /**
+     * \brief Closes the breaker and discards every recorded request
+     */
+    void reset();
+
+    /**
+     * \brief Gets the current state
+     *
+     * An open breaker only moves to half open on the next call to CircuitBreaker::allow
+     */
+    State get_state() const;
+
+    /**
+     * Gets the number of times the breaker has gone from closed or half open to open
+     */
+    size_t get_trip_count() const;
+
+    /**
+     * \brief Sets the time window requests are counted over
+     *
+     * \param value The value to be set
+     */
+    void set_window_size(std::chrono::milliseconds value);
+
+    /**
+     * \brief Sets the minimum number of requests in the window before the breaker can trip
+     *
+     * \param value The value to be set
+     */
+    void set_minimum_requests(size_t value);
+
+    /**
+     * \brief Sets the fraction of failed requests in the window that trips the breaker
+     *
+     * \param value The value to be set, which will be clamped to [0, 1]
+     */
+    void set_failure_ratio(double value);
+
+    /**
+     * \brief Sets the time the breaker stays open before letting probes through
+     *
+     * This is also how long a half open breaker waits for the outcome of its probes before
+     * letting a new round of them through.
+     *
+     * \param value The value to be set
+     */
+    void set_open_timeout(std::chrono::milliseconds value);
+
+    /**
+     * \brief Sets the number of probes let through while half open
+     *
+     * \param value The value to be set. This will be at least 1
+     */
+    void set_probe_count(size_t value);
+
+    /**
+     * \brief Sets the minimum priority of the requests allowed while the breaker is open
+     *
+     * By default this is the maximum unsigned value, so no request is allowed
+     *
+     * \param value The value to be set
+     */
+    void set_open_priority(unsigned value);
+
+    /**
+     * \brief Sets the state change callback
+     *
+     * The callback is executed without holding any lock, on the thread that caused the change
+     *
+     * \param callback The callback to be set
+     */
+    void set_state_change_callback(StateChangeCallback callback);
+private:
+    using ClockType = std::chrono::steady_clock;
+
+    struct Bucket {
+        ClockType::time_point start;
+        size_t successes;
+        size_t failures;
+    };
+
+    static const size_t BUCKET_COUNT;
+
+    Bucket& get_bucket(ClockType::time_point now);
+    bool should_trip(ClockType::time_point now) const;
+    void set_state(State state, ClockType::time_point now);
+    void notify(State previous_state);
+
+    mutable std::mutex mutex_;
+    std::vector<Bucket> buckets_;
+    StateChangeCallback state_change_callback_;
+    State state_{State::CLOSED};
+    ClockType::time_point state_start_;
+    std::chrono::milliseconds window_size_;
+    std::chrono::milliseconds open_timeout_;
+    size_t minimum_requests_;
+    double failure_ratio_;
+    size_t probe_count_;
+    size_t probes_allowed_{0};
+    size_t probe_successes_{0};
+    size_t trip_count_{0};
+    unsigned open_priority_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_CIRCUIT_BREAKER_H
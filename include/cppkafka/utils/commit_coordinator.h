@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_COMMIT_COORDINATOR_H
+#define CPPKAFKA_COMMIT_COORDINATOR_H
+
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include <functional>
+#include "../consumer.h"
+#include "../message.h"
+#include "../topic_partition.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Commits source offsets only after the messages produced from them are acknowledged
+ *
+ * This class is meant to be used on consume-process-produce services. Every consumed message
+ * is registered via CommitCoordinator::track, which returns an opaque token that has to be
+ * set as the user data of the message(s) produced out of it. When the delivery report for
+ * a produced message is received, CommitCoordinator::acknowledge has to be called on it.
+ * If a produced message is given up on instead (e.g. its delivery failed and it won't be
+ * retried, or producing it threw), CommitCoordinator::release has to be called on it, as
+ * otherwise its partition's committable offset could never move past its source message.
+ *
+ * For each topic/partition, a committable watermark is kept: the offset following the last
+ * source message for which it and every previous one have been fully acknowledged. Commits
+ * are coalesced so that a single asynchronous commit containing every topic/partition that
+ * moved forward is performed once either enough messages were acknowledged or enough
+ * time has passed since the last commit.
+ *
+ * \code
+ * Consumer consumer(consumer_config);
+ * BufferedProducer<string> producer(producer_config);
+ * CommitCoordinator coordinator(consumer);
+ *
+ * // Acknowledge produced messages as their delivery reports arrive
+ * producer.set_produce_success_callback([&](const Message& msg) {
+ *     coordinator.acknowledge(msg);
+ * });
+ * // Give up on messages that fail to be delivered, without holding back the commits
+ * producer.set_produce_failure_callback([&](const Message& msg) {
+ *     log_failure(msg);
+ *     coordinator.release(msg);
+ *     return false;
+ * });
+ *
+ * while (running) {
+ *     Message msg = consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         string output = enrich(msg);
+ *         producer.produce(MessageBuilder("enriched").payload(output)
+ *                                                   .user_data(coordinator.track(msg)));
+ *     }
+ *     // Serve delivery reports and commit if needed
+ *     producer.get_producer().poll(std::chrono::milliseconds(0));
+ *     coordinator.try_commit();
+ * }
+ * \endcode
+ *
+ * When partitions are revoked, any messages still in flight for them would otherwise be
+ * processed again by their next owner. CommitCoordinator::drain (which can be set to run
+ * automatically on revocation via CommitCoordinator::set_drain_on_revocation) waits for
+ * them, commits the partitions' final offsets and only then lets them go.
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API CommitCoordinator {
+public:
+    static const size_t DEFAULT_COMMIT_BATCH_SIZE;
+    static const std::chrono::milliseconds DEFAULT_COMMIT_INTERVAL;
+
+    /**
+     * \brief Callback executed repeatedly while draining partitions
+     *
+     * This has to make progress on in-flight messages, e.g. by polling the producer so
+     * delivery reports are served and acknowledged.
+     */
+    using DrainCallback = std::function<void()>;
+
+    /**
+     * \brief Constructs a commit coordinator
+     *
+     * \param consumer The consumer used to commit offsets
+     */
+    CommitCoordinator(Consumer& consumer);
+
+    CommitCoordinator(const CommitCoordinator&) = delete;
+    CommitCoordinator& operator=(const CommitCoordinator&) = delete;
+
+    /**
+     * Restores the consumer's revocation callback if draining on revocation was enabled
+     */
+    ~CommitCoordinator();
+
+    /**
+     * \brief Starts tracking a consumed message
+     *
+     * The returned token has to be used as the user data for the message(s) produced out of
+     * this one. The token is valid until every expected acknowledgement has been received.
+     *
+     * If expected_acks is 0 (e.g. the message was filtered out), then the message is
+     * considered to be processed right away and null is returned.
+     *
+     * Messages for the same topic/partition must be tracked in offset order.
+     *
+     * \param message The consumed message
+     * \param expected_acks The number of produced messages that depend on this one
+     */
+    void* track(const Message& message, size_t expected_acks = 1);
+
+    /**
+     * \brief Starts tracking a consumed topic/partition/offset
+     *
+     * \sa CommitCoordinator::track
+     *
+     * \param topic_partition The topic/partition/offset of the consumed message
+     * \param expected_acks The number of produced messages that depend on this one
+     */
+    void* track(const TopicPartition& topic_partition, size_t expected_acks = 1);
+
+    /**
+     * \brief Acknowledges a produced message
+     *
+     * The message's private data must be a token returned by CommitCoordinator::track.
+     * Messages without private data are ignored.
+     *
+     * \param message The message for which a delivery report was received
+     */
+    void acknowledge(const Message& message);
+
+    /**
+     * \brief Acknowledges a token returned by CommitCoordinator::track
+     *
+     * \param token The token to be acknowledged
+     */
+    void acknowledge(void* token);
+
+    /**
+     * \brief Gives up on a produced message
+     *
+     * This resolves one of the token's expected acknowledgements without the message being
+     * delivered, so the source message no longer holds back its partition's committable
+     * offset. The source message is then committed as if it had been processed, so the
+     * failure has to be dealt with elsewhere (e.g. logged or dead lettered).
+     *
+     * The message's private data must be a token returned by CommitCoordinator::track.
+     * Messages without private data are ignored.
+     *
+     * \param message The message that won't be delivered
+     */
+    void release(const Message& message);
+
+    /**
+     * \brief Gives up on one of the acknowledgements of a token returned by track
+     *
+     * \sa CommitCoordinator::release
+     *
+     * \param token The token to be released
+     */
+    void release(void* token);
+
+    /**
+     * \brief Commits if either the batch size or the commit interval was reached
+     *
+     * Returns true iff a commit was performed
+     */
+    bool try_commit();
+
+    /**
+     * \brief Commits every topic/partition whose committable offset moved forward
+     *
+     * This translates into a single call to Consumer::async_commit, if there's anything
+     * to be committed. If that call throws, the offsets are kept and will be committed on
+     * the next attempt.
+     */
+    void commit();
+
+    /**
+     * \brief Stops tracking the given topic/partitions
+     *
+     * This should be called when partitions are revoked. Their committable offsets won't
+     * be committed anymore. Tokens for them that are still in flight can still be
+     * acknowledged safely, but doing so has no effect.
+     *
+     * \param topic_partitions The topic/partitions to be discarded
+     */
+    void discard(const TopicPartitionList& topic_partitions);
+
+    /**
+     * \brief Waits for the in-flight messages of the given partitions and releases them
+     *
+     * The callback is executed until every message tracked for these partitions has been
+     * fully acknowledged or the timeout expires. Then, the partitions' committable offsets
+     * are committed synchronously and the partitions are discarded.
+     *
+     * If the timeout expires, whatever was acknowledged in order is still committed, so only
+     * the messages that were still in flight will be processed again by the partitions'
+     * next owner.
+     *
+     * Returns true iff every in-flight message was acknowledged before the timeout.
+     *
+     * \param topic_partitions The topic/partitions to be drained
+     * \param timeout The maximum time to wait for in-flight messages
+     * \param callback The callback to be executed while waiting
+     */
+    bool drain(const TopicPartitionList& topic_partitions, std::chrono::milliseconds timeout,
+               const DrainCallback& callback);
+
+    /**
+     * \brief Drains revoked partitions before they're released
+     *
+     * This sets the consumer's revocation callback (the previous one is still executed
+     * first) so that CommitCoordinator::drain is called on every revoked partition. Since
+     * the consumer only unassigns partitions after the revocation callback returns, they're
+     * not released until they have been drained.
+     *
+     * The timeout should be well below the consumer's max.poll.interval.ms. If committing
+     * fails (e.g. because the group is already rebalancing), partitions are released anyway.
+     *
+     * \param timeout The maximum time to wait for in-flight messages
+     * \param callback The callback to be executed while waiting
+     */
+    void set_drain_on_revocation(std::chrono::milliseconds timeout, DrainCallback callback);
+
+    /**
+     * \brief Gets the committable offsets that haven't been committed yet
+     */
+    TopicPartitionList get_committable_offsets() const;
+
+    /**
+     * Gets the number of tracked messages that haven't been fully acknowledged
+     */
+    size_t get_pending_count() const;
+
+    /**
+     * Gets the number of produced messages that were released rather than acknowledged
+     */
+    size_t get_released_count() const;
+
+    /**
+     * \brief Gets the number of tracked messages that haven't been fully acknowledged for
+     * the given topic/partitions
+     *
+     * \param topic_partitions The topic/partitions
+     */
+    size_t get_pending_count(const TopicPartitionList& topic_partitions) const;
+
+    /**
+     * \brief Sets the number of acknowledged messages that triggers a commit
+     *
+     * \param value The value to be set
+     */
+    void set_commit_batch_size(size_t value);
+
+    /**
+     * \brief Sets the maximum time between commits
+     *
+     * \param value The value to be set
+     */
+    void set_commit_interval(std::chrono::milliseconds value);
+private:
+    using ClockType = std::chrono::steady_clock;
+
+    struct PartitionState;
+
+    struct PendingOffset {
+        PendingOffset(int64_t offset, size_t acks, PartitionState& state);
+
+        int64_t offset;
+        size_t remaining_acks;
+        PartitionState* owner;
+    };
+
+    struct PartitionState {
+        std::deque<PendingOffset> offsets;
+        int64_t next_offset{TopicPartition::OFFSET_INVALID};
+        bool needs_commit{false};
+        bool discarded{false};
+    };
+
+    using PartitionStatePtr = std::unique_ptr<PartitionState>;
+
+    void resolve(void* token);
+    void advance(PartitionState& state);
+
+    Consumer& consumer_;
+    std::map<TopicPartition, PartitionStatePtr> partitions_;
+    // Discarded partitions that still have tokens in flight
+    std::vector<PartitionStatePtr> discarded_partitions_;
+    size_t commit_batch_size_;
+    std::chrono::milliseconds commit_interval_;
+    ClockType::time_point last_commit_;
+    size_t acked_since_commit_{0};
+    size_t pending_count_{0};
+    size_t released_count_{0};
+    Consumer::RevocationCallback original_revocation_callback_;
+    bool drain_on_revocation_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_COMMIT_COORDINATOR_H
@@ -174,6 +174,8 @@ public:
     void process_event();
 private:
     void on_assignment(TopicPartitionList& topic_partitions);
+    void on_revocation(const TopicPartitionList& topic_partitions);
+    bool is_cooperative() const;
 
     Consumer& consumer_;
     KeyDecoder key_decoder_;
@@ -182,6 +184,7 @@ private:
     ErrorHandler error_handler_;
     std::map<TopicPartition, int64_t> partition_offsets_;
     Consumer::AssignmentCallback original_assignment_callback_;
+    Consumer::RevocationCallback original_revocation_callback_;
 };
 
 // CompactedTopicEvent
@@ -237,17 +240,22 @@ const V& CompactedTopicEvent<K, V>::get_value() const {
 template <typename K, typename V>
 CompactedTopicProcessor<K, V>::CompactedTopicProcessor(Consumer& consumer) 
 : consumer_(consumer) {
-    // Save the current assignment callback and assign ours
+    // Save the current assignment/revocation callbacks and assign ours
     original_assignment_callback_ = consumer_.get_assignment_callback();
+    original_revocation_callback_ = consumer_.get_revocation_callback();
     consumer_.set_assignment_callback([&](TopicPartitionList& topic_partitions) {
         on_assignment(topic_partitions);
     });
+    consumer_.set_revocation_callback([&](const TopicPartitionList& topic_partitions) {
+        on_revocation(topic_partitions);
+    });
 }
 
 template <typename K, typename V>
 CompactedTopicProcessor<K, V>::~CompactedTopicProcessor() {
-    // Restore previous assignment callback
+    // Restore previous assignment/revocation callbacks
     consumer_.set_assignment_callback(original_assignment_callback_);
+    consumer_.set_revocation_callback(original_revocation_callback_);
 }
 
 template <typename K, typename V>
@@ -324,6 +332,11 @@ void CompactedTopicProcessor<K, V>::on_assignment(TopicPartitionList& topic_part
         // Populate this set
         partitions_found.insert(topic_partition);
     }
+    // On cooperative rebalances we only get the partitions being added, the rest are still
+    // ours. Revoked ones are cleared in on_revocation instead
+    if (is_cooperative()) {
+        return;
+    }
     // Clear our cache: remove any entries for topic/partitions that aren't assigned to us now.
     // Emit a CLEAR_ELEMENTS event for each topic/partition that is gone
     auto iter = partition_offsets_.begin();
@@ -340,6 +353,35 @@ void CompactedTopicProcessor<K, V>::on_assignment(TopicPartitionList& topic_part
     }
 }
 
+template <typename K, typename V>
+void CompactedTopicProcessor<K, V>::on_revocation(const TopicPartitionList& topic_partitions) {
+    if (original_revocation_callback_) {
+        original_revocation_callback_(topic_partitions);
+    }
+    // On eager rebalances everything is revoked and we wait for the following assignment to
+    // see which partitions we keep. On cooperative ones, these are gone for good
+    if (!is_cooperative()) {
+        return;
+    }
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        auto iter = partition_offsets_.find(topic_partition);
+        if (iter != partition_offsets_.end()) {
+            event_handler_({ Event::CLEAR_ELEMENTS, topic_partition.get_topic(),
+                             topic_partition.get_partition() });
+            partition_offsets_.erase(iter);
+        }
+    }
+}
+
+template <typename K, typename V>
+bool CompactedTopicProcessor<K, V>::is_cooperative() const {
+#if RD_KAFKA_VERSION >= 0x010600ff
+    return consumer_.is_cooperative();
+#else
+    return false;
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+}
+
 } // cppkafka
 
 #endif // CPPKAFKA_COMPACTED_TOPIC_PROCESSOR_H
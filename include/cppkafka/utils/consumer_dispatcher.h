@@ -30,8 +30,16 @@
 #ifndef CPPKAFKA_CONSUMER_DISPATCHER_H
 #define CPPKAFKA_CONSUMER_DISPATCHER_H
 
+#include <map>
 #include <tuple>
+#include <limits>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <exception>
+#include <functional>
 #include "../consumer.h"
+#include "../producer.h"
 #include "backoff_performer.h"
 
 namespace cppkafka {
@@ -68,6 +76,27 @@ namespace cppkafka {
  * * Timeout: void(BasicConsumerDispatcher::Timeout)
  * * Error: void(Error)
  * * EOF: void(BasicConsumerDispatcher::EndOfFile, TopicPartition)
+ *
+ * When messages from different topics need different handling, a TopicRouter can be used
+ * as the message callback. It resolves every topic to its handler once, so messages are
+ * routed without comparing topic names.
+ *
+ * By default, any exception thrown by the message callback is propagated and stops the
+ * dispatcher. If a dead letter queue is set, failed messages are retried instead: the
+ * consumer seeks back to the failed message so it's consumed again and once it has failed
+ * the maximum number of attempts, it's produced to the dead letter topic (with headers
+ * describing the error and where it came from) rather than given to the callback again.
+ * Once its delivery report confirms it was written, consumption of the partition continues
+ * past it as if it had been processed.
+ *
+ * \code
+ * ConsumerDispatcher dispatcher(consumer);
+ * dispatcher.set_dead_letter_queue(producer, "some_topic.dlq", 3);
+ * dispatcher.run([](Message msg) {
+ *     // Messages this throws on 3 times end up in some_topic.dlq
+ *     process(msg);
+ * });
+ * \endcode
  */
 template <typename ConsumerType>
 class CPPKAFKA_API BasicConsumerDispatcher {
@@ -92,6 +121,20 @@ public:
      */
     struct Event {};
 
+    /**
+     * Callback executed after a message is routed to the dead letter queue
+     */
+    using DeadLetterCallback = std::function<void(const Message&, const std::string&)>;
+
+    /**
+     * The names of the headers set on messages routed to the dead letter queue
+     */
+    static const std::string DEAD_LETTER_ERROR_HEADER;
+    static const std::string DEAD_LETTER_TOPIC_HEADER;
+    static const std::string DEAD_LETTER_PARTITION_HEADER;
+    static const std::string DEAD_LETTER_OFFSET_HEADER;
+    static const std::string DEAD_LETTER_ATTEMPTS_HEADER;
+
     /**
      * Constructs a consumer dispatcher over the given consumer
      *
@@ -116,6 +159,44 @@ public:
      * progress, then this will stop after the current call returns
      */
     void stop();
+
+    /**
+     * \brief Routes messages the message callback keeps failing on to a dead letter topic
+     *
+     * Attempts are tracked in memory, so they start over if the process is restarted or the
+     * partition is revoked. While running, the dispatcher wraps the consumer's revocation
+     * callback to forget the attempts on revoked partitions, calling the original one after.
+     *
+     * Messages are produced synchronously: the producer is flushed and the message's
+     * delivery report is checked before consumption moves past it. If it couldn't be written,
+     * the consumer seeks back to the message so it's dead lettered again the next time it's
+     * consumed, and a HandleException is thrown out of run. Since a timed out message may
+     * still be written later, the dead letter topic can end up with duplicates.
+     *
+     * The producer must have been constructed with a delivery report callback, as that's
+     * what enables the delivery reports that are checked. An Exception is thrown otherwise.
+     *
+     * \param producer The producer used to write to the dead letter topic
+     * \param topic The dead letter topic
+     * \param max_attempts The number of times a message can fail before it's dead lettered
+     */
+    void set_dead_letter_queue(Producer& producer, std::string topic, unsigned max_attempts);
+
+    /**
+     * \brief Sets the callback executed after a message is routed to the dead letter queue
+     *
+     * This can be used to commit the message's offset, as it's now considered processed.
+     * The callback is given the message and the error it failed with. It's only executed
+     * once the message's delivery report shows it was written to the dead letter topic.
+     *
+     * \param callback The callback to be set
+     */
+    void set_dead_letter_callback(DeadLetterCallback callback);
+
+    /**
+     * Gets the number of messages routed to the dead letter queue
+     */
+    size_t get_dead_letter_count() const;
 private:
     // Define the types we need for each type of callback
     using OnMessageArgs = std::tuple<Message>;
@@ -147,7 +228,7 @@ private:
     // Simple RAII wrapper for pausing/resuming
     class Pauser {
     public:
-        Pauser(Consumer& consumer, const TopicPartitionList& topic_partitions)
+        Pauser(ConsumerType& consumer, const TopicPartitionList& topic_partitions)
         : consumer_(consumer), topic_partitions_(topic_partitions) {
             consumer_.pause_partitions(topic_partitions_);
         }
@@ -159,7 +240,7 @@ private:
         Pauser(const Pauser&) = delete;
         Pauser& operator=(const Pauser&) = delete;
     private:
-        Consumer& consumer_;
+        ConsumerType& consumer_;
         TopicPartitionList topic_partitions_;
     };
 
@@ -306,8 +387,62 @@ private:
         }
     }
 
+    // Topic, partition and offset of a failed message
+    using MessageId = std::tuple<std::string, int, int64_t>;
+
+    struct FailedMessage {
+        unsigned attempts;
+        std::string error;
+    };
+
+    static Consumer& get_consumer(Consumer& consumer) {
+        return consumer;
+    }
+
+    template <typename T>
+    static Consumer& get_consumer(T& consumer) {
+        return consumer.get_consumer();
+    }
+
+    // Chains a callback before the consumer's revocation callback while alive
+    class RevocationHook {
+    public:
+        RevocationHook(Consumer& consumer, Consumer::RevocationCallback callback)
+        : consumer_(consumer), original_callback_(consumer.get_revocation_callback()) {
+            const Consumer::RevocationCallback original_callback = original_callback_;
+            consumer_.set_revocation_callback([=](const TopicPartitionList& partitions) {
+                callback(partitions);
+                if (original_callback) {
+                    original_callback(partitions);
+                }
+            });
+        }
+
+        ~RevocationHook() {
+            consumer_.set_revocation_callback(original_callback_);
+        }
+
+        RevocationHook(const RevocationHook&) = delete;
+        RevocationHook& operator=(const RevocationHook&) = delete;
+    private:
+        Consumer& consumer_;
+        Consumer::RevocationCallback original_callback_;
+    };
+
+    template <typename Functor, typename... Functors>
+    void process_message_with_retries(const Functor& callback, Message msg,
+                                      const Functors&... functors);
+    void dead_letter(const Message& msg, const FailedMessage& failed_message);
+    void forget_failed_messages(const TopicPartitionList& topic_partitions);
+
     ConsumerType& consumer_;
     bool running_;
+    Producer* dead_letter_producer_{nullptr};
+    std::string dead_letter_topic_;
+    unsigned max_attempts_{0};
+    DeadLetterCallback dead_letter_callback_;
+    std::map<MessageId, FailedMessage> failed_messages_;
+    size_t dead_letter_count_{0};
 };
 
 using ConsumerDispatcher = BasicConsumerDispatcher<Consumer>;
@@ -323,6 +458,48 @@ void BasicConsumerDispatcher<ConsumerType>::stop() {
     running_ = false;
 }
 
+template <typename ConsumerType>
+const std::string BasicConsumerDispatcher<ConsumerType>::DEAD_LETTER_ERROR_HEADER =
+    "cppkafka-dlq-error";
+
+template <typename ConsumerType>
+const std::string BasicConsumerDispatcher<ConsumerType>::DEAD_LETTER_TOPIC_HEADER =
+    "cppkafka-dlq-topic";
+
+template <typename ConsumerType>
+const std::string BasicConsumerDispatcher<ConsumerType>::DEAD_LETTER_PARTITION_HEADER =
+    "cppkafka-dlq-partition";
+
+template <typename ConsumerType>
+const std::string BasicConsumerDispatcher<ConsumerType>::DEAD_LETTER_OFFSET_HEADER =
+    "cppkafka-dlq-offset";
+
+template <typename ConsumerType>
+const std::string BasicConsumerDispatcher<ConsumerType>::DEAD_LETTER_ATTEMPTS_HEADER =
+    "cppkafka-dlq-attempts";
+
+template <typename ConsumerType>
+void BasicConsumerDispatcher<ConsumerType>::set_dead_letter_queue(Producer& producer,
+                                                                  std::string topic,
+                                                                  unsigned max_attempts) {
+    if (!producer.get_configuration().get_delivery_report_callback()) {
+        throw Exception("The dead letter queue producer needs a delivery report callback");
+    }
+    dead_letter_producer_ = &producer;
+    dead_letter_topic_ = std::move(topic);
+    max_attempts_ = std::max(max_attempts, 1u);
+}
+
+template <typename ConsumerType>
+void BasicConsumerDispatcher<ConsumerType>::set_dead_letter_callback(DeadLetterCallback callback) {
+    dead_letter_callback_ = std::move(callback);
+}
+
+template <typename ConsumerType>
+size_t BasicConsumerDispatcher<ConsumerType>::get_dead_letter_count() const {
+    return dead_letter_count_;
+}
+
 template <typename ConsumerType>
 void BasicConsumerDispatcher<ConsumerType>::handle_error(Error error) {
     throw ConsumerException(error);
@@ -346,6 +523,13 @@ void BasicConsumerDispatcher<ConsumerType>::run(const Args&... args) {
     const auto on_timeout = find_matching_functor<OnTimeoutArgs>(args..., &self::handle_timeout);
     const auto on_event = find_matching_functor<OnEventArgs>(args..., &self::handle_event);
 
+    std::unique_ptr<RevocationHook> revocation_hook;
+    if (dead_letter_producer_) {
+        using std::placeholders::_1;
+        revocation_hook.reset(new RevocationHook(get_consumer(consumer_),
+            std::bind(&BasicConsumerDispatcher::forget_failed_messages, this, _1)));
+    }
+
     running_ = true;
     while (running_) {
         Message msg = consumer_.poll();
@@ -360,6 +544,9 @@ void BasicConsumerDispatcher<ConsumerType>::run(const Args&... args) {
                 on_error(msg.get_error());
             }
         }
+        else if (dead_letter_producer_) {
+            process_message_with_retries(on_message, std::move(msg), args...);
+        }
         else {
             process_message(on_message, std::move(msg), args...);
         }
@@ -367,6 +554,94 @@ void BasicConsumerDispatcher<ConsumerType>::run(const Args&... args) {
     }
 }
 
+template <typename ConsumerType>
+template <typename Functor, typename... Functors>
+void BasicConsumerDispatcher<ConsumerType>::
+process_message_with_retries(const Functor& callback, Message msg, const Functors&... functors) {
+    // Only look the message up if something has failed, so this is free otherwise
+    if (!failed_messages_.empty()) {
+        auto iter = failed_messages_.find(MessageId(msg.get_topic(), msg.get_partition(),
+                                                    msg.get_offset()));
+        if (iter != failed_messages_.end() && iter->second.attempts >= max_attempts_) {
+            try {
+                dead_letter(msg, iter->second);
+            }
+            catch (...) {
+                // Keep it pending so it's dead lettered when it's consumed again
+                get_consumer(consumer_).seek({ msg.get_topic(), msg.get_partition(),
+                                               msg.get_offset() });
+                throw;
+            }
+            failed_messages_.erase(iter);
+            return;
+        }
+    }
+    const TopicPartition topic_partition(msg.get_topic(), msg.get_partition(), msg.get_offset());
+    std::string error;
+    try {
+        process_message(callback, std::move(msg), functors...);
+        if (!failed_messages_.empty()) {
+            failed_messages_.erase(MessageId(topic_partition.get_topic(),
+                                             topic_partition.get_partition(),
+                                             topic_partition.get_offset()));
+        }
+        return;
+    }
+    catch (const std::exception& ex) {
+        error = ex.what();
+    }
+    catch (...) {
+        error = "Unknown error";
+    }
+    FailedMessage& failed_message = failed_messages_[MessageId(topic_partition.get_topic(),
+                                                               topic_partition.get_partition(),
+                                                               topic_partition.get_offset())];
+    failed_message.attempts++;
+    failed_message.error = std::move(error);
+    // Consume it again. Once it's out of attempts it will be dead lettered when it comes back
+    get_consumer(consumer_).seek(topic_partition);
+}
+
+template <typename ConsumerType>
+void BasicConsumerDispatcher<ConsumerType>::dead_letter(const Message& msg,
+                                                        const FailedMessage& failed_message) {
+    MessageBuilder builder(dead_letter_topic_);
+    builder.key(msg.get_key()).payload(msg.get_payload());
+    builder.header(DEAD_LETTER_ERROR_HEADER, failed_message.error)
+           .header(DEAD_LETTER_TOPIC_HEADER, msg.get_topic())
+           .header(DEAD_LETTER_PARTITION_HEADER, std::to_string(msg.get_partition()))
+           .header(DEAD_LETTER_OFFSET_HEADER, std::to_string(msg.get_offset()))
+           .header(DEAD_LETTER_ATTEMPTS_HEADER, std::to_string(failed_message.attempts));
+    // Shared with the delivery callback, as it may run after this returns if flushing fails
+    auto delivery_error = std::make_shared<Error>(RD_KAFKA_RESP_ERR__TIMED_OUT);
+    dead_letter_producer_->produce(builder, [delivery_error](const Message& report) {
+        *delivery_error = report.get_error();
+    });
+    dead_letter_producer_->flush();
+    if (*delivery_error) {
+        throw HandleException(*delivery_error);
+    }
+    dead_letter_count_++;
+    if (dead_letter_callback_) {
+        dead_letter_callback_(msg, failed_message.error);
+    }
+}
+
+template <typename ConsumerType>
+void BasicConsumerDispatcher<ConsumerType>::
+forget_failed_messages(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        const std::string& topic = topic_partition.get_topic();
+        const int partition = topic_partition.get_partition();
+        auto iter = failed_messages_.lower_bound(
+            MessageId(topic, partition, std::numeric_limits<int64_t>::min()));
+        while (iter != failed_messages_.end() && std::get<0>(iter->first) == topic &&
+               std::get<1>(iter->first) == partition) {
+            iter = failed_messages_.erase(iter);
+        }
+    }
+}
+
 } // cppkafka
 
 #endif // CPPKAFKA_CONSUMER_DISPATCHER_H
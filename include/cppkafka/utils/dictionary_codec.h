@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_DICTIONARY_CODEC_H
+#define CPPKAFKA_DICTIONARY_CODEC_H
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include "../buffer.h"
+#include "../macros.h"
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace cppkafka {
+
+/**
+ * \brief Compresses and decompresses payloads using shared zstd dictionaries
+ *
+ * Small payloads (e.g. short JSON documents) barely compress on their own, and batch level
+ * compression doesn't help much when batches are small. Compressing each payload using a
+ * dictionary trained on similar payloads (see DictionaryTrainer) usually yields much better
+ * ratios.
+ *
+ * Every compressed payload is a regular zstd frame, which contains the id of the dictionary
+ * used to compress it. This means consumers only need to know about the dictionaries, not
+ * about which one was used for each message. Dictionaries that aren't known when a payload
+ * is decompressed can be fetched on demand by setting a dictionary loader, after which they
+ * are cached.
+ *
+ * \code
+ * // Producer side
+ * DictionaryCodec codec;
+ * uint32_t id = codec.add_dictionary(dictionary);
+ * codec.set_compression_dictionary(id);
+ * producer.produce(MessageBuilder("events").payload(codec.compress(payload)));
+ *
+ * // Consumer side
+ * DictionaryCodec codec;
+ * codec.set_dictionary_loader([](uint32_t id) {
+ *     return load_dictionary_from_somewhere(id);
+ * });
+ * Message msg = consumer.poll();
+ * const Buffer& payload = codec.decompress(msg.get_payload());
+ * \endcode
+ *
+ * This class is only available when cppkafka is built using CPPKAFKA_ENABLE_ZSTD. It is not
+ * thread safe.
+ */
+class CPPKAFKA_API DictionaryCodec {
+public:
+    static const int DEFAULT_COMPRESSION_LEVEL;
+    static const size_t DEFAULT_MAXIMUM_PAYLOAD_SIZE;
+
+    /**
+     * \brief Callback used to fetch a dictionary that isn't known yet
+     *
+     * It should return the dictionary's contents, or an empty vector if it can't be found
+     */
+    using DictionaryLoader = std::function<std::vector<uint8_t>(uint32_t)>;
+
+    /**
+     * Constructs a dictionary codec
+     */
+    DictionaryCodec();
+
+    /**
+     * \brief Adds a dictionary
+     *
+     * The dictionary has to have been trained by zstd (e.g. using DictionaryTrainer), as its
+     * id is read from it. An Exception is thrown otherwise.
+     *
+     * \param dictionary The dictionary to be added
+     *
+     * \return The dictionary's id
+     */
+    uint32_t add_dictionary(const Buffer& dictionary);
+
+    /**
+     * \brief Indicates whether the dictionary with the given id is known
+     *
+     * \param id The dictionary id
+     */
+    bool has_dictionary(uint32_t id) const;
+
+    /**
+     * \brief Sets the dictionary used to compress payloads
+     *
+     * The dictionary must have been added before. If no dictionary is set, payloads are
+     * compressed without one.
+     *
+     * \param id The dictionary id
+     */
+    void set_compression_dictionary(uint32_t id);
+
+    /**
+     * \brief Sets the compression level
+     *
+     * The default is DEFAULT_COMPRESSION_LEVEL
+     *
+     * \param value The value to be set
+     */
+    void set_compression_level(int value);
+
+    /**
+     * \brief Sets the maximum size of a decompressed payload
+     *
+     * Decompressing a payload larger than this will throw an Exception. The default is
+     * DEFAULT_MAXIMUM_PAYLOAD_SIZE.
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_payload_size(size_t value);
+
+    /**
+     * \brief Sets the dictionary loader
+     *
+     * \param loader The loader to be set
+     */
+    void set_dictionary_loader(DictionaryLoader loader);
+
+    /**
+     * \brief Compresses a payload
+     *
+     * The returned buffer points to memory owned by this object and is valid until the next
+     * call to compress.
+     *
+     * \param payload The payload to be compressed
+     */
+    Buffer compress(const Buffer& payload);
+
+    /**
+     * \brief Decompresses a payload
+     *
+     * The returned buffer points to memory owned by this object and is valid until the next
+     * call to decompress. An Exception is thrown if the payload is not a valid zstd frame or
+     * the dictionary it was compressed with can't be found.
+     *
+     * \param payload The payload to be decompressed
+     */
+    Buffer decompress(const Buffer& payload);
+private:
+    using CompressionContextPtr = std::unique_ptr<ZSTD_CCtx_s, void(*)(ZSTD_CCtx_s*)>;
+    using DecompressionContextPtr = std::unique_ptr<ZSTD_DCtx_s, void(*)(ZSTD_DCtx_s*)>;
+    using CompressionDictionaryPtr = std::unique_ptr<ZSTD_CDict_s, void(*)(ZSTD_CDict_s*)>;
+    using DecompressionDictionaryPtr = std::unique_ptr<ZSTD_DDict_s, void(*)(ZSTD_DDict_s*)>;
+
+    struct Dictionary {
+        Dictionary();
+
+        std::vector<uint8_t> data;
+        // Only created if it's used for compression, as it depends on the compression level
+        CompressionDictionaryPtr compression_dictionary;
+        DecompressionDictionaryPtr decompression_dictionary;
+    };
+
+    Dictionary& get_dictionary(uint32_t id);
+
+    CompressionContextPtr compression_context_;
+    DecompressionContextPtr decompression_context_;
+    std::map<uint32_t, Dictionary> dictionaries_;
+    Dictionary* compression_dictionary_{nullptr};
+    DictionaryLoader dictionary_loader_;
+    std::vector<uint8_t> compression_buffer_;
+    std::vector<uint8_t> decompression_buffer_;
+    int compression_level_;
+    size_t maximum_payload_size_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_DICTIONARY_CODEC_H
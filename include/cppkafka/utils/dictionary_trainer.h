@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_DICTIONARY_TRAINER_H
+#define CPPKAFKA_DICTIONARY_TRAINER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <random>
+#include "../buffer.h"
+#include "../macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Trains zstd dictionaries out of sampled payloads
+ *
+ * Payloads are added as they're produced or consumed and a random sample of them is kept,
+ * bounded by a maximum number of bytes. Once enough samples are collected, a dictionary can
+ * be trained out of them and then used by a DictionaryCodec.
+ *
+ * \code
+ * DictionaryTrainer trainer;
+ * while (trainer.get_sample_count() < 10000) {
+ *     Message msg = consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         trainer.add_sample(msg.get_payload());
+ *     }
+ * }
+ * vector<uint8_t> dictionary = trainer.train();
+ * \endcode
+ *
+ * This class is only available when cppkafka is built using CPPKAFKA_ENABLE_ZSTD. It is not
+ * thread safe.
+ */
+class CPPKAFKA_API DictionaryTrainer {
+public:
+    static const size_t DEFAULT_DICTIONARY_SIZE;
+    static const size_t DEFAULT_MAXIMUM_SAMPLE_SIZE;
+
+    /**
+     * Constructs a dictionary trainer
+     */
+    DictionaryTrainer();
+
+    /**
+     * \brief Adds a payload to the sample
+     *
+     * Once the sample is full, payloads randomly replace the ones already in it so that the
+     * sample stays representative of every payload added.
+     *
+     * \param payload The payload to be added
+     */
+    void add_sample(const Buffer& payload);
+
+    /**
+     * \brief Trains a dictionary out of the current sample
+     *
+     * An Exception is thrown if training fails (e.g. if there's not enough samples).
+     *
+     * \param dictionary_size The maximum size of the dictionary
+     */
+    std::vector<uint8_t> train(size_t dictionary_size = DEFAULT_DICTIONARY_SIZE) const;
+
+    /**
+     * \brief Sets the maximum number of bytes kept in the sample
+     *
+     * The default is DEFAULT_MAXIMUM_SAMPLE_SIZE.
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_sample_size(size_t value);
+
+    /**
+     * Gets the number of payloads in the sample
+     */
+    size_t get_sample_count() const;
+
+    /**
+     * Gets the number of bytes in the sample
+     */
+    size_t get_sample_size() const;
+
+    /**
+     * Removes every payload in the sample
+     */
+    void clear();
+private:
+    std::vector<std::string> samples_;
+    std::mt19937 random_engine_;
+    size_t sample_size_{0};
+    size_t payloads_seen_{0};
+    size_t maximum_sample_size_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_DICTIONARY_TRAINER_H
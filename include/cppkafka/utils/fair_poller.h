@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_FAIR_POLLER_H
+#define CPPKAFKA_FAIR_POLLER_H
+
+#include <map>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "../consumer.h"
+#include "../queue.h"
+#include "../topic_partition.h"
+#include "../topic_partition_list.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Consumes assigned partitions fairly, regardless of their backlog
+ *
+ * When consuming from the consumer queue, a partition with a large backlog can fill it up and
+ * delay messages from every other partition. This class disables the forwarding of each
+ * assigned partition's queue into the consumer queue and polls them one by one instead,
+ * giving each of them a quantum every time its turn comes:
+ *
+ * * Round robin: the quantum is the maximum number of messages consumed from a partition
+ * before moving to the next one.
+ * * Deficit round robin: the quantum is a number of bytes (key plus payload). A partition
+ * keeps being consumed while it has credit left, and any message larger than its remaining
+ * credit is paid for in its next turns. Partitions with empty queues lose their credit.
+ *
+ * The consumer queue, which still receives rebalance events and errors, is polled once
+ * after every round. The number of messages and bytes consumed from every partition are
+ * tracked so fairness can be verified.
+ *
+ * \code
+ * Consumer consumer(config);
+ * FairPoller poller(consumer, FairPoller::Mode::DEFICIT_ROUND_ROBIN);
+ * poller.set_default_quantum(16 * 1024);
+ * consumer.subscribe({ "tenants" });
+ *
+ * while (true) {
+ *     Message msg = poller.poll();
+ *     ...
+ * }
+ * \endcode
+ *
+ * Like PriorityPoller, this can be used with BasicConsumerDispatcher as
+ * BasicConsumerDispatcher<FairPoller>. Partitions are taken over when assigned via the
+ * consumer's assignment callback (any previously set callbacks are still executed) as well
+ * as the ones already assigned when constructing it.
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API FairPoller {
+public:
+    /**
+     * The scheduling algorithm used
+     */
+    enum class Mode {
+        ROUND_ROBIN,
+        DEFICIT_ROUND_ROBIN
+    };
+
+    /**
+     * Number of messages and bytes consumed from a partition
+     */
+    struct ServiceCount {
+        uint64_t messages;
+        uint64_t bytes;
+    };
+
+    /**
+     * The default quantum in round robin mode, in messages
+     */
+    static const size_t DEFAULT_MESSAGE_QUANTUM;
+
+    /**
+     * The default quantum in deficit round robin mode, in bytes
+     */
+    static const size_t DEFAULT_BYTE_QUANTUM;
+
+    /**
+     * The default time spent waiting on the consumer queue when no partition has messages
+     */
+    static const std::chrono::milliseconds DEFAULT_IDLE_WAIT;
+
+    /**
+     * \brief Constructs a fair poller
+     *
+     * \param consumer The consumer to be used
+     * \param mode The scheduling algorithm
+     */
+    FairPoller(Consumer& consumer, Mode mode = Mode::ROUND_ROBIN);
+
+    FairPoller(const FairPoller&) = delete;
+    FairPoller& operator=(const FairPoller&) = delete;
+
+    /**
+     * Restores the consumer's callbacks and every partition's forwarding
+     */
+    ~FairPoller();
+
+    /**
+     * \brief Sets the quantum used for partitions without a specific one
+     *
+     * \param value The quantum, in messages or bytes depending on the mode
+     */
+    void set_default_quantum(size_t value);
+
+    /**
+     * \brief Sets the quantum of a specific partition
+     *
+     * \param topic_partition The topic/partition
+     * \param value The quantum, in messages or bytes depending on the mode
+     */
+    void set_quantum(const TopicPartition& topic_partition, size_t value);
+
+    /**
+     * \brief Sets the maximum time spent blocked when no partition has messages
+     *
+     * \param value The value to be set
+     */
+    void set_idle_wait(std::chrono::milliseconds value);
+
+    /**
+     * \brief Polls for a message using the consumer's timeout
+     */
+    Message poll();
+
+    /**
+     * \brief Polls for a message
+     *
+     * \param timeout The maximum time to wait for a message
+     */
+    Message poll(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Gets the number of messages and bytes consumed from a partition
+     *
+     * Counts are kept for as long as the partition is assigned.
+     *
+     * \param topic_partition The topic/partition
+     */
+    ServiceCount get_service_count(const TopicPartition& topic_partition) const;
+
+    /**
+     * Gets the number of messages and bytes consumed from every assigned partition
+     */
+    std::map<TopicPartition, ServiceCount> get_service_counts() const;
+
+    /**
+     * Resets every service count to 0
+     */
+    void reset_service_counts();
+
+    /**
+     * Pauses the given partitions (see Consumer::pause_partitions)
+     */
+    void pause_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Resumes the given partitions (see Consumer::resume_partitions)
+     */
+    void resume_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Gets the consumer's assignment (see Consumer::get_assignment)
+     */
+    TopicPartitionList get_assignment() const;
+
+    /**
+     * Gets the consumer
+     */
+    Consumer& get_consumer();
+private:
+    struct Partition {
+        TopicPartition topic_partition;
+        Queue queue;
+        int64_t deficit;
+        ServiceCount service_count;
+    };
+
+    void on_assignment(const TopicPartitionList& topic_partitions);
+    void on_revocation(const TopicPartitionList& topic_partitions);
+    Message poll_partitions();
+    void start_turn(Partition& partition);
+    size_t get_quantum(const TopicPartition& topic_partition) const;
+
+    Consumer& consumer_;
+    Mode mode_;
+    Queue consumer_queue_;
+    std::vector<Partition> partitions_;
+    std::map<TopicPartition, size_t> quantums_;
+    Consumer::AssignmentCallback original_assignment_callback_;
+    Consumer::RevocationCallback original_revocation_callback_;
+    size_t default_quantum_;
+    std::chrono::milliseconds idle_wait_;
+    size_t current_partition_{0};
+    bool served_in_round_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_FAIR_POLLER_H
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_HOT_KEY_TRACKER_H
+#define CPPKAFKA_HOT_KEY_TRACKER_H
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "../message.h"
+#include "../message_builder.h"
+#include "../topic_partition.h"
+#include "../detail/space_saving.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Detects hot keys and partition skew in produced or consumed traffic
+ *
+ * Every recorded message adds to its topic/partition's message and byte counters, and its
+ * key is fed into a space-saving summary of that partition's most frequent keys. This gives
+ * the heavy hitters of every partition and how skewed traffic is both within a partition
+ * (the share of the hottest key) and across the partitions of a topic, using a fixed
+ * amount of memory per partition.
+ *
+ * Messages can be recorded when producing (using the builder, in which case messages with
+ * no explicit partition are accounted to RD_KAFKA_PARTITION_UA, or from the delivery report
+ * callback, which has the actual partition) and when consuming.
+ *
+ * \code
+ * HotKeyTracker tracker;
+ *
+ * // Produce side
+ * config.set_delivery_report_callback([&](Producer&, const Message& msg) {
+ *     tracker.record(msg);
+ * });
+ * Producer producer(config);
+ *
+ * // Consume side
+ * Message msg = consumer.poll();
+ * if (msg && !msg.get_error()) {
+ *     tracker.record(msg);
+ * }
+ *
+ * for (const auto& hitter : tracker.get_heavy_hitters({ "some_topic", 0 }, 5)) {
+ *     cout << hitter.key << ": " << hitter.count << endl;
+ * }
+ * \endcode
+ *
+ * Recording a Message finds its topic through the rdkafka topic handle the message points to,
+ * so the hot path doesn't build a topic name string nor compare it against every tracked
+ * topic.
+ *
+ * To reduce the per message cost further, keys can be sampled: with a sample rate of N,
+ * only one in every N keys is fed into the summaries (counting N times) while counters
+ * still see every message. Whether a key is sampled is decided before taking the lock.
+ *
+ * This class is thread safe.
+ */
+class CPPKAFKA_API HotKeyTracker {
+public:
+    /**
+     * A frequent key along with its estimated count
+     */
+    struct HeavyHitter {
+        /**
+         * The key
+         */
+        std::string key;
+
+        /**
+         * Upper bound of the number of messages with this key
+         */
+        uint64_t count;
+
+        /**
+         * Maximum overestimation of the count
+         */
+        uint64_t error;
+    };
+
+    /**
+     * Traffic seen in a topic/partition
+     */
+    struct PartitionStats {
+        uint64_t messages;
+        uint64_t bytes;
+    };
+
+    /**
+     * The default number of keys monitored per partition
+     */
+    static const size_t DEFAULT_CAPACITY;
+
+    /**
+     * \brief Constructs a hot key tracker
+     *
+     * \param capacity The number of keys monitored per partition. Keys whose share of a
+     * partition's traffic is above 1 / capacity are guaranteed to be found
+     */
+    HotKeyTracker(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * \brief Sets the key sample rate
+     *
+     * \param value Only one in every value keys will be fed into the summaries
+     */
+    void set_sample_rate(unsigned value);
+
+    /**
+     * \brief Records a message
+     *
+     * \param message The message to be recorded
+     */
+    void record(const Message& message);
+
+    /**
+     * \brief Records a message that's about to be produced
+     *
+     * \param builder The builder for the message to be recorded
+     */
+    void record(const MessageBuilder& builder);
+
+    /**
+     * \brief Records a message
+     *
+     * \param topic The message's topic
+     * \param partition The message's partition
+     * \param key The message's key. Keyless messages are only counted
+     * \param size The message's size in bytes
+     */
+    void record(const std::string& topic, int partition, const Buffer& key, size_t size);
+
+    /**
+     * \brief Gets the most frequent keys in a partition, sorted by decreasing count
+     *
+     * \param topic_partition The topic/partition
+     * \param count The maximum number of keys to return
+     */
+    std::vector<HeavyHitter> get_heavy_hitters(const TopicPartition& topic_partition,
+                                               size_t count) const;
+
+    /**
+     * \brief Gets the estimated share of a partition's keyed messages taken by its hottest key
+     *
+     * \param topic_partition The topic/partition
+     */
+    double get_key_skew(const TopicPartition& topic_partition) const;
+
+    /**
+     * \brief Gets the ratio between a topic's busiest partition and the mean of its partitions
+     *
+     * A perfectly balanced topic has a partition skew of 1. Only partitions that have been
+     * recorded (and not RD_KAFKA_PARTITION_UA) are considered
+     *
+     * \param topic The topic
+     */
+    double get_partition_skew(const std::string& topic) const;
+
+    /**
+     * \brief Gets the traffic seen in a topic/partition
+     *
+     * \param topic_partition The topic/partition
+     */
+    PartitionStats get_partition_stats(const TopicPartition& topic_partition) const;
+
+    /**
+     * Gets the traffic seen in every topic/partition
+     */
+    std::map<TopicPartition, PartitionStats> get_partition_stats() const;
+
+    /**
+     * Clears every counter and summary
+     */
+    void reset();
+private:
+    struct PartitionState {
+        PartitionState(size_t capacity);
+
+        PartitionStats stats;
+        uint64_t keyed_messages;
+        detail::SpaceSaving keys;
+    };
+
+    using PartitionMap = std::map<int, PartitionState>;
+    using TopicMap = std::map<std::string, PartitionMap>;
+
+    unsigned get_sample_weight(const Buffer& key);
+    PartitionMap& get_partitions(rd_kafka_topic_t* handle);
+    void record(PartitionMap& partitions, int partition, const Buffer& key, size_t size,
+                unsigned weight);
+    const PartitionState* find_partition(const TopicPartition& topic_partition) const;
+
+    TopicMap topics_;
+    std::unordered_map<rd_kafka_topic_t*, TopicMap::iterator> topic_handles_;
+    size_t capacity_;
+    std::atomic<unsigned> sample_rate_{1};
+    std::atomic<uint64_t> sample_counter_{0};
+    mutable std::mutex mutex_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_HOT_KEY_TRACKER_H
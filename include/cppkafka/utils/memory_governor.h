@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_MEMORY_GOVERNOR_H
+#define CPPKAFKA_MEMORY_GOVERNOR_H
+
+#include <set>
+#include <memory>
+#include <chrono>
+#include "../consumer.h"
+#include "../message.h"
+#include "../topic_partition.h"
+#include "../topic_partition_list.h"
+#include "../detail/memory_account.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Bounds the memory held by consumed messages that haven't been destroyed yet
+ *
+ * Every message returned by MemoryGovernor::poll (or passed to MemoryGovernor::track) is
+ * charged its payload and key sizes until it's destroyed, so messages handed over to slow
+ * workers keep counting against the budget for as long as they're alive. Whenever the bytes
+ * held by this consumer's messages go over its budget, or the bytes held by every governed
+ * message in the process go over the global budget, the consumer's assigned partitions are
+ * paused. They're resumed once usage drops below the resume threshold of every exceeded
+ * budget, so memory usage stays bounded when processing stalls.
+ *
+ * \code
+ * // Never hold more than 1GB worth of messages across every consumer
+ * MemoryGovernor::set_global_budget(1024 * 1024 * 1024);
+ *
+ * Consumer consumer(config);
+ * MemoryGovernor governor(consumer, 256 * 1024 * 1024);
+ * consumer.subscribe({ "some_topic" });
+ *
+ * while (true) {
+ *     Message msg = governor.poll();
+ *     if (msg && !msg.get_error()) {
+ *         // Bytes are given back when the worker destroys the message
+ *         workers.push(move(msg));
+ *     }
+ * }
+ * \endcode
+ *
+ * Partitions are only paused and resumed when polling (or tracking) through the governor, so
+ * this must keep being polled while it's paused. Partitions paused through
+ * MemoryGovernor::pause_partitions are never resumed by the governor. Partitions come back
+ * unpaused when they're reassigned, so the governor sets a revocation callback on the consumer
+ * (which calls any previously set one) to forget about revoked partitions. The callback is
+ * restored when the governor is destroyed. This class implements the methods
+ * BasicConsumerDispatcher uses, so it can be used with it as
+ * BasicConsumerDispatcher<MemoryGovernor>.
+ *
+ * Sizes are estimated from the messages' payload and key lengths, which undercounts the
+ * fetch buffers rdkafka keeps alive for them, so budgets should leave some headroom.
+ */
+class CPPKAFKA_API MemoryGovernor {
+public:
+    /**
+     * The default fraction of a budget usage has to drop below to resume partitions
+     */
+    static const double DEFAULT_RESUME_THRESHOLD;
+
+    /**
+     * \brief Sets the budget shared by every governed message in the process
+     *
+     * \param value The budget in bytes. 0 means unlimited, which is the default
+     */
+    static void set_global_budget(size_t value);
+
+    /**
+     * Gets the global budget
+     */
+    static size_t get_global_budget();
+
+    /**
+     * Gets the number of bytes held by every governed message in the process
+     */
+    static size_t get_global_usage();
+
+    /**
+     * \brief Constructs a memory governor
+     *
+     * \param consumer The consumer to be used
+     * \param budget The budget in bytes for this consumer's messages. 0 means unlimited
+     */
+    MemoryGovernor(Consumer& consumer, size_t budget = 0);
+
+    /**
+     * \brief Restores the consumer's revocation callback
+     */
+    ~MemoryGovernor();
+
+    MemoryGovernor(const MemoryGovernor&) = delete;
+    MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+
+    /**
+     * \brief Sets the budget for this consumer's messages
+     *
+     * \param value The budget in bytes. 0 means unlimited
+     */
+    void set_budget(size_t value);
+
+    /**
+     * Gets the budget for this consumer's messages
+     */
+    size_t get_budget() const;
+
+    /**
+     * Gets the number of bytes held by this consumer's messages
+     */
+    size_t get_usage() const;
+
+    /**
+     * \brief Sets the fraction of a budget usage has to drop below to resume partitions
+     *
+     * \param value The threshold, which will be clamped to [0, 1]
+     */
+    void set_resume_threshold(double value);
+
+    /**
+     * \brief Polls for a message using the consumer's timeout
+     *
+     * The returned message is tracked and partitions are paused or resumed as needed
+     */
+    Message poll();
+
+    /**
+     * \brief Polls for a message
+     *
+     * \param timeout The maximum time to wait for a message
+     */
+    Message poll(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Charges a message obtained by other means to this consumer's budget
+     *
+     * Tracking a message that was already tracked moves it to this governor's budget
+     *
+     * \param message The message to be tracked
+     */
+    void track(Message& message);
+
+    /**
+     * \brief Pauses or resumes partitions based on the current usage
+     *
+     * This is called on every poll, but can be used when messages are consumed by other means
+     */
+    void update();
+
+    /**
+     * Indicates whether partitions are currently paused by the governor
+     */
+    bool is_paused() const;
+
+    /**
+     * Pauses the given partitions (see Consumer::pause_partitions)
+     */
+    void pause_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Resumes the given partitions (see Consumer::resume_partitions)
+     */
+    void resume_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Gets the consumer's assignment (see Consumer::get_assignment)
+     */
+    TopicPartitionList get_assignment() const;
+
+    /**
+     * Gets the consumer
+     */
+    Consumer& get_consumer();
+private:
+    static std::shared_ptr<detail::MemoryAccount> get_global_account();
+    static size_t get_message_size(const Message& message);
+
+    bool is_over_budget() const;
+    bool is_below_threshold() const;
+    void on_revocation(const TopicPartitionList& topic_partitions);
+    void pause_assignment();
+    void resume_assignment();
+
+    Consumer& consumer_;
+    std::shared_ptr<detail::MemoryAccount> account_;
+    std::set<TopicPartition> paused_partitions_;
+    std::set<TopicPartition> user_paused_partitions_;
+    Consumer::RevocationCallback original_revocation_callback_;
+    size_t budget_;
+    double resume_threshold_;
+    bool paused_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_MEMORY_GOVERNOR_H
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_MESSAGE_TRACER_H
+#define CPPKAFKA_MESSAGE_TRACER_H
+
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include "../message.h"
+#include "../buffer.h"
+#include "../macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Propagates sampled traces across the services a message goes through
+ *
+ * A trace context holds an id, the time the message was first produced and, for every
+ * service it went through afterwards, the times at which it was received and produced
+ * again. Contexts are carried in a message header using a compact binary encoding, so
+ * every hop only adds a few bytes to the message.
+ *
+ * Traces are sampled where they start: only the configured fraction of calls to
+ * MessageTracer::start return a valid context, and services downstream just keep tracing
+ * the messages that carry one. This bounds the overhead to the sampled messages.
+ *
+ * \code
+ * MessageTracer tracer(0.01);
+ *
+ * // On the service where messages originate
+ * MessageBuilder builder("ingest");
+ * tracer.inject(tracer.start(), builder.payload(payload));
+ * producer.produce(builder);
+ *
+ * // On every service in between
+ * Message msg = consumer.poll();
+ * MessageTracer::TraceContext context = tracer.extract(msg);
+ * MessageBuilder output("enriched");
+ * ... process the message ...
+ * tracer.inject(context, output.payload(result));
+ * producer.produce(output);
+ *
+ * // On the last service
+ * tracer.set_trace_callback([](const MessageTracer::TraceContext& context) {
+ *     for (const auto& hop : MessageTracer::get_latency_breakdown(context)) {
+ *         cout << hop.queueing.count() << "ms queued, "
+ *              << hop.processing.count() << "ms processing" << endl;
+ *     }
+ * });
+ * tracer.extract(consumer.poll());
+ * \endcode
+ *
+ * Timestamps are taken from the system clock of every service, so the breakdown is only
+ * as accurate as the clock synchronization between them. Reading headers from messages
+ * requires rdkafka >= 0.11.4.
+ */
+class CPPKAFKA_API MessageTracer {
+public:
+    /**
+     * A service a traced message went through
+     */
+    struct Hop {
+        /**
+         * The time the message was received, in milliseconds since epoch
+         */
+        std::chrono::milliseconds received;
+
+        /**
+         * The time the message was produced again, in milliseconds since epoch
+         */
+        std::chrono::milliseconds sent;
+    };
+
+    /**
+     * A trace propagated along with a message
+     */
+    struct TraceContext {
+        /**
+         * The trace id. 0 means the message isn't traced
+         */
+        uint64_t trace_id;
+
+        /**
+         * The time the message was first produced, in milliseconds since epoch
+         */
+        std::chrono::milliseconds origin;
+
+        /**
+         * The services the message went through before the current one
+         */
+        std::vector<Hop> hops;
+
+        /**
+         * The time the current service received the message. 0 if it originated here
+         */
+        std::chrono::milliseconds received;
+
+        /**
+         * Indicates whether this is a valid trace
+         */
+        explicit operator bool() const {
+            return trace_id != 0;
+        }
+    };
+
+    /**
+     * The time a message spent on its way to a service and inside it
+     */
+    struct HopLatency {
+        /**
+         * Time between the message being produced and being received by the service
+         */
+        std::chrono::milliseconds queueing;
+
+        /**
+         * Time between the service receiving the message and producing it again
+         */
+        std::chrono::milliseconds processing;
+    };
+
+    /**
+     * Callback executed for every traced message extracted
+     */
+    using TraceCallback = std::function<void(const TraceContext&)>;
+
+    /**
+     * The default name of the header the trace is carried in
+     */
+    static const std::string DEFAULT_HEADER_NAME;
+
+    /**
+     * The maximum number of hops kept in a trace. Any hops after it are dropped
+     */
+    static const size_t MAX_HOPS;
+
+    /**
+     * \brief Encodes a trace context into a header value
+     *
+     * \param context The context to be encoded
+     */
+    static std::string encode(const TraceContext& context);
+
+    /**
+     * \brief Decodes a trace context from a header value
+     *
+     * An Exception is thrown if the value is malformed
+     *
+     * \param value The header value
+     */
+    static TraceContext decode(const Buffer& value);
+
+    /**
+     * \brief Gets the latency breakdown of a trace
+     *
+     * There's one element for every hop plus, if the context was extracted by the current
+     * service, a last one with the time it took to reach it (its processing time is 0)
+     *
+     * \param context The trace context
+     */
+    static std::vector<HopLatency> get_latency_breakdown(const TraceContext& context);
+
+    /**
+     * \brief Gets the time between a message being first produced and received here
+     *
+     * \param context The trace context, as extracted by the current service
+     */
+    static std::chrono::milliseconds get_end_to_end_latency(const TraceContext& context);
+
+    /**
+     * \brief Constructs a message tracer
+     *
+     * \param sample_rate The fraction of traces started that will be sampled
+     */
+    MessageTracer(double sample_rate = 1.0);
+
+    /**
+     * \brief Sets the fraction of traces started that will be sampled
+     *
+     * \param value The rate, which will be clamped to [0, 1]
+     */
+    void set_sample_rate(double value);
+
+    /**
+     * \brief Sets the name of the header the trace is carried in
+     *
+     * \param value The header name
+     */
+    void set_header_name(std::string value);
+
+    /**
+     * \brief Sets the callback executed for every traced message extracted
+     *
+     * \param callback The callback to be set
+     */
+    void set_trace_callback(TraceCallback callback);
+
+    /**
+     * \brief Starts a trace
+     *
+     * Returns an invalid context if this trace isn't sampled
+     */
+    TraceContext start();
+
+    /**
+     * \brief Stamps a trace context into a message that's about to be produced
+     *
+     * If the context was extracted from a message, a hop for the current service is added.
+     * Invalid contexts are ignored.
+     *
+     * \param context The trace context
+     * \param builder The builder for the message to be produced
+     */
+    template <typename BuilderType>
+    void inject(const TraceContext& context, BuilderType& builder) const;
+
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    /**
+     * \brief Extracts the trace context from a consumed message
+     *
+     * Returns an invalid context if the message isn't traced
+     *
+     * \param message The message
+     */
+    TraceContext extract(const Message& message) const;
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
+    /**
+     * \brief Extracts the trace context from a header value
+     *
+     * Returns an invalid context if the value is empty or malformed
+     *
+     * \param value The header value
+     */
+    TraceContext extract(const Buffer& value) const;
+private:
+    static std::chrono::milliseconds now();
+
+    std::string header_name_;
+    TraceCallback trace_callback_;
+    std::mt19937_64 generator_;
+    double sample_rate_;
+    std::mutex generator_mutex_;
+};
+
+template <typename BuilderType>
+void MessageTracer::inject(const TraceContext& context, BuilderType& builder) const {
+    if (!context) {
+        return;
+    }
+    TraceContext output = context;
+    if (output.received.count() == 0) {
+        // The message originates here
+        output.origin = now();
+    }
+    else if (output.hops.size() < MAX_HOPS) {
+        output.hops.push_back(Hop{ output.received, now() });
+    }
+    builder.header(header_name_, encode(output));
+}
+
+} // cppkafka
+
+#endif // CPPKAFKA_MESSAGE_TRACER_H
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_OFFSET_FETCHER_H
+#define CPPKAFKA_OFFSET_FETCHER_H
+
+#include <cstdint>
+#include <chrono>
+#include <list>
+#include <vector>
+#include <functional>
+#include "../consumer.h"
+#include "../message.h"
+#include "../topic_partition.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Fetches messages at arbitrary topic/partition/offsets
+ *
+ * This class owns a Consumer that keeps every topic/partition it has ever read from
+ * assigned (and paused while not being read), so fetching a message only requires seeking
+ * and reading rather than a full assign/poll cycle.
+ *
+ * Messages are read in windows: fetching a single offset will read a window of messages
+ * starting at it, and fetching several offsets at once will group the ones that are close
+ * to each other in the same partition into a single window. The last windows read are
+ * kept in a cache so fetching offsets near ones that were recently fetched doesn't hit the
+ * brokers.
+ *
+ * The configuration provided must contain the group.id attribute. Offsets are never
+ * committed by this class.
+ *
+ * \code
+ * OffsetFetcher fetcher(config);
+ *
+ * // Fetch a single message
+ * const Message& msg = fetcher.fetch({ "some_topic", 3, 1337 });
+ * if (msg) {
+ *     cout << msg.get_payload() << endl;
+ * }
+ *
+ * // Fetch several messages. Nearby offsets are read together
+ * fetcher.fetch({ { "some_topic", 3, 1340 }, { "some_topic", 3, 1345 } },
+ *               [](const Message& msg) {
+ *     cout << msg.get_offset() << ": " << msg.get_payload() << endl;
+ * });
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API OffsetFetcher {
+public:
+    static const int64_t DEFAULT_WINDOW_SIZE;
+    static const int64_t DEFAULT_MAXIMUM_GAP;
+    static const size_t DEFAULT_MAXIMUM_CACHED_WINDOWS;
+    static const std::chrono::milliseconds DEFAULT_FETCH_TIMEOUT;
+
+    /**
+     * Callback executed for every message found when fetching several offsets
+     */
+    using MessageCallback = std::function<void(const Message&)>;
+
+    /**
+     * \brief Constructs an offset fetcher
+     *
+     * \param config The configuration to be used on the Consumer
+     */
+    OffsetFetcher(Configuration config);
+
+    /**
+     * \brief Fetches the message at the given topic/partition/offset
+     *
+     * The returned reference is valid until any other method on this object is called. If
+     * the message couldn't be found, an empty message is returned. Offsets at or past the
+     * partition's high watermark aren't waited for.
+     *
+     * \param topic_partition The topic/partition/offset to be fetched
+     */
+    const Message& fetch(const TopicPartition& topic_partition);
+
+    /**
+     * \brief Fetches the messages at the given topic/partition/offsets
+     *
+     * The callback will be executed once for every message found, in no particular order.
+     * Offsets that can't be found are skipped.
+     *
+     * \param topic_partitions The topic/partition/offsets to be fetched
+     * \param callback The callback to be executed for every message found
+     */
+    void fetch(const TopicPartitionList& topic_partitions, const MessageCallback& callback);
+
+    /**
+     * \brief Sets the minimum number of offsets read in every window
+     *
+     * \param value The value to be set
+     */
+    void set_window_size(int64_t value);
+
+    /**
+     * \brief Sets the maximum distance between offsets fetched in the same window
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_gap(int64_t value);
+
+    /**
+     * \brief Sets the maximum number of windows kept in the cache
+     *
+     * \param value The value to be set
+     */
+    void set_maximum_cached_windows(size_t value);
+
+    /**
+     * \brief Sets the maximum time spent reading a single window
+     *
+     * \param value The value to be set
+     */
+    void set_fetch_timeout(std::chrono::milliseconds value);
+
+    /**
+     * Clears the window cache
+     */
+    void clear_cache();
+
+    /**
+     * Gets the Consumer object
+     */
+    Consumer& get_consumer();
+private:
+    using ClockType = std::chrono::steady_clock;
+
+    struct Window {
+        TopicPartition topic_partition;
+        int64_t first_offset;
+        int64_t end_offset;
+        std::vector<Message> messages;
+    };
+
+    static Configuration prepare_configuration(Configuration config);
+    const Message* find_cached(const TopicPartition& topic_partition);
+    const Message* find_in_window(const Window& window, int64_t offset) const;
+    Window& read_window(const TopicPartition& topic_partition, int64_t first_offset,
+                        int64_t end_offset);
+    int64_t get_cached_high_watermark(const TopicPartition& topic_partition) const;
+    void prepare_partition(const TopicPartition& topic_partition, int64_t offset);
+
+    Consumer consumer_;
+    std::list<Window> windows_;
+    TopicPartitionList assignment_;
+    Message empty_message_;
+    Window empty_window_;
+    int64_t window_size_;
+    int64_t maximum_gap_;
+    size_t maximum_cached_windows_;
+    std::chrono::milliseconds fetch_timeout_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_OFFSET_FETCHER_H
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_PARALLEL_DECODER_H
+#define CPPKAFKA_PARALLEL_DECODER_H
+
+#include <map>
+#include <deque>
+#include <queue>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+#include <boost/optional.hpp>
+#include "../message.h"
+#include "../topic_partition.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Decodes messages on a pool of threads while keeping them ordered per partition
+ *
+ * Messages pushed into this object are decoded in parallel by a pool of worker threads and
+ * then handed over to a handler on the thread that calls ParallelDecoder::process,
+ * ParallelDecoder::deliver or ParallelDecoder::flush. Each topic/partition has its own reorder
+ * queue, so the handler sees every partition's messages in the same order they were pushed
+ * even if later ones finish decoding first, while messages from different partitions don't
+ * wait on each other.
+ *
+ * If the decoder throws, the exception is re-thrown from the call that would have delivered
+ * that message, once all of its predecessors in the same partition have been delivered. The
+ * failed message is discarded, so processing can continue afterwards.
+ *
+ * \code
+ * Consumer consumer(config);
+ * consumer.subscribe({ "some_topic" });
+ * ParallelDecoder<Event> decoder([](const Message& msg) {
+ *     return Event::parse(msg.get_payload());
+ * });
+ *
+ * auto handler = [&](Message msg, Event event) {
+ *     process(event);
+ * };
+ * while (running) {
+ *     Message msg = consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         decoder.process(move(msg), handler);
+ *     }
+ *     else {
+ *         decoder.deliver(handler);
+ *     }
+ * }
+ * decoder.flush(handler);
+ * \endcode
+ *
+ * Messages having errors should be handled before pushing them, as the decoder is executed
+ * for every message pushed. Only the thread owning this object can call its methods.
+ */
+template <typename T>
+class ParallelDecoder {
+public:
+    /**
+     * Callback executed on a worker thread to decode a message
+     */
+    using Decoder = std::function<T(const Message&)>;
+
+    /**
+     * Callback executed for every decoded message, in per partition order
+     */
+    using Handler = std::function<void(Message, T)>;
+
+    /**
+     * The default maximum number of messages that can be pending delivery
+     */
+    static const size_t DEFAULT_MAXIMUM_PENDING = 4096;
+
+    /**
+     * \brief Constructs a parallel decoder
+     *
+     * \param decoder The callback used to decode messages
+     * \param thread_count The number of worker threads. If 0, one thread per core is used
+     */
+    ParallelDecoder(Decoder decoder, size_t thread_count = 0);
+
+    /**
+     * Stops the worker threads, discarding every message that wasn't delivered
+     */
+    ~ParallelDecoder();
+
+    ParallelDecoder(const ParallelDecoder&) = delete;
+    ParallelDecoder& operator=(const ParallelDecoder&) = delete;
+
+    /**
+     * \brief Queues a message to be decoded
+     *
+     * \param message The message to be decoded
+     */
+    void push(Message message);
+
+    /**
+     * \brief Queues a message and delivers every message that's ready
+     *
+     * If the number of messages pending delivery reaches the maximum, this blocks until
+     * enough of them are decoded and delivered, which keeps memory usage bounded when the
+     * workers can't keep up with the consumer.
+     *
+     * \param message The message to be decoded
+     * \param handler The handler to execute for every message delivered
+     */
+    void process(Message message, const Handler& handler);
+
+    /**
+     * \brief Delivers every message that's ready, without blocking
+     *
+     * \param handler The handler to execute for every message delivered
+     *
+     * \return The number of messages delivered
+     */
+    size_t deliver(const Handler& handler);
+
+    /**
+     * \brief Blocks until every message pushed so far has been delivered
+     *
+     * \param handler The handler to execute for every message delivered
+     */
+    void flush(const Handler& handler);
+
+    /**
+     * \brief Sets the maximum number of messages that can be pending delivery
+     *
+     * \param value The value to be set. This will be at least 1
+     */
+    void set_maximum_pending(size_t value);
+
+    /**
+     * Gets the number of messages pushed that haven't been delivered yet
+     */
+    size_t get_pending() const;
+
+    /**
+     * Gets the number of worker threads
+     */
+    size_t get_thread_count() const;
+private:
+    struct Slot {
+        Slot(Message message) : message(std::move(message)) { }
+
+        Message message;
+        boost::optional<T> value;
+        std::exception_ptr error;
+        bool done{false};
+    };
+
+    using SlotPtr = std::unique_ptr<Slot>;
+
+    void run_worker();
+    size_t deliver_ready(const Handler& handler);
+    void wait_for_completion();
+
+    Decoder decoder_;
+    std::vector<std::thread> workers_;
+    std::map<TopicPartition, std::deque<SlotPtr>> partitions_;
+    std::queue<Slot*> tasks_;
+    mutable std::mutex mutex_;
+    std::condition_variable task_condition_;
+    std::condition_variable done_condition_;
+    size_t pending_{0};
+    // Every decoded message increments this, so waits can't miss any completion
+    size_t completions_{0};
+    size_t seen_completions_{0};
+    size_t maximum_pending_{DEFAULT_MAXIMUM_PENDING};
+    bool running_{true};
+};
+
+template <typename T>
+const size_t ParallelDecoder<T>::DEFAULT_MAXIMUM_PENDING;
+
+template <typename T>
+ParallelDecoder<T>::ParallelDecoder(Decoder decoder, size_t thread_count)
+: decoder_(std::move(decoder)) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&ParallelDecoder::run_worker, this);
+    }
+}
+
+template <typename T>
+ParallelDecoder<T>::~ParallelDecoder() {
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        running_ = false;
+    }
+    task_condition_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+template <typename T>
+void ParallelDecoder<T>::push(Message message) {
+    TopicPartition topic_partition(message.get_topic(), message.get_partition());
+    SlotPtr slot(new Slot(std::move(message)));
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        tasks_.push(slot.get());
+        partitions_[topic_partition].push_back(std::move(slot));
+        pending_++;
+    }
+    task_condition_.notify_one();
+}
+
+template <typename T>
+void ParallelDecoder<T>::process(Message message, const Handler& handler) {
+    push(std::move(message));
+    deliver_ready(handler);
+    while (get_pending() >= maximum_pending_) {
+        wait_for_completion();
+        deliver_ready(handler);
+    }
+}
+
+template <typename T>
+size_t ParallelDecoder<T>::deliver(const Handler& handler) {
+    return deliver_ready(handler);
+}
+
+template <typename T>
+void ParallelDecoder<T>::flush(const Handler& handler) {
+    deliver_ready(handler);
+    while (get_pending() > 0) {
+        wait_for_completion();
+        deliver_ready(handler);
+    }
+}
+
+template <typename T>
+void ParallelDecoder<T>::set_maximum_pending(size_t value) {
+    maximum_pending_ = std::max<size_t>(value, 1);
+}
+
+template <typename T>
+size_t ParallelDecoder<T>::get_pending() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return pending_;
+}
+
+template <typename T>
+size_t ParallelDecoder<T>::get_thread_count() const {
+    return workers_.size();
+}
+
+template <typename T>
+void ParallelDecoder<T>::run_worker() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        task_condition_.wait(lock, [&] { return !running_ || !tasks_.empty(); });
+        if (!running_) {
+            return;
+        }
+        Slot* slot = tasks_.front();
+        tasks_.pop();
+        lock.unlock();
+
+        // Nobody else touches the slot until it's flagged as done
+        boost::optional<T> value;
+        std::exception_ptr error;
+        try {
+            value = decoder_(slot->message);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        slot->value = std::move(value);
+        slot->error = error;
+        slot->done = true;
+        completions_++;
+        done_condition_.notify_one();
+    }
+}
+
+template <typename T>
+size_t ParallelDecoder<T>::deliver_ready(const Handler& handler) {
+    size_t delivered = 0;
+    auto iter = partitions_.begin();
+    bool first_pass = true;
+    size_t pass_completions = 0;
+    while (true) {
+        SlotPtr slot;
+        {
+            std::lock_guard<std::mutex> _(mutex_);
+            if (first_pass) {
+                pass_completions = completions_;
+                first_pass = false;
+            }
+            // Skip partitions whose oldest message is still being decoded
+            while (iter != partitions_.end() && !iter->second.front()->done) {
+                ++iter;
+            }
+            if (iter == partitions_.end()) {
+                // Go over them again if anything we skipped finished in the meantime
+                if (completions_ != pass_completions) {
+                    pass_completions = completions_;
+                    iter = partitions_.begin();
+                    continue;
+                }
+                seen_completions_ = completions_;
+                break;
+            }
+            slot = std::move(iter->second.front());
+            iter->second.pop_front();
+            if (iter->second.empty()) {
+                iter = partitions_.erase(iter);
+            }
+            pending_--;
+        }
+        // Call the handler without holding the lock so workers keep going
+        if (slot->error) {
+            std::rethrow_exception(slot->error);
+        }
+        handler(std::move(slot->message), std::move(*slot->value));
+        delivered++;
+    }
+    return delivered;
+}
+
+template <typename T>
+void ParallelDecoder<T>::wait_for_completion() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Wait until a message finishes decoding after the last time we delivered
+    done_condition_.wait(lock, [&] {
+        return completions_ != seen_completions_ || pending_ == 0;
+    });
+}
+
+} // cppkafka
+
+#endif // CPPKAFKA_PARALLEL_DECODER_H
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_PARTITION_SCANNER_H
+#define CPPKAFKA_PARTITION_SCANNER_H
+
+#include <cstdint>
+#include <map>
+#include <functional>
+#include "../consumer.h"
+#include "../message.h"
+#include "../topic_partition.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Reads bounded offset ranges out of a set of topic/partitions
+ *
+ * This class allows reading [start, end) offset ranges from any number of topic/partitions
+ * and returning once all of them have been fully read. All ranges are assigned to the
+ * consumer at the same time, so rdkafka fetches from every partition in parallel. Whenever
+ * a partition reaches the end of its range, it's paused so no more data is fetched for it.
+ *
+ * A partition is also considered done if its end of file is reached before the end of its
+ * range (note that this requires "enable.partition.eof" to be set). Whenever a poll returns no
+ * message, the consumer's position on every pending partition is checked as well, so ranges
+ * whose last offsets will never be delivered as messages (e.g. transaction markers) are
+ * finished once the position reaches the end of the range even if EOF isn't enabled.
+ *
+ * The consumer provided should not be subscribed to any topic, as ranges are directly
+ * assigned to it.
+ *
+ * \code
+ * Consumer consumer(config);
+ * PartitionScanner scanner(consumer);
+ *
+ * // Read offsets [100, 200) from partition 0
+ * scanner.add_range({ "some_topic", 0, 100 }, 200);
+ * // Read partition 1 from the beginning up to its current high watermark
+ * scanner.add_range({ "some_topic", 1, TopicPartition::OFFSET_BEGINNING });
+ *
+ * scanner.scan([&](Message msg) {
+ *     process(msg);
+ * });
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API PartitionScanner {
+public:
+    /**
+     * Callback executed for every message within the scanned ranges
+     */
+    using MessageCallback = std::function<void(Message)>;
+
+    /**
+     * \brief Callback executed for every error found while scanning
+     *
+     * If no error callback is set, a ConsumerException will be thrown when an error is found
+     */
+    using ErrorCallback = std::function<void(Error)>;
+
+    /**
+     * \brief Constructs a partition scanner
+     *
+     * \param consumer The consumer to be used
+     */
+    PartitionScanner(Consumer& consumer);
+
+    /**
+     * \brief Adds a range to be scanned
+     *
+     * \param start The topic/partition to be scanned along with the first offset to read
+     * \param end_offset The offset at which reading will stop (non inclusive)
+     */
+    void add_range(const TopicPartition& start, int64_t end_offset);
+
+    /**
+     * \brief Adds a range ending on the topic/partition's current high watermark
+     *
+     * The high watermark is queried when calling this method, so messages produced after
+     * that won't be read.
+     *
+     * \param start The topic/partition to be scanned along with the first offset to read
+     */
+    void add_range(const TopicPartition& start);
+
+    /**
+     * \brief Sets the error callback
+     *
+     * \param callback The callback to be set
+     */
+    void set_error_callback(ErrorCallback callback);
+
+    /**
+     * \brief Scans every range added so far
+     *
+     * This will assign all ranges, execute the callback for every message within them and
+     * return once all of them are done. The consumer is unassigned before returning and
+     * all ranges are cleared so the scanner can be reused. This also happens if an exception
+     * is thrown while scanning.
+     *
+     * \param callback The callback to be executed for every message
+     */
+    void scan(const MessageCallback& callback);
+
+    /**
+     * \brief Stops an ongoing scan
+     *
+     * This is meant to be called from within a callback. The current scan will return
+     * after the callback does and any ranges that weren't fully read will be discarded.
+     */
+    void stop();
+
+    /**
+     * Gets the number of ranges that haven't been fully read yet
+     */
+    size_t get_pending_ranges() const;
+private:
+    struct Range {
+        int64_t end_offset;
+        bool done;
+    };
+
+    void finish_range(const TopicPartition& topic_partition, Range& range);
+    void check_positions();
+    void reset();
+
+    Consumer& consumer_;
+    std::map<TopicPartition, Range> ranges_;
+    TopicPartitionList assignment_;
+    ErrorCallback error_callback_;
+    size_t pending_ranges_{0};
+    bool running_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_PARTITION_SCANNER_H
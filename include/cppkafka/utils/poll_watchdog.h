@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_POLL_WATCHDOG_H
+#define CPPKAFKA_POLL_WATCHDOG_H
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include "../consumer.h"
+#include "../topic_partition.h"
+#include "../topic_partition_list.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Warns about consumers that are about to exceed max.poll.interval.ms
+ *
+ * The watchdog keeps track of the time elapsed since the last call to PollWatchdog::poll
+ * returned, and executes the poll interval callback once it goes over a fraction (the
+ * warning ratio) of the consumer's max.poll.interval.ms, so slow handlers can be detected
+ * before the broker evicts the member and triggers a rebalance of the whole group.
+ *
+ * It also tracks the progress of every assigned partition by looking at its position
+ * (the offset of the next message poll will return) and its lag with respect to the
+ * cached high watermark. A partition that has lag but whose position hasn't moved in the
+ * stall timeout is considered stalled, which executes the stalled partition callback and
+ * optionally pauses it. Partitions paused this way stay paused until they're resumed
+ * through PollWatchdog::resume_partitions or they're unassigned. Stalls aren't checked while
+ * polls are late, as no partition can make progress in that case.
+ *
+ * Checks are performed by PollWatchdog::check. As a consumer that's stuck in a handler
+ * won't be polling, checks must run on a different thread to be useful: either start the
+ * watchdog's monitor thread or call check periodically from a thread of your own. If
+ * neither is done, checks are only performed when polling.
+ *
+ * \code
+ * Consumer consumer(config);
+ * PollWatchdog watchdog(consumer);
+ * watchdog.set_poll_interval_callback([](milliseconds elapsed, milliseconds limit) {
+ *     cout << "No poll in " << elapsed.count() << "ms, limit is " << limit.count() << endl;
+ * });
+ * watchdog.set_stalled_partition_callback([](const TopicPartition& topic_partition,
+ *                                            const PollWatchdog::PartitionProgress&) {
+ *     cout << topic_partition << " is stalled" << endl;
+ * });
+ * watchdog.set_pause_stalled_partitions(true);
+ * watchdog.start_monitor(seconds(1));
+ *
+ * while (true) {
+ *     Message msg = watchdog.poll();
+ *     ...
+ * }
+ * \endcode
+ *
+ * Callbacks are executed on the thread performing the check, without holding any locks.
+ * This class implements the methods BasicConsumerDispatcher uses, so it can be used with
+ * it as BasicConsumerDispatcher<PollWatchdog>.
+ */
+class CPPKAFKA_API PollWatchdog {
+public:
+    /**
+     * Progress of an assigned partition
+     */
+    struct PartitionProgress {
+        /**
+         * The offset of the next message poll will return, or an invalid offset if nothing
+         * has been consumed yet
+         */
+        int64_t position;
+
+        /**
+         * The messages between the position and the high watermark, or -1 if unknown
+         */
+        int64_t lag;
+
+        /**
+         * The rate at which the position advanced between the last two checks, in
+         * offsets per second
+         */
+        double rate;
+
+        /**
+         * The time elapsed since the position last advanced
+         */
+        std::chrono::milliseconds idle_time;
+
+        /**
+         * Whether the partition is considered stalled
+         */
+        bool stalled;
+    };
+
+    /**
+     * \brief Callback executed when polls are late
+     *
+     * The arguments are the time elapsed since the last poll and max.poll.interval.ms
+     */
+    using PollIntervalCallback = std::function<void(std::chrono::milliseconds,
+                                                    std::chrono::milliseconds)>;
+
+    /**
+     * Callback executed when a partition becomes stalled
+     */
+    using StalledPartitionCallback = std::function<void(const TopicPartition&,
+                                                        const PartitionProgress&)>;
+
+    /**
+     * The default fraction of max.poll.interval.ms after which polls are considered late
+     */
+    static const double DEFAULT_WARNING_RATIO;
+
+    /**
+     * The default time a partition with lag can go without progress before it's stalled
+     */
+    static const std::chrono::milliseconds DEFAULT_STALL_TIMEOUT;
+
+    /**
+     * The default minimum time between checks performed when polling
+     */
+    static const std::chrono::milliseconds DEFAULT_CHECK_INTERVAL;
+
+    /**
+     * \brief Constructs a poll watchdog
+     *
+     * The poll interval limit is taken from the consumer's max.poll.interval.ms
+     *
+     * \param consumer The consumer to be used
+     */
+    PollWatchdog(Consumer& consumer);
+
+    PollWatchdog(const PollWatchdog&) = delete;
+    PollWatchdog& operator=(const PollWatchdog&) = delete;
+
+    /**
+     * Stops the monitor thread, if running
+     */
+    ~PollWatchdog();
+
+    /**
+     * \brief Sets the fraction of max.poll.interval.ms after which polls are late
+     *
+     * \param value The ratio, which will be clamped to (0, 1]
+     */
+    void set_warning_ratio(double value);
+
+    /**
+     * \brief Sets the time a partition with lag can go without progress before it's stalled
+     *
+     * \param value The value to be set
+     */
+    void set_stall_timeout(std::chrono::milliseconds value);
+
+    /**
+     * \brief Sets the minimum time between checks performed when polling
+     *
+     * \param value The value to be set
+     */
+    void set_check_interval(std::chrono::milliseconds value);
+
+    /**
+     * \brief Sets whether stalled partitions are paused automatically
+     *
+     * \param value The value to be set
+     */
+    void set_pause_stalled_partitions(bool value);
+
+    /**
+     * \brief Sets the callback executed when polls are late
+     *
+     * This is executed once per late poll
+     *
+     * \param callback The callback to be set
+     */
+    void set_poll_interval_callback(PollIntervalCallback callback);
+
+    /**
+     * \brief Sets the callback executed when a partition becomes stalled
+     *
+     * \param callback The callback to be set
+     */
+    void set_stalled_partition_callback(StalledPartitionCallback callback);
+
+    /**
+     * \brief Polls for a message using the consumer's timeout
+     */
+    Message poll();
+
+    /**
+     * \brief Polls for a message
+     *
+     * \param timeout The maximum time to wait for a message
+     */
+    Message poll(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Checks the poll interval and every assigned partition's progress
+     *
+     * This can be called from any thread
+     */
+    void check();
+
+    /**
+     * \brief Starts a thread that performs a check every interval
+     *
+     * \param interval The time between checks
+     */
+    void start_monitor(std::chrono::milliseconds interval);
+
+    /**
+     * Stops the monitor thread
+     */
+    void stop_monitor();
+
+    /**
+     * Gets the consumer's max.poll.interval.ms
+     */
+    std::chrono::milliseconds get_poll_interval_limit() const;
+
+    /**
+     * Gets the time elapsed since the last poll returned
+     */
+    std::chrono::milliseconds get_time_since_poll() const;
+
+    /**
+     * Gets the longest time observed between two polls
+     */
+    std::chrono::milliseconds get_max_poll_interval() const;
+
+    /**
+     * Gets the number of times polls were late
+     */
+    size_t get_late_poll_count() const;
+
+    /**
+     * \brief Gets the progress of a partition as of the last check
+     *
+     * \param topic_partition The topic/partition
+     */
+    PartitionProgress get_progress(const TopicPartition& topic_partition) const;
+
+    /**
+     * Gets the progress of every assigned partition as of the last check
+     */
+    std::map<TopicPartition, PartitionProgress> get_progress() const;
+
+    /**
+     * Pauses the given partitions (see Consumer::pause_partitions)
+     */
+    void pause_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * \brief Resumes the given partitions (see Consumer::resume_partitions)
+     *
+     * This also resets their stalled state
+     */
+    void resume_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Gets the consumer's assignment (see Consumer::get_assignment)
+     */
+    TopicPartitionList get_assignment() const;
+
+    /**
+     * Gets the consumer
+     */
+    Consumer& get_consumer();
+private:
+    using ClockType = std::chrono::steady_clock;
+
+    struct PartitionState {
+        PartitionProgress progress;
+        ClockType::time_point last_advance;
+        ClockType::time_point last_check;
+    };
+
+    static std::chrono::milliseconds to_duration(int64_t ticks);
+    static int64_t to_ticks(ClockType::time_point time_point);
+
+    void check_poll_interval(ClockType::time_point now);
+    void check_partitions(ClockType::time_point now);
+    bool update_partition(const TopicPartition& topic_partition, int64_t position,
+                          PartitionState& state, ClockType::time_point now, bool can_stall);
+    void run_monitor(std::chrono::milliseconds interval);
+
+    Consumer& consumer_;
+    std::chrono::milliseconds poll_interval_limit_;
+    std::chrono::milliseconds stall_timeout_;
+    std::chrono::milliseconds check_interval_;
+    double warning_ratio_;
+    bool pause_stalled_partitions_{false};
+    PollIntervalCallback poll_interval_callback_;
+    StalledPartitionCallback stalled_partition_callback_;
+    std::map<TopicPartition, PartitionState> partitions_;
+    std::set<TopicPartition> paused_partitions_;
+    mutable std::mutex mutex_;
+    std::atomic<int64_t> last_poll_{0};
+    std::atomic<int64_t> max_poll_interval_{0};
+    std::atomic<int64_t> last_check_{0};
+    std::atomic<size_t> late_poll_count_{0};
+    std::atomic<bool> poll_warned_{false};
+    std::atomic<bool> polling_{false};
+    std::thread monitor_thread_;
+    std::condition_variable monitor_condition_;
+    bool monitor_running_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_POLL_WATCHDOG_H
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_PRIORITY_POLLER_H
+#define CPPKAFKA_PRIORITY_POLLER_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "../consumer.h"
+#include "../queue.h"
+#include "../topic_partition.h"
+#include "../topic_partition_list.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Consumes higher priority topics/partitions ahead of the rest
+ *
+ * Every priority level gets its own queue, and the queues of the partitions that belong
+ * to it are forwarded to it as they're assigned, so messages from low priority partitions
+ * can't delay high priority ones inside a single consumer queue. Everything else (including
+ * rebalance events and errors) stays in the consumer queue, which is the lowest priority
+ * level (priority 0).
+ *
+ * Levels can be polled in one of two modes:
+ *
+ * * Strict: every poll returns a message from the highest priority level that has any.
+ * * Weighted: levels are visited from highest to lowest priority and each of them can
+ * return up to its weight in messages before the next one gets its turn, so low priority
+ * partitions can't be starved.
+ *
+ * \code
+ * Consumer consumer(config);
+ * PriorityPoller poller(consumer);
+ * poller.add_topic("control", 10);
+ * consumer.subscribe({ "control", "bulk" });
+ *
+ * while (true) {
+ *     // Control messages are always returned before bulk ones
+ *     Message msg = poller.poll();
+ *     ...
+ * }
+ * \endcode
+ *
+ * This class implements the methods BasicConsumerDispatcher uses, so it can be used with
+ * it as BasicConsumerDispatcher<PriorityPoller>.
+ *
+ * Priorities are applied when partitions are assigned via the consumer's assignment
+ * callback (any previously set assignment and revocation callbacks are still executed), as
+ * well as to the current assignment when adding a topic/partition. Messages for a
+ * partition that were already sitting in the consumer queue will still be consumed from it.
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API PriorityPoller {
+public:
+    /**
+     * The way priority levels are polled
+     */
+    enum class Mode {
+        STRICT,
+        WEIGHTED
+    };
+
+    /**
+     * The default time spent waiting on a single queue when none have messages
+     */
+    static const std::chrono::milliseconds DEFAULT_IDLE_WAIT;
+
+    /**
+     * \brief Constructs a priority poller
+     *
+     * \param consumer The consumer to be used
+     * \param mode The polling mode
+     */
+    PriorityPoller(Consumer& consumer, Mode mode = Mode::STRICT);
+
+    PriorityPoller(const PriorityPoller&) = delete;
+    PriorityPoller& operator=(const PriorityPoller&) = delete;
+
+    /**
+     * Restores the consumer's callbacks and every partition's forwarding
+     */
+    ~PriorityPoller();
+
+    /**
+     * \brief Sets the priority of every partition of a topic
+     *
+     * \param topic The topic
+     * \param priority The priority. Higher values are consumed first, 0 being the default
+     * \param weight The number of messages consumed in a row from this priority level in
+     * weighted mode. Levels shared by several topics/partitions use the last weight set
+     */
+    void add_topic(const std::string& topic, unsigned priority, unsigned weight = 1);
+
+    /**
+     * \brief Sets the priority of a single partition
+     *
+     * This takes precedence over the priority set for its topic, if any.
+     *
+     * \param topic_partition The topic/partition
+     * \param priority The priority. Higher values are consumed first, 0 being the default
+     * \param weight The number of messages consumed in a row from this priority level in
+     * weighted mode. Levels shared by several topics/partitions use the last weight set
+     */
+    void add_partition(const TopicPartition& topic_partition, unsigned priority,
+                       unsigned weight = 1);
+
+    /**
+     * \brief Sets the weight of the default priority level
+     *
+     * \param weight The weight to be set
+     */
+    void set_default_weight(unsigned weight);
+
+    /**
+     * \brief Sets the maximum time spent blocked on a single queue when none have messages
+     *
+     * When every queue is empty, the poller waits on the highest priority one for up to
+     * this long and then checks all of them again. Lower values make other levels'
+     * messages be picked up sooner at the cost of more wakeups.
+     *
+     * \param value The value to be set
+     */
+    void set_idle_wait(std::chrono::milliseconds value);
+
+    /**
+     * \brief Polls for a message using the consumer's timeout
+     */
+    Message poll();
+
+    /**
+     * \brief Polls for a message
+     *
+     * \param timeout The maximum time to wait for a message
+     */
+    Message poll(std::chrono::milliseconds timeout);
+
+    /**
+     * Pauses the given partitions (see Consumer::pause_partitions)
+     */
+    void pause_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Resumes the given partitions (see Consumer::resume_partitions)
+     */
+    void resume_partitions(const TopicPartitionList& topic_partitions);
+
+    /**
+     * Gets the consumer's assignment (see Consumer::get_assignment)
+     */
+    TopicPartitionList get_assignment() const;
+
+    /**
+     * Gets the consumer
+     */
+    Consumer& get_consumer();
+private:
+    struct Level {
+        unsigned priority;
+        unsigned weight;
+        // Empty for the default level, which uses the consumer queue
+        Queue queue;
+    };
+
+    Level& get_level(unsigned priority, unsigned weight);
+    Level* find_level(const TopicPartition& topic_partition);
+    void on_assignment(const TopicPartitionList& topic_partitions);
+    void on_revocation(const TopicPartitionList& topic_partitions);
+    Message consume(const Level& level, std::chrono::milliseconds timeout);
+    Message poll_strict();
+    Message poll_weighted();
+
+    Consumer& consumer_;
+    Mode mode_;
+    Queue consumer_queue_;
+    // Sorted by priority, highest first
+    std::vector<Level> levels_;
+    std::map<std::string, unsigned> topic_priorities_;
+    std::map<TopicPartition, unsigned> partition_priorities_;
+    std::map<TopicPartition, unsigned> forwarded_partitions_;
+    Consumer::AssignmentCallback original_assignment_callback_;
+    Consumer::RevocationCallback original_revocation_callback_;
+    std::chrono::milliseconds idle_wait_;
+    size_t current_level_{0};
+    unsigned current_credits_{0};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_PRIORITY_POLLER_H
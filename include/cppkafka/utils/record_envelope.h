@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_RECORD_ENVELOPE_H
+#define CPPKAFKA_RECORD_ENVELOPE_H
+
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include "../buffer.h"
+#include "../macros.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Packs several records into a single message payload
+ *
+ * An envelope starts with a single marker byte followed by every record, each of them
+ * prefixed by its size encoded as an unsigned LEB128 varint. This means records smaller than
+ * 128 bytes only take a single extra byte.
+ *
+ * Envelopes are meant to be unpacked using an EnvelopeReader.
+ */
+class CPPKAFKA_API EnvelopeBuilder {
+public:
+    /**
+     * The marker byte every envelope starts with
+     */
+    static const uint8_t ENVELOPE_MARKER;
+
+    /**
+     * \brief Gets the number of bytes a record of the given size takes inside an envelope
+     *
+     * \param record_size The size of the record
+     */
+    static size_t get_record_size(size_t record_size);
+
+    /**
+     * \brief Adds a record to this envelope
+     *
+     * \param record The record to be added
+     */
+    void add_record(const Buffer& record);
+
+    /**
+     * \brief Reserves space for the given number of bytes
+     *
+     * \param size The number of bytes to reserve
+     */
+    void reserve(size_t size);
+
+    /**
+     * Removes every record in this envelope
+     */
+    void clear();
+
+    /**
+     * Gets the size of the envelope, including its marker
+     */
+    size_t get_size() const;
+
+    /**
+     * Gets the number of records in this envelope
+     */
+    size_t get_record_count() const;
+
+    /**
+     * Indicates whether this envelope has no records
+     */
+    bool empty() const;
+
+    /**
+     * \brief Gets a view of this envelope's contents
+     *
+     * The buffer is valid until this envelope is modified or destroyed.
+     */
+    Buffer get_buffer() const;
+private:
+    std::vector<uint8_t> data_;
+    size_t record_count_{0};
+};
+
+/**
+ * \brief Iterates the records packed in an envelope without copying them
+ *
+ * Every record is returned as a Buffer pointing into the envelope's payload, so the
+ * message it came from has to be kept alive while the records are being used.
+ *
+ * \code
+ * Message msg = consumer.poll();
+ * for (const Buffer& record : EnvelopeReader(msg.get_payload())) {
+ *     process(record);
+ * }
+ * \endcode
+ *
+ * An Exception will be thrown while iterating if the envelope is malformed.
+ */
+class CPPKAFKA_API EnvelopeReader {
+public:
+    /**
+     * Iterator over the records in an envelope
+     */
+    class CPPKAFKA_API Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Buffer;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Buffer*;
+        using reference = Buffer;
+
+        Iterator(const uint8_t* position, const uint8_t* end);
+
+        Buffer operator*() const;
+        Iterator& operator++();
+        bool operator==(const Iterator& rhs) const;
+        bool operator!=(const Iterator& rhs) const;
+    private:
+        void read_record();
+
+        const uint8_t* position_;
+        const uint8_t* next_;
+        const uint8_t* end_;
+        const uint8_t* record_data_{nullptr};
+        size_t record_size_{0};
+    };
+
+    /**
+     * \brief Indicates whether the given payload looks like an envelope
+     *
+     * \param payload The payload to be checked
+     */
+    static bool is_envelope(const Buffer& payload);
+
+    /**
+     * \brief Constructs an envelope reader
+     *
+     * An Exception is thrown if the payload is not an envelope.
+     *
+     * \param payload The envelope's payload. This has to outlive this object
+     */
+    EnvelopeReader(const Buffer& payload);
+
+    /**
+     * Gets an iterator to the first record
+     */
+    Iterator begin() const;
+
+    /**
+     * Gets an iterator past the last record
+     */
+    Iterator end() const;
+private:
+    const uint8_t* begin_;
+    const uint8_t* end_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_RECORD_ENVELOPE_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_SERIALIZER_H
+#define CPPKAFKA_SERIALIZER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include "../buffer.h"
+#include "../exceptions.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Converts objects of type T to and from the bytes stored in kafka messages
+ *
+ * Serializers are used by TypedProducer and TypedConsumer. A serializer is any type having
+ * these static member functions:
+ *
+ * \code
+ * // Appends the encoded value to the output buffer
+ * static void serialize(const T& value, std::string& output);
+ *
+ * // Decodes a value, throwing a ParseException if it's malformed
+ * static T deserialize(const Buffer& buffer);
+ * \endcode
+ *
+ * Specializations are provided for std::string, std::vector<uint8_t> and integral types
+ * (encoded in big endian order using their full width). Other types can either specialize
+ * this template or use their own serializer types.
+ */
+template <typename T, typename Enable = void>
+struct Serializer;
+
+template <>
+struct Serializer<std::string> {
+    static void serialize(const std::string& value, std::string& output) {
+        output.append(value);
+    }
+
+    static std::string deserialize(const Buffer& buffer) {
+        return buffer;
+    }
+};
+
+template <>
+struct Serializer<std::vector<uint8_t>> {
+    static void serialize(const std::vector<uint8_t>& value, std::string& output) {
+        output.append(value.begin(), value.end());
+    }
+
+    static std::vector<uint8_t> deserialize(const Buffer& buffer) {
+        return buffer;
+    }
+};
+
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_integral<T>::value &&
+                                             !std::is_same<T, bool>::value>::type> {
+    using UnsignedType = typename std::make_unsigned<T>::type;
+
+    static void serialize(T value, std::string& output) {
+        const UnsignedType bits = static_cast<UnsignedType>(value);
+        for (size_t i = sizeof(T); i > 0; --i) {
+            output.push_back(static_cast<char>((bits >> ((i - 1) * 8)) & 0xff));
+        }
+    }
+
+    static T deserialize(const Buffer& buffer) {
+        if (buffer.get_size() != sizeof(T)) {
+            throw ParseException("Expected " + std::to_string(sizeof(T)) + " bytes, got " +
+                                 std::to_string(buffer.get_size()));
+        }
+        UnsignedType bits = 0;
+        for (uint8_t byte : buffer) {
+            bits = static_cast<UnsignedType>((bits << 8) | byte);
+        }
+        return static_cast<T>(bits);
+    }
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_SERIALIZER_H
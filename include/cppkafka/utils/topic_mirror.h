@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_TOPIC_MIRROR_H
+#define CPPKAFKA_TOPIC_MIRROR_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <functional>
+#include "../producer.h"
+#include "../consumer.h"
+#include "../message.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Mirrors consumed messages into a producer without copying their payloads
+ *
+ * This class takes ownership of messages consumed by a Consumer and produces them using
+ * its own Producer, configured with Producer::PayloadPolicy::PASSTHROUGH_PAYLOAD. This means
+ * the payload that rdkafka sends is the one living inside the consumed message, so no copies
+ * are performed.
+ *
+ * Every consumed message is kept alive until its delivery report is received. Source offsets
+ * are only committed once every message up to them has been delivered, which provides
+ * at-least-once semantics: if the process dies, anything that wasn't acknowledged will be
+ * consumed and mirrored again.
+ *
+ * Delivery reports are served when calling TopicMirror::poll or TopicMirror::flush. Note that
+ * offsets are never committed implicitly, TopicMirror::commit has to be called to do so.
+ *
+ * \code
+ * Consumer consumer(source_config);
+ * consumer.subscribe({ "events" });
+ *
+ * TopicMirror mirror(consumer, destination_config);
+ * mirror.set_topic_mapper([](const Message& msg) {
+ *     return "mirror." + msg.get_topic();
+ * });
+ *
+ * while (running) {
+ *     Message msg = consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         mirror.mirror(move(msg));
+ *     }
+ *     // Serve delivery reports and commit whatever has been delivered so far
+ *     mirror.poll();
+ *     mirror.commit();
+ * }
+ * // Wait for everything to be delivered and commit it
+ * mirror.flush();
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+class CPPKAFKA_API TopicMirror {
+public:
+    /**
+     * Callback used to decide the topic a message will be mirrored into
+     */
+    using TopicMapper = std::function<std::string(const Message&)>;
+
+    /**
+     * Callback to indicate a message failed to be produced.
+     */
+    using ProduceFailureCallback = std::function<bool(const Message&)>;
+
+    /**
+     * \brief Constructs a topic mirror
+     *
+     * \param consumer The consumer the mirrored messages come from. Offsets will be committed
+     * using it
+     * \param config The configuration to be used on the destination Producer
+     */
+    TopicMirror(Consumer& consumer, Configuration config);
+
+    TopicMirror(const TopicMirror&) = delete;
+    TopicMirror(TopicMirror&&) = delete;
+    TopicMirror& operator=(const TopicMirror&) = delete;
+    TopicMirror& operator=(TopicMirror&&) = delete;
+
+    /**
+     * \brief Mirrors a message
+     *
+     * The message will be produced without copying its payload and will be kept alive
+     * until it's acknowledged by the destination brokers.
+     *
+     * If producing fails with anything but a full queue, the exception is propagated and the
+     * message isn't tracked, so it doesn't hold back its partition's commits.
+     *
+     * \param message The consumed message to be mirrored
+     */
+    void mirror(Message message);
+
+    /**
+     * \brief Serves any pending delivery reports without blocking
+     *
+     * Returns the number of events served
+     */
+    int poll();
+
+    /**
+     * \brief Commits the offsets of every message that has been delivered
+     *
+     * For each source topic/partition, the committed offset will be the one following the
+     * last message for which it and every previous one have been delivered. This translates
+     * into a single Consumer::async_commit call for all topic/partitions that moved forward
+     * since the last commit.
+     */
+    void commit();
+
+    /**
+     * \brief Waits until every mirrored message is delivered and commits their offsets
+     */
+    void flush();
+
+    /**
+     * Gets the number of mirrored messages which haven't been delivered yet
+     */
+    size_t get_pending_count() const;
+
+    /**
+     * \brief Sets the topic mapper callback
+     *
+     * By default, messages are mirrored into a topic with the same name as the source one
+     *
+     * \param callback The callback to be set
+     */
+    void set_topic_mapper(TopicMapper callback);
+
+    /**
+     * \brief Sets whether messages should be produced into the same partition they came from
+     *
+     * By default this is false and the destination topic's partitioner will be used
+     *
+     * \param value The value to be set
+     */
+    void set_preserve_partitions(bool value);
+
+    /**
+     * \brief Sets the message produce failure callback
+     *
+     * This will be called when the delivery report callback is executed for a message having
+     * an error. The callback should return true if the message should be re-sent, otherwise
+     * false. If it returns false, the message will be considered delivered and its offset
+     * will be committed.
+     *
+     * \param callback The callback to be set
+     */
+    void set_produce_failure_callback(ProduceFailureCallback callback);
+
+    /**
+     * Gets the Producer object
+     */
+    Producer& get_producer();
+
+    /**
+     * Gets the Producer object
+     */
+    const Producer& get_producer() const;
+private:
+    struct PartitionState;
+
+    struct PendingMessage {
+        PendingMessage(Message msg, PartitionState& state);
+
+        Message message;
+        PartitionState* owner;
+        bool delivered;
+    };
+
+    struct PartitionState {
+        std::deque<PendingMessage> messages;
+        int64_t next_offset{TopicPartition::OFFSET_INVALID};
+        bool needs_commit{false};
+    };
+
+    Configuration prepare_configuration(Configuration config);
+    void produce_message(PendingMessage& pending);
+    void on_delivery_report(const Message& message);
+
+    Consumer& consumer_;
+    // Declared before the producer so they outlive any payload the producer still points to
+    std::map<TopicPartition, PartitionState> partitions_;
+    Producer producer_;
+    TopicMapper topic_mapper_;
+    ProduceFailureCallback produce_failure_callback_;
+    size_t pending_count_{0};
+    bool preserve_partitions_{false};
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_TOPIC_MIRROR_H
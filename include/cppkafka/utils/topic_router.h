@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_TOPIC_ROUTER_H
+#define CPPKAFKA_TOPIC_ROUTER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <librdkafka/rdkafka.h>
+#include "../consumer.h"
+#include "../message.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Routes messages to a different handler depending on their topic
+ *
+ * Each topic added is resolved once to the rdkafka topic handle the consumer uses for it
+ * (which lives as long as the consumer does) and to a small id, the index of its handler.
+ * Routing a message is then a lookup of its topic handle, without building or comparing
+ * topic name strings. Messages for topics that weren't added go to the default handler.
+ *
+ * This is a message callback, so it can be used directly with BasicConsumerDispatcher:
+ *
+ * \code
+ * Consumer consumer(config);
+ * consumer.subscribe({ "orders", "payments" });
+ *
+ * TopicRouter router(consumer);
+ * router.add_route("orders", [](Message msg) {
+ *     process_order(msg);
+ * });
+ * router.add_route("payments", [](Message msg) {
+ *     process_payment(msg);
+ * });
+ *
+ * ConsumerDispatcher dispatcher(consumer);
+ * dispatcher.run(router);
+ * \endcode
+ *
+ * Copies of a router route independently of each other.
+ */
+class CPPKAFKA_API TopicRouter {
+public:
+    /**
+     * Callback executed for every message routed to it
+     */
+    using Handler = std::function<void(Message)>;
+
+    /**
+     * \brief Constructs a topic router
+     *
+     * \param consumer The consumer the messages being routed come from
+     */
+    TopicRouter(Consumer& consumer);
+
+    /**
+     * \brief Adds a handler for a topic
+     *
+     * If the topic already had a handler, it's replaced
+     *
+     * \param topic The topic to be routed
+     * \param handler The handler to be used
+     */
+    TopicRouter& add_route(const std::string& topic, Handler handler);
+
+    /**
+     * \brief Sets the handler for messages on topics that weren't added
+     *
+     * If no default handler is set, routing such a message throws ElementNotFound
+     *
+     * \param handler The handler to be used
+     */
+    TopicRouter& set_default_route(Handler handler);
+
+    /**
+     * Gets the number of topics routed
+     */
+    size_t get_route_count() const;
+
+    /**
+     * \brief Routes a message to its topic's handler
+     *
+     * \param message The message to be routed
+     */
+    void operator()(Message message) const;
+private:
+    static const size_t DEFAULT_ROUTE;
+
+    size_t get_route(const Message& message) const;
+    rd_kafka_topic_t* get_topic_handle(const std::string& topic) const;
+
+    Consumer& consumer_;
+    std::vector<std::string> topics_;
+    std::vector<Handler> handlers_;
+    Handler default_handler_;
+    // Topics that show up without having been added are resolved on their first message
+    mutable std::unordered_map<rd_kafka_topic_t*, size_t> routes_;
+};
+
+} // cppkafka
+
+#endif // CPPKAFKA_TOPIC_ROUTER_H
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_TYPED_CONSUMER_H
+#define CPPKAFKA_TYPED_CONSUMER_H
+
+#include <chrono>
+#include <string>
+#include <boost/optional.hpp>
+#include "../consumer.h"
+#include "../message.h"
+#include "serializer.h"
+
+namespace cppkafka {
+
+/**
+ * \brief A message whose key and value are decoded on first access
+ *
+ * The key and the value are decoded independently the first time they're requested and
+ * then cached, so messages (or parts of them) that are never read are never decoded. If
+ * decoding fails, the deserializer's exception is propagated and the next access will try
+ * decoding again.
+ *
+ * Note that this doesn't check whether the message has an error: use
+ * TypedMessage::get_error before accessing its key or value.
+ */
+template <typename Key, typename Value, typename KeyDeserializer = Serializer<Key>,
+          typename ValueDeserializer = Serializer<Value>>
+class TypedMessage {
+public:
+    /**
+     * Constructs an empty message
+     */
+    TypedMessage() = default;
+
+    /**
+     * \brief Constructs a typed message
+     *
+     * \param message The message to be wrapped
+     */
+    explicit TypedMessage(Message message);
+
+    /**
+     * Gets the decoded key
+     */
+    const Key& get_key() const;
+
+    /**
+     * Gets the decoded value
+     */
+    const Value& get_value() const;
+
+    /**
+     * Gets the message's error
+     */
+    Error get_error() const;
+
+    /**
+     * Gets the message's topic
+     */
+    std::string get_topic() const;
+
+    /**
+     * Gets the message's partition
+     */
+    int get_partition() const;
+
+    /**
+     * Gets the message's offset
+     */
+    int64_t get_offset() const;
+
+    /**
+     * Gets the wrapped message
+     */
+    Message& get_message();
+
+    /**
+     * Gets the wrapped message
+     */
+    const Message& get_message() const;
+
+    /**
+     * Indicates whether this message is valid (see Message::operator bool)
+     */
+    explicit operator bool() const;
+private:
+    Message message_;
+    mutable boost::optional<Key> key_;
+    mutable boost::optional<Value> value_;
+};
+
+/**
+ * \brief Polls a consumer and wraps its messages into TypedMessages
+ *
+ * This is a thin view over a Consumer: polling doesn't decode anything, as the returned
+ * messages decode their key and value lazily.
+ *
+ * \code
+ * Consumer consumer(config);
+ * consumer.subscribe({ "some_topic" });
+ * TypedConsumer<uint64_t, std::string> typed_consumer(consumer);
+ *
+ * while (true) {
+ *     auto msg = typed_consumer.poll();
+ *     if (msg && !msg.get_error()) {
+ *         // Only the value is decoded here
+ *         cout << msg.get_value() << endl;
+ *     }
+ * }
+ * \endcode
+ */
+template <typename Key, typename Value, typename KeyDeserializer = Serializer<Key>,
+          typename ValueDeserializer = Serializer<Value>>
+class TypedConsumer {
+public:
+    /**
+     * The type of the messages returned by this consumer
+     */
+    using MessageType = TypedMessage<Key, Value, KeyDeserializer, ValueDeserializer>;
+
+    /**
+     * \brief Constructs a typed consumer
+     *
+     * \param consumer The consumer to be used
+     */
+    TypedConsumer(Consumer& consumer);
+
+    /**
+     * \brief Polls for a message using the consumer's timeout
+     */
+    MessageType poll();
+
+    /**
+     * \brief Polls for a message
+     *
+     * \param timeout The maximum time to wait for a message
+     */
+    MessageType poll(std::chrono::milliseconds timeout);
+
+    /**
+     * Gets the consumer
+     */
+    Consumer& get_consumer();
+private:
+    Consumer& consumer_;
+};
+
+// TypedMessage
+
+template <typename K, typename V, typename KD, typename VD>
+TypedMessage<K, V, KD, VD>::TypedMessage(Message message)
+: message_(std::move(message)) {
+
+}
+
+template <typename K, typename V, typename KD, typename VD>
+const K& TypedMessage<K, V, KD, VD>::get_key() const {
+    if (!key_) {
+        key_ = KD::deserialize(message_.get_key());
+    }
+    return *key_;
+}
+
+template <typename K, typename V, typename KD, typename VD>
+const V& TypedMessage<K, V, KD, VD>::get_value() const {
+    if (!value_) {
+        value_ = VD::deserialize(message_.get_payload());
+    }
+    return *value_;
+}
+
+template <typename K, typename V, typename KD, typename VD>
+Error TypedMessage<K, V, KD, VD>::get_error() const {
+    return message_.get_error();
+}
+
+template <typename K, typename V, typename KD, typename VD>
+std::string TypedMessage<K, V, KD, VD>::get_topic() const {
+    return message_.get_topic();
+}
+
+template <typename K, typename V, typename KD, typename VD>
+int TypedMessage<K, V, KD, VD>::get_partition() const {
+    return message_.get_partition();
+}
+
+template <typename K, typename V, typename KD, typename VD>
+int64_t TypedMessage<K, V, KD, VD>::get_offset() const {
+    return message_.get_offset();
+}
+
+template <typename K, typename V, typename KD, typename VD>
+Message& TypedMessage<K, V, KD, VD>::get_message() {
+    return message_;
+}
+
+template <typename K, typename V, typename KD, typename VD>
+const Message& TypedMessage<K, V, KD, VD>::get_message() const {
+    return message_;
+}
+
+template <typename K, typename V, typename KD, typename VD>
+TypedMessage<K, V, KD, VD>::operator bool() const {
+    return static_cast<bool>(message_);
+}
+
+// TypedConsumer
+
+template <typename K, typename V, typename KD, typename VD>
+TypedConsumer<K, V, KD, VD>::TypedConsumer(Consumer& consumer)
+: consumer_(consumer) {
+
+}
+
+template <typename K, typename V, typename KD, typename VD>
+typename TypedConsumer<K, V, KD, VD>::MessageType TypedConsumer<K, V, KD, VD>::poll() {
+    return MessageType(consumer_.poll());
+}
+
+template <typename K, typename V, typename KD, typename VD>
+typename TypedConsumer<K, V, KD, VD>::MessageType
+TypedConsumer<K, V, KD, VD>::poll(std::chrono::milliseconds timeout) {
+    return MessageType(consumer_.poll(timeout));
+}
+
+template <typename K, typename V, typename KD, typename VD>
+Consumer& TypedConsumer<K, V, KD, VD>::get_consumer() {
+    return consumer_;
+}
+
+} // cppkafka
+
+#endif // CPPKAFKA_TYPED_CONSUMER_H
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef CPPKAFKA_TYPED_PRODUCER_H
+#define CPPKAFKA_TYPED_PRODUCER_H
+
+#include <string>
+#include "../producer.h"
+#include "../message_builder.h"
+#include "../exceptions.h"
+#include "serializer.h"
+
+namespace cppkafka {
+
+/**
+ * \brief Produces keys and values of a given type, serializing them into reusable buffers
+ *
+ * Keys and values are serialized straight into a pair of buffers owned by this object, which
+ * are reused for every message so their capacity grows to fit the largest message produced
+ * and then no more allocations are performed. The serializers are template parameters, so
+ * the calls are resolved (and usually inlined) at compile time.
+ *
+ * Since the buffers are reused, the producer's payload policy must be
+ * Producer::PayloadPolicy::COPY_PAYLOAD (the default), otherwise an exception is thrown when
+ * producing.
+ *
+ * \code
+ * Producer producer(config);
+ * TypedProducer<uint64_t, std::string> typed_producer(producer);
+ *
+ * typed_producer.produce("some_topic", user_id, user_name);
+ *
+ * // Use a builder to set the partition, headers, etc
+ * MessageBuilder builder("some_topic");
+ * builder.partition(3);
+ * typed_producer.produce(builder, user_id, user_name);
+ * \endcode
+ *
+ * This class is not thread safe.
+ */
+template <typename Key, typename Value, typename KeySerializer = Serializer<Key>,
+          typename ValueSerializer = Serializer<Value>>
+class TypedProducer {
+public:
+    /**
+     * \brief Constructs a typed producer
+     *
+     * \param producer The producer to be used
+     */
+    TypedProducer(Producer& producer);
+
+    /**
+     * \brief Produces a message letting rdkafka choose its partition
+     *
+     * \param topic The topic to produce to
+     * \param key The message's key
+     * \param value The message's value
+     */
+    void produce(const std::string& topic, const Key& key, const Value& value);
+
+    /**
+     * \brief Produces a message using the given builder
+     *
+     * The builder's key and payload are overwritten and point to this object's buffers
+     * after this call, so they're only valid until the next message is produced.
+     *
+     * \param builder The builder to be used
+     * \param key The message's key
+     * \param value The message's value
+     */
+    void produce(MessageBuilder& builder, const Key& key, const Value& value);
+
+    /**
+     * Gets the producer
+     */
+    Producer& get_producer();
+private:
+    Producer& producer_;
+    std::string key_buffer_;
+    std::string value_buffer_;
+};
+
+template <typename K, typename V, typename KS, typename VS>
+TypedProducer<K, V, KS, VS>::TypedProducer(Producer& producer)
+: producer_(producer) {
+
+}
+
+template <typename K, typename V, typename KS, typename VS>
+void TypedProducer<K, V, KS, VS>::produce(const std::string& topic, const K& key,
+                                          const V& value) {
+    MessageBuilder builder(topic);
+    produce(builder, key, value);
+}
+
+template <typename K, typename V, typename KS, typename VS>
+void TypedProducer<K, V, KS, VS>::produce(MessageBuilder& builder, const K& key,
+                                          const V& value) {
+    if (producer_.get_payload_policy() != Producer::PayloadPolicy::COPY_PAYLOAD) {
+        throw Exception("TypedProducer requires the COPY_PAYLOAD payload policy");
+    }
+    key_buffer_.clear();
+    value_buffer_.clear();
+    KS::serialize(key, key_buffer_);
+    VS::serialize(value, value_buffer_);
+    builder.key(Buffer(key_buffer_)).payload(Buffer(value_buffer_));
+    producer_.produce(builder);
+}
+
+template <typename K, typename V, typename KS, typename VS>
+Producer& TypedProducer<K, V, KS, VS>::get_producer() {
+    return producer_;
+}
+
+} // cppkafka
+
+#endif // CPPKAFKA_TYPED_PRODUCER_H
@@ -50,26 +50,6 @@ Buffer::Buffer(const string& data)
 
 }
 
-const Buffer::DataType* Buffer::get_data() const {
-    return data_;
-}
-
-size_t Buffer::get_size() const {
-    return size_;
-}
-
-Buffer::const_iterator Buffer::begin() const {
-    return data_;
-}
-
-Buffer::const_iterator Buffer::end() const {
-    return data_ + size_;
-}
-
-Buffer::operator bool() const {
-    return size_ != 0;
-}
-
 Buffer::operator string() const {
     return string(data_, data_ + size_);
 }
@@ -31,11 +31,13 @@
 #include "exceptions.h"
 #include "configuration.h"
 #include "topic_partition_list.h"
+#include "topic.h"
 
 using std::vector;
 using std::string;
 using std::move;
 using std::make_tuple;
+using std::to_string;
 
 using std::chrono::milliseconds;
 
@@ -105,6 +107,38 @@ void Consumer::unassign() {
     check_error(error);
 }
 
+#if RD_KAFKA_VERSION >= 0x010600ff
+
+void Consumer::incremental_assign(const TopicPartitionList& topic_partitions) {
+    TopicPartitionsListPtr topic_list_handle = convert(topic_partitions);
+    check_error(rd_kafka_incremental_assign(get_handle(), topic_list_handle.get()));
+}
+
+void Consumer::incremental_unassign(const TopicPartitionList& topic_partitions) {
+    TopicPartitionsListPtr topic_list_handle = convert(topic_partitions);
+    check_error(rd_kafka_incremental_unassign(get_handle(), topic_list_handle.get()));
+}
+
+string Consumer::get_rebalance_protocol() const {
+    const char* protocol = rd_kafka_rebalance_protocol(get_handle());
+    return protocol ? protocol : "NONE";
+}
+
+bool Consumer::is_cooperative() const {
+    return get_rebalance_protocol() == "COOPERATIVE";
+}
+
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+
+void Consumer::seek(const TopicPartition& topic_partition) {
+    Topic topic = get_topic(topic_partition.get_topic());
+    rd_kafka_resp_err_t error = rd_kafka_seek(topic.get_handle(),
+                                              topic_partition.get_partition(),
+                                              topic_partition.get_offset(),
+                                              static_cast<int>(get_timeout().count()));
+    check_error(error);
+}
+
 void Consumer::commit(const Message& msg) {
     commit(msg, false);
 }
@@ -191,6 +225,21 @@ Message Consumer::poll() {
     return poll(get_timeout());
 }
 
+Queue Consumer::get_consumer_queue() const {
+    return Queue(rd_kafka_queue_get_consumer(get_handle()));
+}
+
+Queue Consumer::get_partition_queue(const TopicPartition& topic_partition) const {
+    rd_kafka_queue_t* handle = rd_kafka_queue_get_partition(get_handle(),
+                                                            topic_partition.get_topic().c_str(),
+                                                            topic_partition.get_partition());
+    if (!handle) {
+        throw Exception("Failed to get queue for " + topic_partition.get_topic() + "/" +
+                        to_string(topic_partition.get_partition()));
+    }
+    return Queue(handle);
+}
+
 Message Consumer::poll(milliseconds timeout) {
     rd_kafka_message_t* message = rd_kafka_consumer_poll(get_handle(),
                                                          static_cast<int>(timeout.count()));
@@ -218,6 +267,12 @@ void Consumer::commit(const TopicPartitionList& topic_partitions, bool async) {
 
 void Consumer::handle_rebalance(rd_kafka_resp_err_t error,
                                 TopicPartitionList& topic_partitions) {
+#if RD_KAFKA_VERSION >= 0x010600ff
+    if (is_cooperative()) {
+        handle_incremental_rebalance(error, topic_partitions);
+        return;
+    }
+#endif // RD_KAFKA_VERSION >= 0x010600ff
     if (error == RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS) {
         if (assignment_callback_) {
             assignment_callback_(topic_partitions);
@@ -238,4 +293,40 @@ void Consumer::handle_rebalance(rd_kafka_resp_err_t error,
     }
 }
 
+#if RD_KAFKA_VERSION >= 0x010600ff
+
+void Consumer::handle_incremental_rebalance(rd_kafka_resp_err_t error,
+                                            TopicPartitionList& topic_partitions) {
+    // Partition lists only contain the partitions being added/removed here
+    if (error == RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS) {
+        if (assignment_callback_) {
+            assignment_callback_(topic_partitions);
+        }
+        incremental_assign(topic_partitions);
+    }
+    else if (error == RD_KAFKA_RESP_ERR__REVOKE_PARTITIONS) {
+        if (revocation_callback_) {
+            revocation_callback_(topic_partitions);
+        }
+        incremental_unassign(topic_partitions);
+    }
+    else {
+        if (rebalance_error_callback_) {
+            rebalance_error_callback_(error);
+        }
+        // Full unassigns aren't allowed with this protocol, drop every partition instead
+        incremental_unassign(get_assignment());
+    }
+}
+
+void Consumer::check_error(rd_kafka_error_t* error) const {
+    if (error) {
+        const rd_kafka_resp_err_t code = rd_kafka_error_code(error);
+        rd_kafka_error_destroy(error);
+        throw HandleException(code);
+    }
+}
+
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+
 } // cppkafka
@@ -108,4 +108,11 @@ Error ConsumerException::get_error() const {
     return error_;
 }
 
+// CircuitOpenException
+
+CircuitOpenException::CircuitOpenException()
+: Exception("Circuit breaker is open") {
+
+}
+
 } // cppkafka
@@ -84,14 +84,22 @@ rd_kafka_t* KafkaHandleBase::get_handle() const {
 }
 
 Topic KafkaHandleBase::get_topic(const string& name) {
+    rd_kafka_topic_t* handle = find_topic_handle(name);
+    if (handle) {
+        return Topic::make_non_owning(handle);
+    }
     save_topic_config(name, TopicConfiguration{});
     return get_topic(name, nullptr);
 }
 
 Topic KafkaHandleBase::get_topic(const string& name, TopicConfiguration config) {
-    auto handle = config.get_handle();
-    save_topic_config(name, move(config));
-    return get_topic(name, rd_kafka_topic_conf_dup(handle));
+    rd_kafka_topic_t* handle = find_topic_handle(name);
+    if (handle) {
+        return Topic::make_non_owning(handle);
+    }
+    // If there was already a configuration for this topic, the one that was kept is used
+    const TopicConfiguration& saved_config = save_topic_config(name, move(config));
+    return get_topic(name, rd_kafka_topic_conf_dup(saved_config.get_handle()));
 }
 
 KafkaHandleBase::OffsetTuple
@@ -170,11 +178,57 @@ void KafkaHandleBase::set_handle(rd_kafka_t* handle) {
 }
 
 Topic KafkaHandleBase::get_topic(const string& name, rd_kafka_topic_conf_t* conf) {
+    lock_guard<mutex> _(topic_configurations_mutex_);
+    // Someone else may have created it while we weren't holding the lock
+    if (topic_handle_map_) {
+        auto iter = topic_handle_map_->find(name);
+        if (iter != topic_handle_map_->end()) {
+            if (conf) {
+                rd_kafka_topic_conf_destroy(conf);
+            }
+            return Topic::make_non_owning(iter->second);
+        }
+    }
     rd_kafka_topic_t* topic = rd_kafka_topic_new(get_handle(), name.data(), conf);
     if (!topic) {
         throw HandleException(rd_kafka_errno2err(errno));
     }
-    return Topic(topic);
+    topic_handles_.emplace_back(topic, &rd_kafka_topic_destroy);
+    publish_topic_handle(name, topic);
+    return Topic::make_non_owning(topic);
+}
+
+rd_kafka_topic_t* KafkaHandleBase::find_topic_handle(const string& name) const {
+    rd_kafka_topic_t* output = nullptr;
+    // Announce we're reading before loading the map, so it's not freed while we use it
+    topic_handle_readers_.fetch_add(1);
+    const TopicHandleMap* handle_map = current_topic_handle_map_.load();
+    if (handle_map) {
+        auto iter = handle_map->find(name);
+        if (iter != handle_map->end()) {
+            output = iter->second;
+        }
+    }
+    topic_handle_readers_.fetch_sub(1);
+    return output;
+}
+
+void KafkaHandleBase::publish_topic_handle(const string& name, rd_kafka_topic_t* handle) {
+    // Note that this is called while holding topic_configurations_mutex_
+    TopicHandleMap* handle_map = topic_handle_map_ ? new TopicHandleMap(*topic_handle_map_)
+                                                   : new TopicHandleMap();
+    TopicHandleMapPtr new_map(handle_map);
+    handle_map->emplace(name, handle);
+    current_topic_handle_map_.store(handle_map);
+    if (topic_handle_map_) {
+        retired_topic_handle_maps_.push_back(move(topic_handle_map_));
+    }
+    topic_handle_map_ = move(new_map);
+    // Anyone reading from now on will see the new map, so if there's no one reading right
+    // now, none of the old ones are in use
+    if (topic_handle_readers_.load() == 0) {
+        retired_topic_handle_maps_.clear();
+    }
 }
 
 Metadata KafkaHandleBase::get_metadata(bool all_topics, rd_kafka_topic_t* topic_ptr) const {
@@ -204,10 +258,12 @@ vector<GroupInformation> KafkaHandleBase::fetch_consumer_groups(const char* name
     return groups;
 }
 
-void KafkaHandleBase::save_topic_config(const string& topic_name, TopicConfiguration config) {
+const TopicConfiguration& KafkaHandleBase::save_topic_config(const string& topic_name,
+                                                             TopicConfiguration config) {
     lock_guard<mutex> _(topic_configurations_mutex_);
     auto iter = topic_configurations_.emplace(topic_name, move(config)).first;
     iter->second.set_as_opaque();
+    return iter->second;
 }
 
 void KafkaHandleBase::check_error(rd_kafka_resp_err_t error) const {
@@ -29,6 +29,8 @@
 
 #include "message.h"
 
+using std::string;
+
 using std::chrono::milliseconds;
 
 namespace cppkafka {
@@ -63,6 +65,24 @@ Message::Message(HandlePtr handle)
 
 }
 
+#if RD_KAFKA_VERSION >= 0x000b04ff
+
+Buffer Message::get_header(const string& name) const {
+    rd_kafka_headers_t* headers = nullptr;
+    if (rd_kafka_message_headers(handle_.get(), &headers) != RD_KAFKA_RESP_ERR_NO_ERROR) {
+        return Buffer();
+    }
+    const void* value = nullptr;
+    size_t size = 0;
+    if (rd_kafka_header_get_last(headers, name.data(), &value, &size) !=
+            RD_KAFKA_RESP_ERR_NO_ERROR || !value) {
+        return Buffer();
+    }
+    return Buffer(static_cast<const Buffer::DataType*>(value), size);
+}
+
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
 // MessageTimestamp
 
 MessageTimestamp::MessageTimestamp(milliseconds timestamp, TimestampType type)
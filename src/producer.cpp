@@ -30,6 +30,7 @@
 #include <errno.h>
 #include "producer.h"
 #include "exceptions.h"
+#include "message.h"
 
 using std::move;
 using std::string;
@@ -39,10 +40,17 @@ using std::chrono::milliseconds;
 namespace cppkafka {
 
 Producer::Producer(Configuration config)
-: KafkaHandleBase(move(config)), message_payload_policy_(PayloadPolicy::COPY_PAYLOAD) {
+: KafkaHandleBase(move(config)), message_payload_policy_(PayloadPolicy::COPY_PAYLOAD),
+  delivery_reports_enabled_(static_cast<bool>(get_configuration()
+                                                  .get_delivery_report_callback())) {
     char error_buffer[512];
     auto config_handle = get_configuration().get_handle();
     rd_kafka_conf_set_opaque(config_handle, this);
+    // Only enable delivery reports if asked to. Otherwise rdkafka keeps every delivered message
+    // in the reply queue until the producer is polled
+    if (delivery_reports_enabled_) {
+        rd_kafka_conf_set_dr_msg_cb(config_handle, &Producer::delivery_report_proxy);
+    }
     rd_kafka_t* ptr = rd_kafka_new(RD_KAFKA_PRODUCER,
                                    rd_kafka_conf_dup(config_handle),
                                    error_buffer, sizeof(error_buffer));
@@ -62,9 +70,16 @@ Producer::PayloadPolicy Producer::get_payload_policy() const {
 }
 
 void Producer::produce(const MessageBuilder& builder) {
+    do_produce(builder, builder.user_data());
+}
+
+void Producer::do_produce(const MessageBuilder& builder, void* opaque) {
     const Buffer& payload = builder.payload();
     const Buffer& key = builder.key();
     const int policy = static_cast<int>(message_payload_policy_);
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    HeadersPtr headers = make_headers(builder.headers());
+#endif
     auto result = rd_kafka_producev(get_handle(),
                                     RD_KAFKA_V_TOPIC(builder.topic().data()),
                                     RD_KAFKA_V_PARTITION(builder.partition()),
@@ -72,11 +87,34 @@ void Producer::produce(const MessageBuilder& builder) {
                                     RD_KAFKA_V_TIMESTAMP(builder.timestamp().count()),
                                     RD_KAFKA_V_KEY((void*)key.get_data(), key.get_size()),
                                     RD_KAFKA_V_VALUE((void*)payload.get_data(), payload.get_size()),
-                                    RD_KAFKA_V_OPAQUE(builder.user_data()),
+#if RD_KAFKA_VERSION >= 0x000b04ff
+                                    RD_KAFKA_V_HEADERS(headers.get()),
+#endif
+                                    RD_KAFKA_V_OPAQUE(opaque),
                                     RD_KAFKA_V_END);
     check_error(result);
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    // rdkafka owns the headers once the message is enqueued
+    headers.release();
+#endif
 }
 
+#if RD_KAFKA_VERSION >= 0x000b04ff
+
+Producer::HeadersPtr Producer::make_headers(const MessageBuilder::HeaderList& header_list) {
+    if (header_list.empty()) {
+        return HeadersPtr(nullptr, &rd_kafka_headers_destroy);
+    }
+    HeadersPtr headers(rd_kafka_headers_new(header_list.size()), &rd_kafka_headers_destroy);
+    for (const auto& header : header_list) {
+        rd_kafka_header_add(headers.get(), header.first.data(), header.first.size(),
+                            header.second.data(), header.second.size());
+    }
+    return headers;
+}
+
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
 int Producer::poll() {
     return poll(get_timeout());
 }
@@ -94,4 +132,21 @@ void Producer::flush(milliseconds timeout) {
     check_error(result);
 }
 
+void Producer::delivery_report_proxy(rd_kafka_t*, const rd_kafka_message_t* msg,
+                                     void* opaque) {
+    Producer* handle = static_cast<Producer*>(opaque);
+    rd_kafka_message_t* message_handle = (rd_kafka_message_t*)msg;
+    auto slot = handle->delivery_callbacks_.find(message_handle->_private);
+    if (slot) {
+        // Give the message its original user data back before anyone sees it
+        message_handle->_private = slot->user_data;
+        handle->delivery_callbacks_.run(slot, Message::make_non_owning(message_handle));
+    }
+    Message message = Message::make_non_owning(message_handle);
+    const auto& callback = handle->get_configuration().get_delivery_report_callback();
+    if (callback) {
+        callback(*handle, message);
+    }
+}
+
 } // cppkafka
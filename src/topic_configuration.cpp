@@ -33,11 +33,13 @@
 #include "exceptions.h"
 #include "topic.h"
 #include "buffer.h"
+#include "detail/partitioner_cache.h"
 
 using std::string;
 using std::map;
 using std::vector;
 using std::initializer_list;
+using std::make_shared;
 
 namespace cppkafka {
 
@@ -47,9 +49,24 @@ int32_t partitioner_callback_proxy(const rd_kafka_topic_t* handle, const void *k
     const TopicConfiguration* config = static_cast<TopicConfiguration*>(topic_opaque);
     const auto& callback = config->get_partitioner_callback();
     if (callback) {
+        detail::PartitionerCache* cache = config->partitioner_cache_.get();
+        const char* key_data = static_cast<const char*>(key_ptr);
+        const char* topic_name = nullptr;
+        int32_t partition;
+        if (cache) {
+            topic_name = rd_kafka_topic_name(handle);
+            if (cache->find(topic_name, key_data, key_size, partition_count, partition)) {
+                return partition;
+            }
+        }
         Topic topic = Topic::make_non_owning(const_cast<rd_kafka_topic_t*>(handle));
-        Buffer key(static_cast<const char*>(key_ptr), key_size);
-        return callback(topic, key, partition_count);
+        Buffer key(key_data, key_size);
+        partition = callback(topic, key, partition_count);
+        // Don't cache failures, these may be transient
+        if (cache && partition != RD_KAFKA_PARTITION_UA) {
+            cache->store(topic_name, key_data, key_size, partition_count, partition);
+        }
+        return partition;
     }
     else {
         return rd_kafka_msg_partitioner_consistent_random(handle, key_ptr, key_size, 
@@ -92,6 +109,19 @@ TopicConfiguration& TopicConfiguration::set(const string& name, const string& va
 TopicConfiguration& TopicConfiguration::set_partitioner_callback(PartitionerCallback callback) {
     partitioner_callback_ = move(callback);
     rd_kafka_topic_conf_set_partitioner_cb(handle_.get(), &partitioner_callback_proxy);
+    if (partitioner_cache_) {
+        set_partitioner_cache_size(partitioner_cache_->get_size());
+    }
+    return *this;
+}
+
+TopicConfiguration& TopicConfiguration::set_partitioner_cache_size(size_t size) {
+    if (size == 0) {
+        partitioner_cache_.reset();
+    }
+    else {
+        partitioner_cache_ = make_shared<detail::PartitionerCache>(size);
+    }
     return *this;
 }
 
@@ -105,6 +135,10 @@ TopicConfiguration::get_partitioner_callback() const {
     return partitioner_callback_;
 }
 
+size_t TopicConfiguration::get_partitioner_cache_size() const {
+    return partitioner_cache_ ? partitioner_cache_->get_size() : 0;
+}
+
 bool TopicConfiguration::has_property(const string& name) const {
     size_t size = 0;
     return rd_kafka_topic_conf_get(handle_.get(), name.data(), nullptr, &size) == RD_KAFKA_CONF_OK;
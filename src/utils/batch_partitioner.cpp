@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/batch_partitioner.h"
+#include "exceptions.h"
+
+using std::string;
+using std::vector;
+using std::min;
+
+namespace cppkafka {
+
+namespace {
+
+const uint32_t MURMUR2_SEED = 0x9747b28c;
+const uint32_t MURMUR2_MULTIPLIER = 0x5bd1e995;
+// Keys hashed in lockstep by the murmur2 batch partitioner
+const size_t MURMUR2_LANES = 4;
+
+uint32_t read_le32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint32_t murmur2_mix(uint32_t hash, uint32_t value) {
+    value *= MURMUR2_MULTIPLIER;
+    value ^= value >> 24;
+    value *= MURMUR2_MULTIPLIER;
+    return (hash * MURMUR2_MULTIPLIER) ^ value;
+}
+
+// Hashes the words starting at the given index, the trailing bytes and finalizes the hash
+uint32_t murmur2_finish(uint32_t hash, const uint8_t* data, size_t size, size_t index) {
+    for (; index + 4 <= size; index += 4) {
+        hash = murmur2_mix(hash, read_le32(data + index));
+    }
+    switch (size - index) {
+        case 3:
+            hash ^= static_cast<uint32_t>(data[index + 2]) << 16;
+            // fallthrough
+        case 2:
+            hash ^= static_cast<uint32_t>(data[index + 1]) << 8;
+            // fallthrough
+        case 1:
+            hash ^= data[index];
+            hash *= MURMUR2_MULTIPLIER;
+    }
+    hash ^= hash >> 13;
+    hash *= MURMUR2_MULTIPLIER;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+struct Crc32Table {
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int j = 0; j < 8; ++j) {
+                value = (value & 1) ? (value >> 1) ^ 0xedb88320 : value >> 1;
+            }
+            values[i] = value;
+        }
+    }
+
+    uint32_t values[256];
+};
+
+const Crc32Table CRC32_TABLE;
+
+int32_t to_partition(uint32_t hash, int32_t partition_count) {
+    return static_cast<int32_t>((hash & 0x7fffffff) % partition_count);
+}
+
+// rdkafka's fnv1a partitioner takes the absolute value of the signed hash rather than masking
+// the sign bit. The magnitude is computed unsigned so INT32_MIN maps to 2^31 instead of
+// overflowing
+int32_t fnv1a_to_partition(uint32_t hash, int32_t partition_count) {
+    const uint32_t magnitude = (hash & 0x80000000) ? 0u - hash : hash;
+    return static_cast<int32_t>(magnitude % static_cast<uint32_t>(partition_count));
+}
+
+} // anonymous namespace
+
+BatchPartitioner::Algorithm BatchPartitioner::get_algorithm(const string& name) {
+    if (name == "consistent") {
+        return Algorithm::CONSISTENT;
+    }
+    if (name == "consistent_random") {
+        return Algorithm::CONSISTENT_RANDOM;
+    }
+    if (name == "murmur2") {
+        return Algorithm::MURMUR2;
+    }
+    if (name == "murmur2_random") {
+        return Algorithm::MURMUR2_RANDOM;
+    }
+    if (name == "fnv1a") {
+        return Algorithm::FNV1A;
+    }
+    if (name == "fnv1a_random") {
+        return Algorithm::FNV1A_RANDOM;
+    }
+    throw Exception("Partitioner " + name + " is not key based");
+}
+
+uint32_t BatchPartitioner::murmur2(const void* data, size_t size) {
+    const uint32_t hash = MURMUR2_SEED ^ static_cast<uint32_t>(size);
+    return murmur2_finish(hash, static_cast<const uint8_t*>(data), size, 0);
+}
+
+uint32_t BatchPartitioner::crc32(const void* data, size_t size) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc = CRC32_TABLE.values[(crc ^ ptr[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+uint32_t BatchPartitioner::fnv1a(const void* data, size_t size) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ ptr[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+BatchPartitioner::BatchPartitioner(Algorithm algorithm)
+: algorithm_(algorithm) {
+
+}
+
+int32_t BatchPartitioner::partition(const Buffer& key, int32_t partition_count) const {
+    int32_t output;
+    partition(&key, 1, partition_count, &output);
+    return output;
+}
+
+void BatchPartitioner::partition(const Buffer* keys, size_t count, int32_t partition_count,
+                                 int32_t* output) const {
+    if (partition_count <= 0) {
+        throw Exception("Invalid partition count");
+    }
+    switch (algorithm_) {
+        case Algorithm::MURMUR2:
+        case Algorithm::MURMUR2_RANDOM:
+            partition_murmur2(keys, count, partition_count, output);
+            break;
+        case Algorithm::CONSISTENT:
+        case Algorithm::CONSISTENT_RANDOM:
+            for (size_t i = 0; i < count; ++i) {
+                // Unlike the rest, this one uses an empty key (rather than a null one) to
+                // decide whether a random partition is used
+                if (algorithm_ == Algorithm::CONSISTENT_RANDOM && keys[i].get_size() == 0) {
+                    output[i] = RD_KAFKA_PARTITION_UA;
+                }
+                else {
+                    output[i] = crc32(keys[i].get_data(), keys[i].get_size()) % partition_count;
+                }
+            }
+            break;
+        case Algorithm::FNV1A:
+        case Algorithm::FNV1A_RANDOM:
+            for (size_t i = 0; i < count; ++i) {
+                if (is_random() && !keys[i].get_data()) {
+                    output[i] = RD_KAFKA_PARTITION_UA;
+                }
+                else {
+                    output[i] = fnv1a_to_partition(fnv1a(keys[i].get_data(),
+                                                         keys[i].get_size()),
+                                                   partition_count);
+                }
+            }
+            break;
+    }
+}
+
+vector<int32_t> BatchPartitioner::partition(const vector<Buffer>& keys,
+                                            int32_t partition_count) const {
+    vector<int32_t> output(keys.size());
+    partition(keys.data(), keys.size(), partition_count, output.data());
+    return output;
+}
+
+BatchPartitioner::Algorithm BatchPartitioner::get_algorithm() const {
+    return algorithm_;
+}
+
+void BatchPartitioner::partition_murmur2(const Buffer* keys, size_t count,
+                                         int32_t partition_count, int32_t* output) const {
+    size_t i = 0;
+    for (; i + MURMUR2_LANES <= count; i += MURMUR2_LANES) {
+        const uint8_t* data[MURMUR2_LANES];
+        uint32_t hashes[MURMUR2_LANES];
+        size_t common_size = keys[i].get_size();
+        for (size_t lane = 0; lane < MURMUR2_LANES; ++lane) {
+            const Buffer& key = keys[i + lane];
+            data[lane] = key.get_data();
+            hashes[lane] = MURMUR2_SEED ^ static_cast<uint32_t>(key.get_size());
+            common_size = min(common_size, key.get_size());
+        }
+        // Mix the words every key has in lockstep, there's no dependency between lanes
+        size_t index = 0;
+        for (; index + 4 <= common_size; index += 4) {
+            for (size_t lane = 0; lane < MURMUR2_LANES; ++lane) {
+                hashes[lane] = murmur2_mix(hashes[lane], read_le32(data[lane] + index));
+            }
+        }
+        for (size_t lane = 0; lane < MURMUR2_LANES; ++lane) {
+            const Buffer& key = keys[i + lane];
+            if (is_random() && !key.get_data()) {
+                output[i + lane] = RD_KAFKA_PARTITION_UA;
+            }
+            else {
+                const uint32_t hash = murmur2_finish(hashes[lane], data[lane], key.get_size(),
+                                                     index);
+                output[i + lane] = to_partition(hash, partition_count);
+            }
+        }
+    }
+    for (; i < count; ++i) {
+        if (is_random() && !keys[i].get_data()) {
+            output[i] = RD_KAFKA_PARTITION_UA;
+        }
+        else {
+            output[i] = to_partition(murmur2(keys[i].get_data(), keys[i].get_size()),
+                                     partition_count);
+        }
+    }
+}
+
+bool BatchPartitioner::is_random() const {
+    return algorithm_ == Algorithm::CONSISTENT_RANDOM || algorithm_ == Algorithm::MURMUR2_RANDOM ||
+           algorithm_ == Algorithm::FNV1A_RANDOM;
+}
+
+} // cppkafka
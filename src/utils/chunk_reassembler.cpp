@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/chunk_reassembler.h"
+#include "detail/chunk_header.h"
+#include "exceptions.h"
+
+using std::string;
+using std::get;
+using std::min;
+using std::max;
+using std::copy;
+using std::find;
+using std::move;
+using std::prev;
+
+using std::chrono::milliseconds;
+
+using cppkafka::detail::ChunkHeader;
+
+namespace cppkafka {
+
+// ReassembledMessage
+
+ReassembledMessage::ReassembledMessage(string topic, int partition, int64_t offset,
+                                       int64_t last_offset)
+: topic_(move(topic)), partition_(partition), offset_(offset), last_offset_(last_offset) {
+
+}
+
+const string& ReassembledMessage::get_topic() const {
+    return topic_;
+}
+
+int ReassembledMessage::get_partition() const {
+    return partition_;
+}
+
+const Buffer& ReassembledMessage::get_key() const {
+    return key_;
+}
+
+const Buffer& ReassembledMessage::get_payload() const {
+    return payload_;
+}
+
+int64_t ReassembledMessage::get_offset() const {
+    return offset_;
+}
+
+int64_t ReassembledMessage::get_last_offset() const {
+    return last_offset_;
+}
+
+// ChunkReassembler
+
+const milliseconds ChunkReassembler::DEFAULT_TIMEOUT{60000};
+const size_t ChunkReassembler::DEFAULT_MAXIMUM_MESSAGE_SIZE = 128 * 1024 * 1024;
+const size_t ChunkReassembler::DEFAULT_MAXIMUM_BUFFERED_BYTES = 512 * 1024 * 1024;
+
+ChunkReassembler::ChunkReassembler(MessageCallback callback)
+: message_callback_(move(callback)), timeout_(DEFAULT_TIMEOUT),
+  maximum_message_size_(DEFAULT_MAXIMUM_MESSAGE_SIZE),
+  maximum_buffered_bytes_(DEFAULT_MAXIMUM_BUFFERED_BYTES) {
+
+}
+
+void ChunkReassembler::add(Message message) {
+    evict_expired();
+
+    const Buffer& payload = message.get_payload();
+    ChunkHeader header;
+    if (!header.decode(payload.get_data(), payload.get_size()) ||
+        header.total_size > maximum_message_size_) {
+        handle_invalid_message(message);
+        return;
+    }
+    const uint8_t* chunk_data = payload.get_data() + ChunkHeader::SIZE;
+    const size_t chunk_size = payload.get_size() - ChunkHeader::SIZE;
+    const int64_t offset = message.get_offset();
+
+    // Payloads that fit in a single chunk don't need to be copied at all
+    if (header.count == 1) {
+        if (chunk_size != header.total_size) {
+            handle_invalid_message(message);
+            return;
+        }
+        const Buffer& key = message.get_key();
+        ReassembledMessage output(message.get_topic(), message.get_partition(), offset, offset);
+        output.key_ = Buffer(key.get_data(), key.get_size());
+        output.payload_ = Buffer(chunk_data, chunk_size);
+        output.message_ = move(message);
+        message_callback_(move(output));
+        return;
+    }
+
+    // Every chunk but the last one has the same size, so they must be laid out back to back
+    // without overlaps and the last one must end exactly at the total size
+    uint64_t chunk_stride = chunk_size;
+    if (header.index > 0) {
+        chunk_stride = header.data_offset / header.index;
+        if (header.data_offset % header.index != 0) {
+            handle_invalid_message(message);
+            return;
+        }
+    }
+    const bool is_last = header.index + 1 == header.count;
+    if (chunk_stride == 0 || (header.index == 0 && header.data_offset != 0) ||
+        (!is_last && chunk_size != chunk_stride) ||
+        (is_last && header.data_offset + chunk_size != header.total_size)) {
+        handle_invalid_message(message);
+        return;
+    }
+    // The chunk count follows from the stride. Check it before allocating anything based on it
+    if ((header.total_size + chunk_stride - 1) / chunk_stride != header.count) {
+        handle_invalid_message(message);
+        return;
+    }
+
+    GroupKey key(message.get_topic(), message.get_partition(), header.group_id);
+    GroupList::iterator iter;
+    auto index_iter = group_index_.find(key);
+    if (index_iter == group_index_.end()) {
+        // Make room for this one by dropping the oldest incomplete messages
+        while (!groups_.empty() && buffered_bytes_ + header.total_size > maximum_buffered_bytes_) {
+            evict(groups_.begin(), true);
+        }
+        const Buffer& message_key = message.get_key();
+        groups_.emplace_back();
+        iter = prev(groups_.end());
+        iter->key = key;
+        iter->expiration = ClockType::now() + timeout_;
+        // Don't value-initialize this one. Chunks are validated to cover it entirely and
+        // it's only handed out once the bytes received add up to its size
+        iter->data.reset(new uint8_t[header.total_size]);
+        iter->total_size = header.total_size;
+        iter->chunk_stride = 0;
+        iter->received_bytes = 0;
+        iter->message_key.assign(message_key.begin(), message_key.end());
+        iter->received_chunks.resize(header.count, false);
+        iter->pending_chunks = header.count;
+        iter->first_offset = offset;
+        iter->last_offset = offset;
+        group_index_.emplace(move(key), iter);
+        buffered_bytes_ += header.total_size;
+    }
+    else {
+        iter = index_iter->second;
+        if (iter->total_size != header.total_size ||
+            iter->received_chunks.size() != header.count) {
+            handle_invalid_message(message);
+            return;
+        }
+    }
+
+    Group& group = *iter;
+    // The first chunk that tells us the chunk size fixes it for the rest of them
+    const bool knows_stride = header.index > 0 || !is_last;
+    if (knows_stride) {
+        if (group.chunk_stride == 0) {
+            group.chunk_stride = chunk_stride;
+        }
+        else if (group.chunk_stride != chunk_stride) {
+            handle_invalid_message(message);
+            return;
+        }
+    }
+    if (group.received_chunks[header.index]) {
+        return;
+    }
+    group.received_chunks[header.index] = true;
+    group.pending_chunks--;
+    group.first_offset = min(group.first_offset, offset);
+    group.last_offset = max(group.last_offset, offset);
+    group.received_bytes += chunk_size;
+    copy(chunk_data, chunk_data + chunk_size, group.data.get() + header.data_offset);
+    if (group.pending_chunks > 0) {
+        return;
+    }
+    if (group.received_bytes != group.total_size) {
+        evict(iter, false);
+        handle_invalid_message(message);
+        return;
+    }
+
+    ReassembledMessage output(get<0>(group.key), get<1>(group.key), group.first_offset,
+                              group.last_offset);
+    output.key_data_ = move(group.message_key);
+    output.payload_data_ = move(group.data);
+    output.key_ = Buffer(output.key_data_.data(), output.key_data_.size());
+    output.payload_ = Buffer(output.payload_data_.get(), group.total_size);
+    buffered_bytes_ -= group.total_size;
+    group_index_.erase(group.key);
+    groups_.erase(iter);
+    message_callback_(move(output));
+}
+
+void ChunkReassembler::evict_expired() {
+    const auto now = ClockType::now();
+    while (!groups_.empty() && groups_.front().expiration <= now) {
+        evict(groups_.begin(), true);
+    }
+}
+
+void ChunkReassembler::discard(const TopicPartitionList& topic_partitions) {
+    auto iter = groups_.begin();
+    while (iter != groups_.end()) {
+        auto current = iter++;
+        TopicPartition topic_partition(get<0>(current->key), get<1>(current->key));
+        if (find(topic_partitions.begin(), topic_partitions.end(), topic_partition) !=
+            topic_partitions.end()) {
+            evict(current, false);
+        }
+    }
+}
+
+void ChunkReassembler::clear() {
+    groups_.clear();
+    group_index_.clear();
+    buffered_bytes_ = 0;
+}
+
+void ChunkReassembler::set_timeout(milliseconds value) {
+    timeout_ = value;
+}
+
+void ChunkReassembler::set_maximum_message_size(size_t value) {
+    maximum_message_size_ = value;
+}
+
+void ChunkReassembler::set_maximum_buffered_bytes(size_t value) {
+    maximum_buffered_bytes_ = value;
+}
+
+void ChunkReassembler::set_expiration_callback(ExpirationCallback callback) {
+    expiration_callback_ = move(callback);
+}
+
+void ChunkReassembler::set_invalid_message_callback(InvalidMessageCallback callback) {
+    invalid_message_callback_ = move(callback);
+}
+
+size_t ChunkReassembler::get_pending_count() const {
+    return groups_.size();
+}
+
+size_t ChunkReassembler::get_buffered_bytes() const {
+    return buffered_bytes_;
+}
+
+void ChunkReassembler::handle_invalid_message(const Message& message) {
+    if (!invalid_message_callback_) {
+        throw Exception("Invalid chunk found at " + message.get_topic() + "/" +
+                        std::to_string(message.get_partition()) + ":" +
+                        std::to_string(message.get_offset()));
+    }
+    invalid_message_callback_(message);
+}
+
+void ChunkReassembler::evict(GroupList::iterator iter, bool notify) {
+    TopicPartition topic_partition(get<0>(iter->key), get<1>(iter->key), iter->first_offset);
+    buffered_bytes_ -= iter->total_size;
+    group_index_.erase(iter->key);
+    groups_.erase(iter);
+    if (notify && expiration_callback_) {
+        expiration_callback_(topic_partition);
+    }
+}
+
+} // cppkafka
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/chunked_producer.h"
+#include "detail/chunk_header.h"
+#include "metadata.h"
+#include "exceptions.h"
+
+using std::string;
+using std::min;
+using std::max;
+using std::copy;
+using std::random_device;
+using std::uniform_int_distribution;
+
+using cppkafka::detail::ChunkHeader;
+
+namespace cppkafka {
+
+const size_t ChunkedProducer::DEFAULT_CHUNK_SIZE = 900 * 1024;
+
+ChunkedProducer::ChunkedProducer(Producer& producer)
+: producer_(producer), random_engine_(random_device()()), chunk_size_(DEFAULT_CHUNK_SIZE) {
+
+}
+
+void ChunkedProducer::produce(const MessageBuilder& builder) {
+    if (producer_.get_payload_policy() != Producer::PayloadPolicy::COPY_PAYLOAD) {
+        throw Exception("ChunkedProducer requires the COPY_PAYLOAD payload policy");
+    }
+    const Buffer& payload = builder.payload();
+    const size_t payload_size = payload.get_size();
+    // Empty payloads still take a single chunk
+    const size_t chunk_count = max<size_t>((payload_size + chunk_size_ - 1) / chunk_size_, 1);
+
+    ChunkHeader header;
+    header.group_id = random_engine_();
+    header.count = static_cast<uint32_t>(chunk_count);
+    header.total_size = payload_size;
+
+    MessageBuilder chunk_builder(builder.topic());
+    chunk_builder.key(Buffer(builder.key().get_data(), builder.key().get_size()))
+                 .timestamp(builder.timestamp());
+    if (builder.partition() != -1) {
+        chunk_builder.partition(builder.partition());
+    }
+    else if (chunk_count > 1 && builder.key().get_size() == 0) {
+        // Without a key, the partitioner could send each chunk to a different partition
+        chunk_builder.partition(get_random_partition(builder.topic()));
+    }
+    for (size_t i = 0; i < chunk_count; ++i) {
+        const size_t data_offset = i * chunk_size_;
+        const size_t data_size = min(chunk_size_, payload_size - data_offset);
+        header.index = static_cast<uint32_t>(i);
+        header.data_offset = data_offset;
+
+        chunk_buffer_.resize(ChunkHeader::SIZE + data_size);
+        header.encode(chunk_buffer_.data());
+        if (data_size > 0) {
+            copy(payload.begin() + data_offset, payload.begin() + data_offset + data_size,
+                 chunk_buffer_.begin() + ChunkHeader::SIZE);
+        }
+        chunk_builder.payload(Buffer(chunk_buffer_.data(), chunk_buffer_.size()));
+        if (i + 1 == chunk_count) {
+            chunk_builder.user_data(builder.user_data());
+        }
+        produce_chunk(chunk_builder);
+    }
+}
+
+void ChunkedProducer::set_chunk_size(size_t value) {
+    chunk_size_ = max<size_t>(value, 1);
+}
+
+size_t ChunkedProducer::get_chunk_size() const {
+    return chunk_size_;
+}
+
+Producer& ChunkedProducer::get_producer() {
+    return producer_;
+}
+
+int ChunkedProducer::get_random_partition(const string& topic) {
+    auto iter = partition_counts_.find(topic);
+    if (iter == partition_counts_.end()) {
+        TopicMetadata metadata = producer_.get_metadata(producer_.get_topic(topic));
+        const size_t partition_count = metadata.get_partitions().size();
+        if (partition_count == 0) {
+            throw Exception("Topic " + topic + " has no partitions");
+        }
+        iter = partition_counts_.emplace(topic, partition_count).first;
+    }
+    uniform_int_distribution<int> distribution(0, static_cast<int>(iter->second) - 1);
+    return distribution(random_engine_);
+}
+
+void ChunkedProducer::produce_chunk(const MessageBuilder& builder) {
+    while (true) {
+        try {
+            producer_.produce(builder);
+            return;
+        }
+        catch (const HandleException& ex) {
+            // If the output queue is full, then just poll
+            if (ex.get_error() == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                producer_.poll();
+            }
+            else {
+                throw;
+            }
+        }
+    }
+}
+
+} // cppkafka
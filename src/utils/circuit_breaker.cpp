@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <limits>
+#include <algorithm>
+#include "utils/circuit_breaker.h"
+
+using std::min;
+using std::max;
+using std::move;
+using std::mutex;
+using std::lock_guard;
+using std::numeric_limits;
+
+using std::chrono::milliseconds;
+using std::chrono::duration_cast;
+
+namespace cppkafka {
+
+const milliseconds CircuitBreaker::DEFAULT_WINDOW_SIZE{10000};
+const size_t CircuitBreaker::DEFAULT_MINIMUM_REQUESTS = 20;
+const double CircuitBreaker::DEFAULT_FAILURE_RATIO = 0.5;
+const milliseconds CircuitBreaker::DEFAULT_OPEN_TIMEOUT{5000};
+const size_t CircuitBreaker::DEFAULT_PROBE_COUNT = 3;
+const size_t CircuitBreaker::BUCKET_COUNT = 10;
+
+CircuitBreaker::CircuitBreaker()
+: buckets_(BUCKET_COUNT, Bucket{ ClockType::time_point(), 0, 0 }),
+  state_start_(ClockType::now()), window_size_(DEFAULT_WINDOW_SIZE),
+  open_timeout_(DEFAULT_OPEN_TIMEOUT), minimum_requests_(DEFAULT_MINIMUM_REQUESTS),
+  failure_ratio_(DEFAULT_FAILURE_RATIO), probe_count_(DEFAULT_PROBE_COUNT),
+  open_priority_(numeric_limits<unsigned>::max()) {
+
+}
+
+bool CircuitBreaker::allow(unsigned priority) {
+    State previous_state;
+    bool output = true;
+    {
+        lock_guard<mutex> _(mutex_);
+        previous_state = state_;
+        const auto now = ClockType::now();
+        if (state_ == State::OPEN && now - state_start_ >= open_timeout_) {
+            set_state(State::HALF_OPEN, now);
+        }
+        else if (state_ == State::HALF_OPEN && probes_allowed_ >= probe_count_ &&
+                 now - state_start_ >= open_timeout_) {
+            // The probes' outcomes never arrived, so give it another round
+            set_state(State::HALF_OPEN, now);
+        }
+        if (state_ == State::HALF_OPEN && probes_allowed_ < probe_count_) {
+            probes_allowed_++;
+        }
+        else if (state_ != State::CLOSED) {
+            output = priority >= open_priority_;
+        }
+    }
+    notify(previous_state);
+    return output;
+}
+
+void CircuitBreaker::record_success() {
+    State previous_state;
+    {
+        lock_guard<mutex> _(mutex_);
+        previous_state = state_;
+        const auto now = ClockType::now();
+        if (state_ == State::CLOSED) {
+            get_bucket(now).successes++;
+        }
+        else if (state_ == State::HALF_OPEN && ++probe_successes_ >= probe_count_) {
+            set_state(State::CLOSED, now);
+        }
+    }
+    notify(previous_state);
+}
+
+void CircuitBreaker::record_failure() {
+    State previous_state;
+    {
+        lock_guard<mutex> _(mutex_);
+        previous_state = state_;
+        const auto now = ClockType::now();
+        if (state_ == State::CLOSED) {
+            get_bucket(now).failures++;
+            if (should_trip(now)) {
+                set_state(State::OPEN, now);
+            }
+        }
+        else if (state_ == State::HALF_OPEN) {
+            set_state(State::OPEN, now);
+        }
+    }
+    notify(previous_state);
+}
+
+void CircuitBreaker::reset() {
+    State previous_state;
+    {
+        lock_guard<mutex> _(mutex_);
+        previous_state = state_;
+        set_state(State::CLOSED, ClockType::now());
+    }
+    notify(previous_state);
+}
+
+CircuitBreaker::State CircuitBreaker::get_state() const {
+    lock_guard<mutex> _(mutex_);
+    return state_;
+}
+
+size_t CircuitBreaker::get_trip_count() const {
+    lock_guard<mutex> _(mutex_);
+    return trip_count_;
+}
+
+void CircuitBreaker::set_window_size(milliseconds value) {
+    lock_guard<mutex> _(mutex_);
+    window_size_ = max(value, milliseconds(static_cast<milliseconds::rep>(BUCKET_COUNT)));
+    // Bucket boundaries change, so start over
+    for (Bucket& bucket : buckets_) {
+        bucket = Bucket{ ClockType::time_point(), 0, 0 };
+    }
+}
+
+void CircuitBreaker::set_minimum_requests(size_t value) {
+    lock_guard<mutex> _(mutex_);
+    minimum_requests_ = value;
+}
+
+void CircuitBreaker::set_failure_ratio(double value) {
+    lock_guard<mutex> _(mutex_);
+    failure_ratio_ = min(max(value, 0.0), 1.0);
+}
+
+void CircuitBreaker::set_open_timeout(milliseconds value) {
+    lock_guard<mutex> _(mutex_);
+    open_timeout_ = value;
+}
+
+void CircuitBreaker::set_probe_count(size_t value) {
+    lock_guard<mutex> _(mutex_);
+    probe_count_ = max<size_t>(value, 1);
+}
+
+void CircuitBreaker::set_open_priority(unsigned value) {
+    lock_guard<mutex> _(mutex_);
+    open_priority_ = value;
+}
+
+void CircuitBreaker::set_state_change_callback(StateChangeCallback callback) {
+    lock_guard<mutex> _(mutex_);
+    state_change_callback_ = move(callback);
+}
+
+CircuitBreaker::Bucket& CircuitBreaker::get_bucket(ClockType::time_point now) {
+    const auto bucket_size = window_size_ / BUCKET_COUNT;
+    const auto index = duration_cast<milliseconds>(now.time_since_epoch()) / bucket_size;
+    const ClockType::time_point start(index * bucket_size);
+    Bucket& bucket = buckets_[index % BUCKET_COUNT];
+    // This slot was last used a whole window ago
+    if (bucket.start != start) {
+        bucket = Bucket{ start, 0, 0 };
+    }
+    return bucket;
+}
+
+bool CircuitBreaker::should_trip(ClockType::time_point now) const {
+    size_t successes = 0;
+    size_t failures = 0;
+    for (const Bucket& bucket : buckets_) {
+        if (now - bucket.start < window_size_) {
+            successes += bucket.successes;
+            failures += bucket.failures;
+        }
+    }
+    const size_t total = successes + failures;
+    return total > 0 && total >= minimum_requests_ &&
+           failures >= failure_ratio_ * total;
+}
+
+void CircuitBreaker::set_state(State state, ClockType::time_point now) {
+    if (state == State::OPEN) {
+        trip_count_++;
+    }
+    if (state == State::CLOSED) {
+        for (Bucket& bucket : buckets_) {
+            bucket = Bucket{ ClockType::time_point(), 0, 0 };
+        }
+    }
+    state_ = state;
+    state_start_ = now;
+    probes_allowed_ = 0;
+    probe_successes_ = 0;
+}
+
+void CircuitBreaker::notify(State previous_state) {
+    StateChangeCallback callback;
+    State state;
+    {
+        lock_guard<mutex> _(mutex_);
+        if (state_ == previous_state || !state_change_callback_) {
+            return;
+        }
+        callback = state_change_callback_;
+        state = state_;
+    }
+    callback(state);
+}
+
+} // cppkafka
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/commit_coordinator.h"
+#include "exceptions.h"
+
+using std::move;
+using std::remove_if;
+using std::count_if;
+
+using std::chrono::milliseconds;
+
+namespace cppkafka {
+
+const size_t CommitCoordinator::DEFAULT_COMMIT_BATCH_SIZE = 10000;
+const milliseconds CommitCoordinator::DEFAULT_COMMIT_INTERVAL{1000};
+
+CommitCoordinator::PendingOffset::PendingOffset(int64_t offset, size_t acks,
+                                                PartitionState& state)
+: offset(offset), remaining_acks(acks), owner(&state) {
+
+}
+
+CommitCoordinator::CommitCoordinator(Consumer& consumer)
+: consumer_(consumer), commit_batch_size_(DEFAULT_COMMIT_BATCH_SIZE),
+  commit_interval_(DEFAULT_COMMIT_INTERVAL), last_commit_(ClockType::now()) {
+
+}
+
+CommitCoordinator::~CommitCoordinator() {
+    if (drain_on_revocation_) {
+        consumer_.set_revocation_callback(original_revocation_callback_);
+    }
+}
+
+void* CommitCoordinator::track(const Message& message, size_t expected_acks) {
+    return track({ message.get_topic(), message.get_partition(), message.get_offset() },
+                 expected_acks);
+}
+
+void* CommitCoordinator::track(const TopicPartition& topic_partition, size_t expected_acks) {
+    PartitionStatePtr& state_ptr = partitions_[topic_partition];
+    if (!state_ptr) {
+        state_ptr.reset(new PartitionState());
+    }
+    PartitionState& state = *state_ptr;
+    state.offsets.emplace_back(topic_partition.get_offset(), expected_acks, state);
+    if (expected_acks == 0) {
+        // Nothing depends on this one, it can be committed as soon as the previous ones are
+        advance(state);
+        return nullptr;
+    }
+    pending_count_++;
+    return &state.offsets.back();
+}
+
+void CommitCoordinator::acknowledge(const Message& message) {
+    void* token = message.get_private_data();
+    if (token) {
+        acknowledge(token);
+    }
+}
+
+void CommitCoordinator::acknowledge(void* token) {
+    resolve(token);
+}
+
+void CommitCoordinator::release(const Message& message) {
+    void* token = message.get_private_data();
+    if (token) {
+        release(token);
+    }
+}
+
+void CommitCoordinator::release(void* token) {
+    released_count_++;
+    resolve(token);
+}
+
+void CommitCoordinator::resolve(void* token) {
+    PendingOffset& pending = *static_cast<PendingOffset*>(token);
+    if (--pending.remaining_acks == 0) {
+        // Discarded partitions were already removed from the pending count
+        if (!pending.owner->discarded) {
+            pending_count_--;
+        }
+        advance(*pending.owner);
+    }
+}
+
+bool CommitCoordinator::try_commit() {
+    if (acked_since_commit_ == 0) {
+        return false;
+    }
+    if (acked_since_commit_ < commit_batch_size_ &&
+        ClockType::now() - last_commit_ < commit_interval_) {
+        return false;
+    }
+    commit();
+    return true;
+}
+
+void CommitCoordinator::commit() {
+    TopicPartitionList topic_partitions = get_committable_offsets();
+    // Only consider these committed once the commit was issued
+    if (!topic_partitions.empty()) {
+        consumer_.async_commit(topic_partitions);
+    }
+    for (auto& partition_pair : partitions_) {
+        partition_pair.second->needs_commit = false;
+    }
+    acked_since_commit_ = 0;
+    last_commit_ = ClockType::now();
+    // Get rid of any discarded partitions that are done
+    discarded_partitions_.erase(remove_if(discarded_partitions_.begin(),
+                                          discarded_partitions_.end(),
+                                          [](const PartitionStatePtr& state) {
+                                              return state->offsets.empty();
+                                          }),
+                                discarded_partitions_.end());
+}
+
+void CommitCoordinator::discard(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        auto iter = partitions_.find(topic_partition);
+        if (iter == partitions_.end()) {
+            continue;
+        }
+        PartitionStatePtr& state = iter->second;
+        pending_count_ -= count_if(state->offsets.begin(), state->offsets.end(),
+                                   [](const PendingOffset& pending) {
+                                       return pending.remaining_acks > 0;
+                                   });
+        // Keep it alive if there's tokens still pointing to it
+        if (!state->offsets.empty()) {
+            state->discarded = true;
+            discarded_partitions_.emplace_back(move(state));
+        }
+        partitions_.erase(iter);
+    }
+}
+
+bool CommitCoordinator::drain(const TopicPartitionList& topic_partitions, milliseconds timeout,
+                              const DrainCallback& callback) {
+    const auto deadline = ClockType::now() + timeout;
+    bool drained = get_pending_count(topic_partitions) == 0;
+    while (!drained && ClockType::now() < deadline) {
+        callback();
+        drained = get_pending_count(topic_partitions) == 0;
+    }
+    // Commit exactly these partitions, synchronously so it's done before they're released
+    TopicPartitionList offsets;
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        auto iter = partitions_.find(topic_partition);
+        if (iter != partitions_.end() && iter->second->needs_commit) {
+            offsets.emplace_back(topic_partition.get_topic(), topic_partition.get_partition(),
+                                 iter->second->next_offset);
+            iter->second->needs_commit = false;
+        }
+    }
+    discard(topic_partitions);
+    if (!offsets.empty()) {
+        consumer_.commit(offsets);
+    }
+    return drained;
+}
+
+void CommitCoordinator::set_drain_on_revocation(milliseconds timeout, DrainCallback callback) {
+    if (!drain_on_revocation_) {
+        original_revocation_callback_ = consumer_.get_revocation_callback();
+        drain_on_revocation_ = true;
+    }
+    consumer_.set_revocation_callback([=](const TopicPartitionList& topic_partitions) {
+        if (original_revocation_callback_) {
+            original_revocation_callback_(topic_partitions);
+        }
+        try {
+            drain(topic_partitions, timeout, callback);
+        }
+        catch (const HandleException&) {
+            // The partitions are going away regardless, their next owner will pick them up
+            // from the last committed offsets
+        }
+    });
+}
+
+TopicPartitionList CommitCoordinator::get_committable_offsets() const {
+    TopicPartitionList output;
+    for (const auto& partition_pair : partitions_) {
+        const PartitionState& state = *partition_pair.second;
+        if (state.needs_commit) {
+            const TopicPartition& topic_partition = partition_pair.first;
+            output.emplace_back(topic_partition.get_topic(), topic_partition.get_partition(),
+                                state.next_offset);
+        }
+    }
+    return output;
+}
+
+size_t CommitCoordinator::get_pending_count() const {
+    return pending_count_;
+}
+
+size_t CommitCoordinator::get_released_count() const {
+    return released_count_;
+}
+
+size_t CommitCoordinator::get_pending_count(const TopicPartitionList& topic_partitions) const {
+    size_t output = 0;
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        auto iter = partitions_.find(topic_partition);
+        if (iter == partitions_.end()) {
+            continue;
+        }
+        const auto& offsets = iter->second->offsets;
+        output += count_if(offsets.begin(), offsets.end(), [](const PendingOffset& pending) {
+            return pending.remaining_acks > 0;
+        });
+    }
+    return output;
+}
+
+void CommitCoordinator::set_commit_batch_size(size_t value) {
+    commit_batch_size_ = value;
+}
+
+void CommitCoordinator::set_commit_interval(milliseconds value) {
+    commit_interval_ = value;
+}
+
+void CommitCoordinator::advance(PartitionState& state) {
+    while (!state.offsets.empty() && state.offsets.front().remaining_acks == 0) {
+        state.next_offset = state.offsets.front().offset + 1;
+        state.offsets.pop_front();
+        if (!state.discarded) {
+            state.needs_commit = true;
+            acked_since_commit_++;
+        }
+    }
+}
+
+} // cppkafka
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <zstd.h>
+#include <zdict.h>
+#include "utils/dictionary_codec.h"
+#include "exceptions.h"
+
+using std::string;
+using std::vector;
+using std::move;
+using std::to_string;
+
+namespace cppkafka {
+
+namespace {
+
+void destroy_compression_context(ZSTD_CCtx* context) {
+    ZSTD_freeCCtx(context);
+}
+
+void destroy_decompression_context(ZSTD_DCtx* context) {
+    ZSTD_freeDCtx(context);
+}
+
+void destroy_compression_dictionary(ZSTD_CDict* dictionary) {
+    ZSTD_freeCDict(dictionary);
+}
+
+void destroy_decompression_dictionary(ZSTD_DDict* dictionary) {
+    ZSTD_freeDDict(dictionary);
+}
+
+size_t check_zstd_result(size_t result) {
+    if (ZSTD_isError(result)) {
+        throw Exception("zstd error: " + string(ZSTD_getErrorName(result)));
+    }
+    return result;
+}
+
+} // anonymous namespace
+
+const int DictionaryCodec::DEFAULT_COMPRESSION_LEVEL = 3;
+const size_t DictionaryCodec::DEFAULT_MAXIMUM_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+DictionaryCodec::Dictionary::Dictionary()
+: compression_dictionary(nullptr, &destroy_compression_dictionary),
+  decompression_dictionary(nullptr, &destroy_decompression_dictionary) {
+
+}
+
+DictionaryCodec::DictionaryCodec()
+: compression_context_(ZSTD_createCCtx(), &destroy_compression_context),
+  decompression_context_(ZSTD_createDCtx(), &destroy_decompression_context),
+  compression_level_(DEFAULT_COMPRESSION_LEVEL),
+  maximum_payload_size_(DEFAULT_MAXIMUM_PAYLOAD_SIZE) {
+    if (!compression_context_ || !decompression_context_) {
+        throw Exception("Failed to create zstd contexts");
+    }
+}
+
+uint32_t DictionaryCodec::add_dictionary(const Buffer& dictionary) {
+    const uint32_t id = ZDICT_getDictID(dictionary.get_data(), dictionary.get_size());
+    if (id == 0) {
+        throw Exception("Invalid zstd dictionary");
+    }
+    Dictionary& entry = dictionaries_[id];
+    entry.data.assign(dictionary.begin(), dictionary.end());
+    entry.compression_dictionary.reset();
+    entry.decompression_dictionary.reset(ZSTD_createDDict(entry.data.data(), entry.data.size()));
+    if (!entry.decompression_dictionary) {
+        if (compression_dictionary_ == &entry) {
+            compression_dictionary_ = nullptr;
+        }
+        dictionaries_.erase(id);
+        throw Exception("Failed to load zstd dictionary " + to_string(id));
+    }
+    return id;
+}
+
+bool DictionaryCodec::has_dictionary(uint32_t id) const {
+    return dictionaries_.count(id) > 0;
+}
+
+void DictionaryCodec::set_compression_dictionary(uint32_t id) {
+    auto iter = dictionaries_.find(id);
+    if (iter == dictionaries_.end()) {
+        throw Exception("Unknown zstd dictionary " + to_string(id));
+    }
+    compression_dictionary_ = &iter->second;
+}
+
+void DictionaryCodec::set_compression_level(int value) {
+    compression_level_ = value;
+    // These were built for the previous level
+    for (auto& dictionary : dictionaries_) {
+        dictionary.second.compression_dictionary.reset();
+    }
+}
+
+void DictionaryCodec::set_maximum_payload_size(size_t value) {
+    maximum_payload_size_ = value;
+}
+
+void DictionaryCodec::set_dictionary_loader(DictionaryLoader loader) {
+    dictionary_loader_ = move(loader);
+}
+
+Buffer DictionaryCodec::compress(const Buffer& payload) {
+    compression_buffer_.resize(ZSTD_compressBound(payload.get_size()));
+    size_t result;
+    if (compression_dictionary_) {
+        Dictionary& dictionary = *compression_dictionary_;
+        if (!dictionary.compression_dictionary) {
+            dictionary.compression_dictionary.reset(ZSTD_createCDict(dictionary.data.data(),
+                                                                     dictionary.data.size(),
+                                                                     compression_level_));
+            if (!dictionary.compression_dictionary) {
+                throw Exception("Failed to create zstd compression dictionary");
+            }
+        }
+        result = ZSTD_compress_usingCDict(compression_context_.get(),
+                                          compression_buffer_.data(),
+                                          compression_buffer_.size(),
+                                          payload.get_data(), payload.get_size(),
+                                          dictionary.compression_dictionary.get());
+    }
+    else {
+        result = ZSTD_compressCCtx(compression_context_.get(), compression_buffer_.data(),
+                                   compression_buffer_.size(), payload.get_data(),
+                                   payload.get_size(), compression_level_);
+    }
+    return Buffer(compression_buffer_.data(), check_zstd_result(result));
+}
+
+Buffer DictionaryCodec::decompress(const Buffer& payload) {
+    const unsigned long long content_size = ZSTD_getFrameContentSize(payload.get_data(),
+                                                                     payload.get_size());
+    if (content_size == ZSTD_CONTENTSIZE_ERROR) {
+        throw Exception("Payload is not a zstd frame");
+    }
+    if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size > maximum_payload_size_) {
+        throw Exception("zstd frame content size is unknown or too large");
+    }
+    decompression_buffer_.resize(static_cast<size_t>(content_size));
+    const uint32_t id = ZSTD_getDictID_fromFrame(payload.get_data(), payload.get_size());
+    size_t result;
+    if (id != 0) {
+        const Dictionary& dictionary = get_dictionary(id);
+        result = ZSTD_decompress_usingDDict(decompression_context_.get(),
+                                            decompression_buffer_.data(),
+                                            decompression_buffer_.size(),
+                                            payload.get_data(), payload.get_size(),
+                                            dictionary.decompression_dictionary.get());
+    }
+    else {
+        result = ZSTD_decompressDCtx(decompression_context_.get(), decompression_buffer_.data(),
+                                     decompression_buffer_.size(), payload.get_data(),
+                                     payload.get_size());
+    }
+    return Buffer(decompression_buffer_.data(), check_zstd_result(result));
+}
+
+DictionaryCodec::Dictionary& DictionaryCodec::get_dictionary(uint32_t id) {
+    auto iter = dictionaries_.find(id);
+    if (iter != dictionaries_.end()) {
+        return iter->second;
+    }
+    vector<uint8_t> data;
+    if (dictionary_loader_) {
+        data = dictionary_loader_(id);
+    }
+    if (data.empty()) {
+        throw Exception("Unknown zstd dictionary " + to_string(id));
+    }
+    // Check the id before storing it so a bad load doesn't leave a stray entry behind
+    if (ZDICT_getDictID(data.data(), data.size()) != id) {
+        throw Exception("Dictionary loaded for id " + to_string(id) + " has a different id");
+    }
+    add_dictionary(data);
+    return dictionaries_.at(id);
+}
+
+} // cppkafka
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <zdict.h>
+#include "utils/dictionary_trainer.h"
+#include "exceptions.h"
+
+using std::string;
+using std::vector;
+using std::random_device;
+using std::uniform_int_distribution;
+
+namespace cppkafka {
+
+const size_t DictionaryTrainer::DEFAULT_DICTIONARY_SIZE = 110 * 1024;
+const size_t DictionaryTrainer::DEFAULT_MAXIMUM_SAMPLE_SIZE = 16 * 1024 * 1024;
+
+DictionaryTrainer::DictionaryTrainer()
+: random_engine_(random_device()()), maximum_sample_size_(DEFAULT_MAXIMUM_SAMPLE_SIZE) {
+
+}
+
+void DictionaryTrainer::add_sample(const Buffer& payload) {
+    payloads_seen_++;
+    if (sample_size_ + payload.get_size() <= maximum_sample_size_) {
+        samples_.emplace_back(payload.begin(), payload.end());
+        sample_size_ += payload.get_size();
+        return;
+    }
+    if (samples_.empty()) {
+        return;
+    }
+    // Reservoir sampling: keep this one with probability samples / payloads seen
+    uniform_int_distribution<size_t> distribution(0, payloads_seen_ - 1);
+    const size_t index = distribution(random_engine_);
+    if (index >= samples_.size()) {
+        return;
+    }
+    string& sample = samples_[index];
+    if (sample_size_ - sample.size() + payload.get_size() > maximum_sample_size_) {
+        return;
+    }
+    sample_size_ = sample_size_ - sample.size() + payload.get_size();
+    sample.assign(payload.begin(), payload.end());
+}
+
+vector<uint8_t> DictionaryTrainer::train(size_t dictionary_size) const {
+    string samples;
+    vector<size_t> sample_sizes;
+    samples.reserve(sample_size_);
+    sample_sizes.reserve(samples_.size());
+    for (const string& sample : samples_) {
+        samples += sample;
+        sample_sizes.push_back(sample.size());
+    }
+    vector<uint8_t> dictionary(dictionary_size);
+    const size_t result = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(),
+                                                samples.data(), sample_sizes.data(),
+                                                static_cast<unsigned>(sample_sizes.size()));
+    if (ZDICT_isError(result)) {
+        throw Exception("Failed to train dictionary: " + string(ZDICT_getErrorName(result)));
+    }
+    dictionary.resize(result);
+    return dictionary;
+}
+
+void DictionaryTrainer::set_maximum_sample_size(size_t value) {
+    maximum_sample_size_ = value;
+}
+
+size_t DictionaryTrainer::get_sample_count() const {
+    return samples_.size();
+}
+
+size_t DictionaryTrainer::get_sample_size() const {
+    return sample_size_;
+}
+
+void DictionaryTrainer::clear() {
+    samples_.clear();
+    sample_size_ = 0;
+    payloads_seen_ = 0;
+}
+
+} // cppkafka
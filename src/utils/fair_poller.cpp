@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/fair_poller.h"
+
+using std::map;
+using std::min;
+using std::max;
+using std::move;
+using std::find_if;
+
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+
+namespace cppkafka {
+
+const size_t FairPoller::DEFAULT_MESSAGE_QUANTUM = 1;
+const size_t FairPoller::DEFAULT_BYTE_QUANTUM = 64 * 1024;
+const milliseconds FairPoller::DEFAULT_IDLE_WAIT{10};
+
+FairPoller::FairPoller(Consumer& consumer, Mode mode)
+: consumer_(consumer), mode_(mode), consumer_queue_(consumer.get_consumer_queue()),
+  default_quantum_(mode == Mode::ROUND_ROBIN ? DEFAULT_MESSAGE_QUANTUM : DEFAULT_BYTE_QUANTUM),
+  idle_wait_(DEFAULT_IDLE_WAIT) {
+    // Save the current callbacks and set ours
+    original_assignment_callback_ = consumer_.get_assignment_callback();
+    original_revocation_callback_ = consumer_.get_revocation_callback();
+    consumer_.set_assignment_callback([&](TopicPartitionList& topic_partitions) {
+        if (original_assignment_callback_) {
+            original_assignment_callback_(topic_partitions);
+        }
+        on_assignment(topic_partitions);
+    });
+    consumer_.set_revocation_callback([&](const TopicPartitionList& topic_partitions) {
+        if (original_revocation_callback_) {
+            original_revocation_callback_(topic_partitions);
+        }
+        on_revocation(topic_partitions);
+    });
+    on_assignment(consumer_.get_assignment());
+}
+
+FairPoller::~FairPoller() {
+    consumer_.set_assignment_callback(original_assignment_callback_);
+    consumer_.set_revocation_callback(original_revocation_callback_);
+    for (const Partition& partition : partitions_) {
+        partition.queue.forward_to_queue(consumer_queue_);
+    }
+}
+
+void FairPoller::set_default_quantum(size_t value) {
+    default_quantum_ = max<size_t>(value, 1);
+}
+
+void FairPoller::set_quantum(const TopicPartition& topic_partition, size_t value) {
+    TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+    quantums_[key] = max<size_t>(value, 1);
+}
+
+void FairPoller::set_idle_wait(milliseconds value) {
+    idle_wait_ = max(value, milliseconds(1));
+}
+
+Message FairPoller::poll() {
+    return poll(consumer_.get_timeout());
+}
+
+Message FairPoller::poll(milliseconds timeout) {
+    const auto deadline = steady_clock::now() + timeout;
+    while (true) {
+        Message msg = poll_partitions();
+        if (msg) {
+            return msg;
+        }
+        // A round is done, serve the consumer queue. If no partition had anything, block
+        // on it for a bit rather than spinning
+        const bool idle = !served_in_round_;
+        served_in_round_ = false;
+        milliseconds wait(0);
+        if (idle) {
+            const auto remaining = max(duration_cast<milliseconds>(deadline - steady_clock::now()),
+                                       milliseconds(0));
+            wait = partitions_.empty() ? remaining : min(remaining, idle_wait_);
+        }
+        msg = consumer_.poll(wait);
+        if (msg || (idle && steady_clock::now() >= deadline)) {
+            return msg;
+        }
+    }
+}
+
+FairPoller::ServiceCount
+FairPoller::get_service_count(const TopicPartition& topic_partition) const {
+    for (const Partition& partition : partitions_) {
+        if (partition.topic_partition.get_partition() == topic_partition.get_partition() &&
+            partition.topic_partition.get_topic() == topic_partition.get_topic()) {
+            return partition.service_count;
+        }
+    }
+    return ServiceCount{ 0, 0 };
+}
+
+map<TopicPartition, FairPoller::ServiceCount> FairPoller::get_service_counts() const {
+    map<TopicPartition, ServiceCount> output;
+    for (const Partition& partition : partitions_) {
+        output.emplace(partition.topic_partition, partition.service_count);
+    }
+    return output;
+}
+
+void FairPoller::reset_service_counts() {
+    for (Partition& partition : partitions_) {
+        partition.service_count = ServiceCount{ 0, 0 };
+    }
+}
+
+void FairPoller::pause_partitions(const TopicPartitionList& topic_partitions) {
+    consumer_.pause_partitions(topic_partitions);
+}
+
+void FairPoller::resume_partitions(const TopicPartitionList& topic_partitions) {
+    consumer_.resume_partitions(topic_partitions);
+}
+
+TopicPartitionList FairPoller::get_assignment() const {
+    return consumer_.get_assignment();
+}
+
+Consumer& FairPoller::get_consumer() {
+    return consumer_;
+}
+
+void FairPoller::on_assignment(const TopicPartitionList& topic_partitions) {
+    const bool was_empty = partitions_.empty();
+    for (const TopicPartition& assigned : topic_partitions) {
+        TopicPartition topic_partition(assigned.get_topic(), assigned.get_partition());
+        auto iter = find_if(partitions_.begin(), partitions_.end(),
+                            [&](const Partition& partition) {
+                                return partition.topic_partition == topic_partition;
+                            });
+        if (iter != partitions_.end()) {
+            continue;
+        }
+        // Take the partition's messages out of the consumer queue
+        Queue queue = consumer_.get_partition_queue(topic_partition);
+        queue.disable_queue_forwarding();
+        partitions_.push_back(Partition{ move(topic_partition), move(queue), 0, { 0, 0 } });
+    }
+    if (was_empty && !partitions_.empty()) {
+        current_partition_ = 0;
+        start_turn(partitions_.front());
+    }
+}
+
+void FairPoller::on_revocation(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& revoked : topic_partitions) {
+        auto iter = find_if(partitions_.begin(), partitions_.end(),
+                            [&](const Partition& partition) {
+                                return partition.topic_partition.get_partition() ==
+                                       revoked.get_partition() &&
+                                       partition.topic_partition.get_topic() ==
+                                       revoked.get_topic();
+                            });
+        if (iter == partitions_.end()) {
+            continue;
+        }
+        iter->queue.forward_to_queue(consumer_queue_);
+        const size_t index = iter - partitions_.begin();
+        partitions_.erase(iter);
+        if (index < current_partition_) {
+            current_partition_--;
+        }
+    }
+    if (current_partition_ >= partitions_.size()) {
+        current_partition_ = 0;
+        if (!partitions_.empty()) {
+            start_turn(partitions_.front());
+        }
+    }
+}
+
+Message FairPoller::poll_partitions() {
+    while (current_partition_ < partitions_.size()) {
+        Partition& partition = partitions_[current_partition_];
+        if (partition.deficit > 0) {
+            Message msg = partition.queue.consume(milliseconds(0));
+            if (msg) {
+                if (!msg.get_error()) {
+                    const size_t size = msg.get_key().get_size() + msg.get_payload().get_size();
+                    // Empty messages still cost something so a turn can't go on forever
+                    partition.deficit -= mode_ == Mode::ROUND_ROBIN ? 1 : max<size_t>(size, 1);
+                    partition.service_count.messages++;
+                    partition.service_count.bytes += size;
+                    served_in_round_ = true;
+                }
+                return msg;
+            }
+            // Partitions with nothing to consume don't keep their credit
+            partition.deficit = 0;
+        }
+        current_partition_++;
+        if (current_partition_ < partitions_.size()) {
+            start_turn(partitions_[current_partition_]);
+        }
+    }
+    // Start over on the next call
+    current_partition_ = 0;
+    if (!partitions_.empty()) {
+        start_turn(partitions_.front());
+    }
+    return Message();
+}
+
+void FairPoller::start_turn(Partition& partition) {
+    const int64_t quantum = static_cast<int64_t>(get_quantum(partition.topic_partition));
+    if (mode_ == Mode::ROUND_ROBIN) {
+        partition.deficit = quantum;
+    }
+    else {
+        // Deficits only carry over when they're negative, i.e. the last message overdrew
+        partition.deficit = min<int64_t>(partition.deficit, 0) + quantum;
+    }
+}
+
+size_t FairPoller::get_quantum(const TopicPartition& topic_partition) const {
+    auto iter = quantums_.find(topic_partition);
+    return iter != quantums_.end() ? iter->second : default_quantum_;
+}
+
+} // cppkafka
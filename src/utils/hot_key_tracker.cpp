@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/hot_key_tracker.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::mutex;
+using std::lock_guard;
+using std::max;
+using std::move;
+using std::memory_order_relaxed;
+
+namespace cppkafka {
+
+const size_t HotKeyTracker::DEFAULT_CAPACITY = 32;
+
+HotKeyTracker::PartitionState::PartitionState(size_t capacity)
+: stats{0, 0}, keyed_messages(0), keys(capacity) {
+
+}
+
+HotKeyTracker::HotKeyTracker(size_t capacity)
+: capacity_(max<size_t>(capacity, 1)) {
+
+}
+
+void HotKeyTracker::set_sample_rate(unsigned value) {
+    sample_rate_ = max(value, 1u);
+}
+
+void HotKeyTracker::record(const Message& message) {
+    const Buffer& key = message.get_key();
+    const size_t size = message.get_payload().get_size() + key.get_size();
+    const unsigned weight = get_sample_weight(key);
+    lock_guard<mutex> _(mutex_);
+    record(get_partitions(message.get_handle()->rkt), message.get_partition(), key, size,
+           weight);
+}
+
+void HotKeyTracker::record(const MessageBuilder& builder) {
+    record(builder.topic(), builder.partition(), builder.key(),
+           builder.payload().get_size() + builder.key().get_size());
+}
+
+void HotKeyTracker::record(const string& topic, int partition, const Buffer& key,
+                           size_t size) {
+    const unsigned weight = get_sample_weight(key);
+    lock_guard<mutex> _(mutex_);
+    record(topics_[topic], partition, key, size, weight);
+}
+
+unsigned HotKeyTracker::get_sample_weight(const Buffer& key) {
+    // Keyless messages don't advance the sampling counter
+    if (!key) {
+        return 0;
+    }
+    const unsigned rate = sample_rate_;
+    return (sample_counter_.fetch_add(1, memory_order_relaxed) + 1) % rate == 0 ? rate : 0;
+}
+
+HotKeyTracker::PartitionMap& HotKeyTracker::get_partitions(rd_kafka_topic_t* handle) {
+    const char* name = rd_kafka_topic_name(handle);
+    auto iter = topic_handles_.find(handle);
+    // A topic handle can be destroyed and its address reused for another topic, so make sure
+    // the cached one still has the same name. This doesn't allocate, unlike a lookup by name
+    if (iter != topic_handles_.end() && iter->second->first == name) {
+        return iter->second->second;
+    }
+    auto topic_iter = topics_.emplace(name, PartitionMap()).first;
+    topic_handles_[handle] = topic_iter;
+    return topic_iter->second;
+}
+
+void HotKeyTracker::record(PartitionMap& partitions, int partition, const Buffer& key,
+                           size_t size, unsigned weight) {
+    auto iter = partitions.find(partition);
+    if (iter == partitions.end()) {
+        iter = partitions.emplace(partition, PartitionState(capacity_)).first;
+    }
+    PartitionState& state = iter->second;
+    state.stats.messages++;
+    state.stats.bytes += size;
+    if (!key) {
+        return;
+    }
+    state.keyed_messages++;
+    if (weight > 0) {
+        state.keys.add(reinterpret_cast<const char*>(key.get_data()), key.get_size(), weight);
+    }
+}
+
+vector<HotKeyTracker::HeavyHitter>
+HotKeyTracker::get_heavy_hitters(const TopicPartition& topic_partition, size_t count) const {
+    lock_guard<mutex> _(mutex_);
+    vector<HeavyHitter> output;
+    const PartitionState* state = find_partition(topic_partition);
+    if (state) {
+        for (auto& counter : state->keys.get_top(count)) {
+            output.push_back(HeavyHitter{ move(counter.key), counter.count, counter.error });
+        }
+    }
+    return output;
+}
+
+double HotKeyTracker::get_key_skew(const TopicPartition& topic_partition) const {
+    lock_guard<mutex> _(mutex_);
+    const PartitionState* state = find_partition(topic_partition);
+    if (!state || state->keyed_messages == 0) {
+        return 0;
+    }
+    const auto top = state->keys.get_top(1);
+    if (top.empty()) {
+        return 0;
+    }
+    // Sampling can make the estimate go slightly over the real count
+    return std::min(1.0, static_cast<double>(top.front().count) / state->keyed_messages);
+}
+
+double HotKeyTracker::get_partition_skew(const string& topic) const {
+    lock_guard<mutex> _(mutex_);
+    auto iter = topics_.find(topic);
+    if (iter == topics_.end()) {
+        return 0;
+    }
+    uint64_t total = 0;
+    uint64_t busiest = 0;
+    size_t partition_count = 0;
+    for (const auto& partition : iter->second) {
+        if (partition.first == RD_KAFKA_PARTITION_UA) {
+            continue;
+        }
+        total += partition.second.stats.messages;
+        busiest = max(busiest, partition.second.stats.messages);
+        partition_count++;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    return static_cast<double>(busiest) * partition_count / total;
+}
+
+HotKeyTracker::PartitionStats
+HotKeyTracker::get_partition_stats(const TopicPartition& topic_partition) const {
+    lock_guard<mutex> _(mutex_);
+    const PartitionState* state = find_partition(topic_partition);
+    return state ? state->stats : PartitionStats{0, 0};
+}
+
+map<TopicPartition, HotKeyTracker::PartitionStats> HotKeyTracker::get_partition_stats() const {
+    lock_guard<mutex> _(mutex_);
+    map<TopicPartition, PartitionStats> output;
+    for (const auto& topic : topics_) {
+        for (const auto& partition : topic.second) {
+            output.emplace(TopicPartition(topic.first, partition.first), partition.second.stats);
+        }
+    }
+    return output;
+}
+
+void HotKeyTracker::reset() {
+    lock_guard<mutex> _(mutex_);
+    topic_handles_.clear();
+    topics_.clear();
+    sample_counter_ = 0;
+}
+
+const HotKeyTracker::PartitionState*
+HotKeyTracker::find_partition(const TopicPartition& topic_partition) const {
+    auto topic_iter = topics_.find(topic_partition.get_topic());
+    if (topic_iter == topics_.end()) {
+        return nullptr;
+    }
+    auto iter = topic_iter->second.find(topic_partition.get_partition());
+    return iter != topic_iter->second.end() ? &iter->second : nullptr;
+}
+
+} // cppkafka
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <atomic>
+#include <algorithm>
+#include "utils/memory_governor.h"
+
+using std::atomic;
+using std::set;
+using std::shared_ptr;
+using std::make_shared;
+using std::min;
+using std::max;
+
+using std::chrono::milliseconds;
+
+namespace cppkafka {
+
+using detail::MemoryAccount;
+using detail::MemoryLease;
+
+const double MemoryGovernor::DEFAULT_RESUME_THRESHOLD = 0.75;
+
+static atomic<size_t> global_budget{0};
+
+void MemoryGovernor::set_global_budget(size_t value) {
+    global_budget = value;
+}
+
+size_t MemoryGovernor::get_global_budget() {
+    return global_budget;
+}
+
+size_t MemoryGovernor::get_global_usage() {
+    return get_global_account()->get_usage();
+}
+
+MemoryGovernor::MemoryGovernor(Consumer& consumer, size_t budget)
+: consumer_(consumer), account_(make_shared<MemoryAccount>(get_global_account())),
+  budget_(budget), resume_threshold_(DEFAULT_RESUME_THRESHOLD) {
+    // Save the current callback and set ours
+    original_revocation_callback_ = consumer_.get_revocation_callback();
+    consumer_.set_revocation_callback([&](const TopicPartitionList& topic_partitions) {
+        if (original_revocation_callback_) {
+            original_revocation_callback_(topic_partitions);
+        }
+        on_revocation(topic_partitions);
+    });
+}
+
+MemoryGovernor::~MemoryGovernor() {
+    consumer_.set_revocation_callback(original_revocation_callback_);
+}
+
+void MemoryGovernor::set_budget(size_t value) {
+    budget_ = value;
+}
+
+size_t MemoryGovernor::get_budget() const {
+    return budget_;
+}
+
+size_t MemoryGovernor::get_usage() const {
+    return account_->get_usage();
+}
+
+void MemoryGovernor::set_resume_threshold(double value) {
+    resume_threshold_ = min(max(value, 0.0), 1.0);
+}
+
+Message MemoryGovernor::poll() {
+    return poll(consumer_.get_timeout());
+}
+
+Message MemoryGovernor::poll(milliseconds timeout) {
+    Message msg = consumer_.poll(timeout);
+    if (msg) {
+        track(msg);
+    }
+    else {
+        update();
+    }
+    return msg;
+}
+
+void MemoryGovernor::track(Message& message) {
+    if (message) {
+        message.lease_ = MemoryLease(account_, get_message_size(message));
+    }
+    update();
+}
+
+void MemoryGovernor::update() {
+    if (!paused_) {
+        if (is_over_budget()) {
+            pause_assignment();
+        }
+    }
+    else if (is_below_threshold()) {
+        resume_assignment();
+    }
+    else {
+        // Partitions may have been assigned since we paused
+        pause_assignment();
+    }
+}
+
+bool MemoryGovernor::is_paused() const {
+    return paused_;
+}
+
+void MemoryGovernor::pause_partitions(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        user_paused_partitions_.emplace(topic_partition.get_topic(),
+                                        topic_partition.get_partition());
+    }
+    consumer_.pause_partitions(topic_partitions);
+}
+
+void MemoryGovernor::resume_partitions(const TopicPartitionList& topic_partitions) {
+    TopicPartitionList resumed_partitions;
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+        user_paused_partitions_.erase(key);
+        // Keep it paused until we're below the threshold
+        if (paused_) {
+            paused_partitions_.insert(key);
+        }
+        else {
+            resumed_partitions.push_back(key);
+        }
+    }
+    if (!resumed_partitions.empty()) {
+        consumer_.resume_partitions(resumed_partitions);
+    }
+}
+
+TopicPartitionList MemoryGovernor::get_assignment() const {
+    return consumer_.get_assignment();
+}
+
+Consumer& MemoryGovernor::get_consumer() {
+    return consumer_;
+}
+
+shared_ptr<MemoryAccount> MemoryGovernor::get_global_account() {
+    static const shared_ptr<MemoryAccount> account = make_shared<MemoryAccount>();
+    return account;
+}
+
+size_t MemoryGovernor::get_message_size(const Message& message) {
+    return message.get_payload().get_size() + message.get_key().get_size();
+}
+
+bool MemoryGovernor::is_over_budget() const {
+    const size_t global_limit = global_budget;
+    return (budget_ > 0 && get_usage() > budget_) ||
+           (global_limit > 0 && get_global_usage() > global_limit);
+}
+
+bool MemoryGovernor::is_below_threshold() const {
+    const size_t global_limit = global_budget;
+    return (budget_ == 0 || get_usage() <= budget_ * resume_threshold_) &&
+           (global_limit == 0 || get_global_usage() <= global_limit * resume_threshold_);
+}
+
+void MemoryGovernor::on_revocation(const TopicPartitionList& topic_partitions) {
+    // Partitions come back unpaused when they're reassigned
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+        paused_partitions_.erase(key);
+        user_paused_partitions_.erase(key);
+    }
+}
+
+void MemoryGovernor::pause_assignment() {
+    set<TopicPartition> assigned_partitions;
+    TopicPartitionList new_partitions;
+    for (const TopicPartition& topic_partition : consumer_.get_assignment()) {
+        TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+        assigned_partitions.insert(key);
+        if (user_paused_partitions_.count(key) == 0 && paused_partitions_.insert(key).second) {
+            new_partitions.push_back(key);
+        }
+    }
+    // Forget partitions that were unassigned without a revocation, e.g. through
+    // Consumer::unassign, as they'll be unpaused if they're ever assigned again
+    for (auto iter = paused_partitions_.begin(); iter != paused_partitions_.end();) {
+        if (assigned_partitions.count(*iter) == 0) {
+            iter = paused_partitions_.erase(iter);
+        }
+        else {
+            ++iter;
+        }
+    }
+    if (!new_partitions.empty()) {
+        consumer_.pause_partitions(new_partitions);
+    }
+    paused_ = true;
+}
+
+void MemoryGovernor::resume_assignment() {
+    TopicPartitionList resumed_partitions;
+    for (const TopicPartition& topic_partition : consumer_.get_assignment()) {
+        TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+        if (paused_partitions_.count(key) != 0 && user_paused_partitions_.count(key) == 0) {
+            resumed_partitions.push_back(key);
+        }
+    }
+    paused_partitions_.clear();
+    paused_ = false;
+    if (!resumed_partitions.empty()) {
+        consumer_.resume_partitions(resumed_partitions);
+    }
+}
+
+} // cppkafka
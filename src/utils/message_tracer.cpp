@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/message_tracer.h"
+#include "exceptions.h"
+
+using std::string;
+using std::vector;
+using std::move;
+using std::min;
+using std::max;
+using std::mutex;
+using std::lock_guard;
+using std::random_device;
+
+using std::chrono::milliseconds;
+using std::chrono::system_clock;
+using std::chrono::duration_cast;
+
+namespace cppkafka {
+
+const string MessageTracer::DEFAULT_HEADER_NAME = "cppkafka-trace";
+const size_t MessageTracer::MAX_HOPS = 32;
+
+static const uint8_t TRACE_VERSION = 1;
+
+static void write_varint(string& output, uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+}
+
+// Zigzag encoding so small negative deltas (clock skew) stay small
+static void write_signed_varint(string& output, int64_t value) {
+    write_varint(output, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+static uint64_t read_varint(const uint8_t*& position, const uint8_t* end) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (position == end) {
+            throw Exception("Truncated trace context");
+        }
+        const uint8_t byte = *position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw Exception("Malformed trace context varint");
+}
+
+static int64_t read_signed_varint(const uint8_t*& position, const uint8_t* end) {
+    const uint64_t value = read_varint(position, end);
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+string MessageTracer::encode(const TraceContext& context) {
+    string output;
+    output.reserve(1 + 8 + 6 + 1 + context.hops.size() * 4);
+    output.push_back(static_cast<char>(TRACE_VERSION));
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>(context.trace_id >> shift));
+    }
+    write_varint(output, context.origin.count());
+    write_varint(output, context.hops.size());
+    // Every timestamp is stored as a delta from the previous one
+    int64_t previous = context.origin.count();
+    for (const Hop& hop : context.hops) {
+        write_signed_varint(output, hop.received.count() - previous);
+        write_signed_varint(output, hop.sent.count() - hop.received.count());
+        previous = hop.sent.count();
+    }
+    return output;
+}
+
+MessageTracer::TraceContext MessageTracer::decode(const Buffer& value) {
+    const uint8_t* position = value.get_data();
+    const uint8_t* end = position + value.get_size();
+    if (value.get_size() < 9) {
+        throw Exception("Truncated trace context");
+    }
+    if (*position++ != TRACE_VERSION) {
+        throw Exception("Unsupported trace context version");
+    }
+    TraceContext context{ 0, milliseconds(0), {}, milliseconds(0) };
+    for (int i = 0; i < 8; ++i) {
+        context.trace_id = (context.trace_id << 8) | *position++;
+    }
+    context.origin = milliseconds(read_varint(position, end));
+    const uint64_t hop_count = read_varint(position, end);
+    if (hop_count > MAX_HOPS) {
+        throw Exception("Too many hops in trace context");
+    }
+    int64_t previous = context.origin.count();
+    for (uint64_t i = 0; i < hop_count; ++i) {
+        const int64_t received = previous + read_signed_varint(position, end);
+        const int64_t sent = received + read_signed_varint(position, end);
+        context.hops.push_back(Hop{ milliseconds(received), milliseconds(sent) });
+        previous = sent;
+    }
+    return context;
+}
+
+vector<MessageTracer::HopLatency>
+MessageTracer::get_latency_breakdown(const TraceContext& context) {
+    vector<HopLatency> output;
+    milliseconds previous = context.origin;
+    for (const Hop& hop : context.hops) {
+        output.push_back(HopLatency{ hop.received - previous, hop.sent - hop.received });
+        previous = hop.sent;
+    }
+    if (context.received.count() != 0) {
+        output.push_back(HopLatency{ context.received - previous, milliseconds(0) });
+    }
+    return output;
+}
+
+milliseconds MessageTracer::get_end_to_end_latency(const TraceContext& context) {
+    if (context.received.count() == 0) {
+        return milliseconds(0);
+    }
+    return context.received - context.origin;
+}
+
+MessageTracer::MessageTracer(double sample_rate)
+: header_name_(DEFAULT_HEADER_NAME), generator_(random_device{}()) {
+    set_sample_rate(sample_rate);
+}
+
+void MessageTracer::set_sample_rate(double value) {
+    sample_rate_ = min(max(value, 0.0), 1.0);
+}
+
+void MessageTracer::set_header_name(string value) {
+    header_name_ = move(value);
+}
+
+void MessageTracer::set_trace_callback(TraceCallback callback) {
+    trace_callback_ = move(callback);
+}
+
+MessageTracer::TraceContext MessageTracer::start() {
+    TraceContext context{ 0, milliseconds(0), {}, milliseconds(0) };
+    uint64_t trace_id;
+    {
+        lock_guard<mutex> _(generator_mutex_);
+        trace_id = generator_();
+    }
+    // Use the id's top 53 bits as a uniform number in [0, 1) to decide on sampling
+    const double sample = (trace_id >> 11) * (1.0 / (UINT64_C(1) << 53));
+    if (trace_id != 0 && sample < sample_rate_) {
+        context.trace_id = trace_id;
+        context.origin = now();
+    }
+    return context;
+}
+
+#if RD_KAFKA_VERSION >= 0x000b04ff
+
+MessageTracer::TraceContext MessageTracer::extract(const Message& message) const {
+    return extract(message.get_header(header_name_));
+}
+
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
+MessageTracer::TraceContext MessageTracer::extract(const Buffer& value) const {
+    TraceContext context{ 0, milliseconds(0), {}, milliseconds(0) };
+    if (!value) {
+        return context;
+    }
+    try {
+        context = decode(value);
+    }
+    catch (const Exception&) {
+        // Don't let a corrupt trace break message processing
+        return TraceContext{ 0, milliseconds(0), {}, milliseconds(0) };
+    }
+    context.received = now();
+    if (trace_callback_) {
+        trace_callback_(context);
+    }
+    return context;
+}
+
+milliseconds MessageTracer::now() {
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+}
+
+} // cppkafka
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include "utils/offset_fetcher.h"
+#include "exceptions.h"
+
+using std::move;
+using std::max;
+using std::map;
+using std::vector;
+using std::find;
+using std::sort;
+using std::unique;
+using std::tie;
+using std::lower_bound;
+
+using std::chrono::milliseconds;
+
+namespace cppkafka {
+
+const int64_t OffsetFetcher::DEFAULT_WINDOW_SIZE = 64;
+const int64_t OffsetFetcher::DEFAULT_MAXIMUM_GAP = 256;
+const size_t OffsetFetcher::DEFAULT_MAXIMUM_CACHED_WINDOWS = 32;
+const milliseconds OffsetFetcher::DEFAULT_FETCH_TIMEOUT{5000};
+
+OffsetFetcher::OffsetFetcher(Configuration config)
+: consumer_(prepare_configuration(move(config))), window_size_(DEFAULT_WINDOW_SIZE),
+  maximum_gap_(DEFAULT_MAXIMUM_GAP), maximum_cached_windows_(DEFAULT_MAXIMUM_CACHED_WINDOWS),
+  fetch_timeout_(DEFAULT_FETCH_TIMEOUT) {
+
+}
+
+const Message& OffsetFetcher::fetch(const TopicPartition& topic_partition) {
+    const int64_t offset = topic_partition.get_offset();
+    const Message* output = find_cached(topic_partition);
+    if (!output) {
+        const Window& window = read_window(topic_partition, offset, offset + window_size_);
+        output = find_in_window(window, offset);
+    }
+    return output ? *output : empty_message_;
+}
+
+void OffsetFetcher::fetch(const TopicPartitionList& topic_partitions,
+                          const MessageCallback& callback) {
+    // Group the requested offsets by topic/partition, skipping the ones we have cached
+    map<TopicPartition, vector<int64_t>> requests;
+    for (const TopicPartition& topic_partition : topic_partitions) {
+        const Message* cached = find_cached(topic_partition);
+        if (cached) {
+            callback(*cached);
+        }
+        else {
+            TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+            requests[key].push_back(topic_partition.get_offset());
+        }
+    }
+    for (auto& request : requests) {
+        const TopicPartition& topic_partition = request.first;
+        vector<int64_t>& offsets = request.second;
+        sort(offsets.begin(), offsets.end());
+        offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
+
+        // Read every run of offsets that are close enough to each other in a single window
+        size_t first_index = 0;
+        while (first_index < offsets.size()) {
+            size_t last_index = first_index;
+            while (last_index + 1 < offsets.size() &&
+                   offsets[last_index + 1] - offsets[last_index] <= maximum_gap_) {
+                last_index++;
+            }
+            const int64_t first_offset = offsets[first_index];
+            const int64_t end_offset = max(offsets[last_index] + 1, first_offset + window_size_);
+            const Window& window = read_window(topic_partition, first_offset, end_offset);
+            for (size_t i = first_index; i <= last_index; ++i) {
+                const Message* message = find_in_window(window, offsets[i]);
+                if (message) {
+                    callback(*message);
+                }
+            }
+            first_index = last_index + 1;
+        }
+    }
+}
+
+void OffsetFetcher::set_window_size(int64_t value) {
+    window_size_ = max<int64_t>(value, 1);
+}
+
+void OffsetFetcher::set_maximum_gap(int64_t value) {
+    maximum_gap_ = value;
+}
+
+void OffsetFetcher::set_maximum_cached_windows(size_t value) {
+    // We always need to keep the last window read
+    maximum_cached_windows_ = max<size_t>(value, 1);
+    while (windows_.size() > maximum_cached_windows_) {
+        windows_.pop_back();
+    }
+}
+
+void OffsetFetcher::set_fetch_timeout(milliseconds value) {
+    fetch_timeout_ = value;
+}
+
+void OffsetFetcher::clear_cache() {
+    windows_.clear();
+}
+
+Consumer& OffsetFetcher::get_consumer() {
+    return consumer_;
+}
+
+Configuration OffsetFetcher::prepare_configuration(Configuration config) {
+    config.set("enable.auto.commit", false);
+    return config;
+}
+
+const Message* OffsetFetcher::find_cached(const TopicPartition& topic_partition) {
+    const int64_t offset = topic_partition.get_offset();
+    for (auto iter = windows_.begin(); iter != windows_.end(); ++iter) {
+        if (iter->topic_partition == topic_partition && offset >= iter->first_offset &&
+            offset < iter->end_offset) {
+            // Move it to the front so the least recently used windows are evicted first
+            windows_.splice(windows_.begin(), windows_, iter);
+            return find_in_window(windows_.front(), offset);
+        }
+    }
+    return nullptr;
+}
+
+const Message* OffsetFetcher::find_in_window(const Window& window, int64_t offset) const {
+    auto iter = lower_bound(window.messages.begin(), window.messages.end(), offset,
+                            [](const Message& message, int64_t value) {
+                                return message.get_offset() < value;
+                            });
+    if (iter == window.messages.end() || iter->get_offset() != offset) {
+        return nullptr;
+    }
+    return &*iter;
+}
+
+OffsetFetcher::Window& OffsetFetcher::read_window(const TopicPartition& topic_partition,
+                                                  int64_t first_offset, int64_t end_offset) {
+    TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+    // Don't wait for messages that don't exist yet. The cached high watermark may be stale
+    // or missing, so ask the brokers before giving up
+    if (first_offset >= get_cached_high_watermark(key)) {
+        int64_t low;
+        int64_t high;
+        tie(low, high) = consumer_.query_offsets(key);
+        if (first_offset >= high) {
+            return empty_window_;
+        }
+    }
+    Window window{ key, first_offset, end_offset, {} };
+    prepare_partition(key, first_offset);
+
+    const auto deadline = ClockType::now() + fetch_timeout_;
+    bool reached_end = false;
+    while (!reached_end && ClockType::now() < deadline) {
+        Message msg = consumer_.poll();
+        if (!msg) {
+            continue;
+        }
+        if (msg.get_error() && !msg.is_eof()) {
+            throw ConsumerException(msg.get_error());
+        }
+        // Skip anything that was fetched for other partitions before they were paused
+        if (msg.get_partition() != key.get_partition() || msg.get_topic() != key.get_topic()) {
+            continue;
+        }
+        if (msg.is_eof()) {
+            break;
+        }
+        const int64_t offset = msg.get_offset();
+        if (offset < first_offset) {
+            continue;
+        }
+        reached_end = offset + 1 >= end_offset;
+        if (offset < end_offset) {
+            window.messages.push_back(move(msg));
+        }
+        if (!reached_end) {
+            // Don't wait for messages that don't exist yet
+            int64_t low;
+            int64_t high;
+            tie(low, high) = consumer_.get_offsets(key);
+            if (high >= 0 && offset + 1 >= high) {
+                break;
+            }
+        }
+    }
+    // If we stopped early, only consider the offsets we actually went through as known so
+    // anything after them is fetched again next time
+    if (!reached_end) {
+        window.end_offset = window.messages.empty() ? first_offset :
+                            window.messages.back().get_offset() + 1;
+    }
+    consumer_.pause_partitions({ key });
+
+    windows_.push_front(move(window));
+    while (windows_.size() > maximum_cached_windows_) {
+        windows_.pop_back();
+    }
+    return windows_.front();
+}
+
+int64_t OffsetFetcher::get_cached_high_watermark(const TopicPartition& topic_partition) const {
+    try {
+        int64_t low;
+        int64_t high;
+        tie(low, high) = consumer_.get_offsets(topic_partition);
+        return high;
+    }
+    catch (const HandleException&) {
+        // Nothing was cached for this partition yet
+        return -1;
+    }
+}
+
+void OffsetFetcher::prepare_partition(const TopicPartition& topic_partition, int64_t offset) {
+    auto iter = find(assignment_.begin(), assignment_.end(), topic_partition);
+    if (iter == assignment_.end()) {
+        // Everything that's currently assigned is paused, so keep it that way after assigning
+        TopicPartitionList paused_partitions = assignment_;
+        assignment_.emplace_back(topic_partition.get_topic(), topic_partition.get_partition(),
+                                 offset);
+        consumer_.assign(assignment_);
+        if (!paused_partitions.empty()) {
+            consumer_.pause_partitions(paused_partitions);
+        }
+    }
+    else {
+        consumer_.seek({ topic_partition.get_topic(), topic_partition.get_partition(), offset });
+        consumer_.resume_partitions({ topic_partition });
+    }
+}
+
+} // cppkafka
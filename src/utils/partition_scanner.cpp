@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tuple>
+#include "utils/partition_scanner.h"
+#include "exceptions.h"
+
+using std::move;
+using std::tie;
+
+namespace cppkafka {
+
+PartitionScanner::PartitionScanner(Consumer& consumer)
+: consumer_(consumer) {
+
+}
+
+void PartitionScanner::add_range(const TopicPartition& start, int64_t end_offset) {
+    const int64_t start_offset = start.get_offset();
+    // Skip it if we know beforehand there's nothing to read
+    if (start_offset == TopicPartition::OFFSET_END ||
+        (start_offset >= 0 && start_offset >= end_offset)) {
+        return;
+    }
+    TopicPartition topic_partition(start.get_topic(), start.get_partition());
+    auto result = ranges_.emplace(topic_partition, Range{ end_offset, false });
+    if (!result.second) {
+        throw Exception("Range already added for " + start.get_topic() + "/" +
+                        std::to_string(start.get_partition()));
+    }
+    assignment_.push_back(start);
+    pending_ranges_++;
+}
+
+void PartitionScanner::add_range(const TopicPartition& start) {
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer_.query_offsets(start);
+    // Nothing to read if the partition is empty
+    if (start.get_offset() == TopicPartition::OFFSET_BEGINNING && low >= high) {
+        return;
+    }
+    add_range(start, high);
+}
+
+void PartitionScanner::set_error_callback(ErrorCallback callback) {
+    error_callback_ = move(callback);
+}
+
+void PartitionScanner::scan(const MessageCallback& callback) {
+    if (pending_ranges_ == 0) {
+        return;
+    }
+    running_ = true;
+    consumer_.assign(assignment_);
+    try {
+        while (running_ && pending_ranges_ > 0) {
+            Message msg = consumer_.poll();
+            if (!msg) {
+                check_positions();
+                continue;
+            }
+            if (msg.get_error() && !msg.is_eof()) {
+                if (!error_callback_) {
+                    throw ConsumerException(msg.get_error());
+                }
+                error_callback_(msg.get_error());
+                continue;
+            }
+            TopicPartition topic_partition(msg.get_topic(), msg.get_partition());
+            auto iter = ranges_.find(topic_partition);
+            // Ignore anything that was already fetched for finished ranges
+            if (iter == ranges_.end() || iter->second.done) {
+                continue;
+            }
+            Range& range = iter->second;
+            if (msg.is_eof() || msg.get_offset() >= range.end_offset) {
+                finish_range(topic_partition, range);
+                continue;
+            }
+            // Offsets may have gaps (e.g. compacted topics) so don't expect to see end - 1
+            const bool is_last = msg.get_offset() + 1 >= range.end_offset;
+            callback(move(msg));
+            if (is_last) {
+                finish_range(topic_partition, range);
+            }
+        }
+    }
+    catch (...) {
+        reset();
+        throw;
+    }
+    reset();
+}
+
+void PartitionScanner::stop() {
+    running_ = false;
+}
+
+size_t PartitionScanner::get_pending_ranges() const {
+    return pending_ranges_;
+}
+
+void PartitionScanner::finish_range(const TopicPartition& topic_partition, Range& range) {
+    range.done = true;
+    pending_ranges_--;
+    // Stop fetching data for it while the rest of the ranges are being read
+    consumer_.pause_partitions({ topic_partition });
+}
+
+void PartitionScanner::check_positions() {
+    TopicPartitionList topic_partitions;
+    for (const auto& range : ranges_) {
+        if (!range.second.done) {
+            topic_partitions.push_back(range.first);
+        }
+    }
+    // Offsets that aren't messages (e.g. transaction markers) still move the position forward
+    for (const TopicPartition& position : consumer_.get_offsets_position(topic_partitions)) {
+        auto iter = ranges_.find({ position.get_topic(), position.get_partition() });
+        if (iter != ranges_.end() && position.get_offset() >= 0 &&
+            position.get_offset() >= iter->second.end_offset) {
+            finish_range(iter->first, iter->second);
+        }
+    }
+}
+
+void PartitionScanner::reset() {
+    consumer_.unassign();
+    ranges_.clear();
+    assignment_.clear();
+    pending_ranges_ = 0;
+    running_ = false;
+}
+
+} // cppkafka
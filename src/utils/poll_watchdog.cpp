@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include "utils/poll_watchdog.h"
+#include "exceptions.h"
+
+using std::vector;
+using std::map;
+using std::pair;
+using std::move;
+using std::min;
+using std::max;
+using std::tie;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+
+using std::chrono::milliseconds;
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+namespace cppkafka {
+
+const double PollWatchdog::DEFAULT_WARNING_RATIO = 0.5;
+const milliseconds PollWatchdog::DEFAULT_STALL_TIMEOUT{30000};
+const milliseconds PollWatchdog::DEFAULT_CHECK_INTERVAL{1000};
+
+PollWatchdog::PollWatchdog(Consumer& consumer)
+: consumer_(consumer),
+  poll_interval_limit_(consumer.get_configuration().get<int>("max.poll.interval.ms")),
+  stall_timeout_(DEFAULT_STALL_TIMEOUT), check_interval_(DEFAULT_CHECK_INTERVAL),
+  warning_ratio_(DEFAULT_WARNING_RATIO) {
+    const int64_t now = to_ticks(ClockType::now());
+    last_poll_ = now;
+    last_check_ = now;
+}
+
+PollWatchdog::~PollWatchdog() {
+    stop_monitor();
+}
+
+void PollWatchdog::set_warning_ratio(double value) {
+    lock_guard<mutex> _(mutex_);
+    warning_ratio_ = min(max(value, 0.01), 1.0);
+}
+
+void PollWatchdog::set_stall_timeout(milliseconds value) {
+    lock_guard<mutex> _(mutex_);
+    stall_timeout_ = value;
+}
+
+void PollWatchdog::set_check_interval(milliseconds value) {
+    lock_guard<mutex> _(mutex_);
+    check_interval_ = value;
+}
+
+void PollWatchdog::set_pause_stalled_partitions(bool value) {
+    lock_guard<mutex> _(mutex_);
+    pause_stalled_partitions_ = value;
+}
+
+void PollWatchdog::set_poll_interval_callback(PollIntervalCallback callback) {
+    lock_guard<mutex> _(mutex_);
+    poll_interval_callback_ = move(callback);
+}
+
+void PollWatchdog::set_stalled_partition_callback(StalledPartitionCallback callback) {
+    lock_guard<mutex> _(mutex_);
+    stalled_partition_callback_ = move(callback);
+}
+
+Message PollWatchdog::poll() {
+    return poll(consumer_.get_timeout());
+}
+
+Message PollWatchdog::poll(milliseconds timeout) {
+    const int64_t start = to_ticks(ClockType::now());
+    const int64_t interval = start - last_poll_;
+    if (interval > max_poll_interval_) {
+        max_poll_interval_ = interval;
+    }
+    polling_ = true;
+    Message msg = consumer_.poll(timeout);
+    const ClockType::time_point now = ClockType::now();
+    last_poll_ = to_ticks(now);
+    polling_ = false;
+    poll_warned_ = false;
+
+    bool should_check;
+    {
+        lock_guard<mutex> _(mutex_);
+        should_check = !monitor_running_ &&
+                       to_duration(to_ticks(now) - last_check_) >= check_interval_;
+    }
+    if (should_check) {
+        check();
+    }
+    return msg;
+}
+
+void PollWatchdog::check() {
+    const ClockType::time_point now = ClockType::now();
+    last_check_ = to_ticks(now);
+    check_poll_interval(now);
+    check_partitions(now);
+}
+
+void PollWatchdog::start_monitor(milliseconds interval) {
+    stop_monitor();
+    {
+        lock_guard<mutex> _(mutex_);
+        monitor_running_ = true;
+    }
+    monitor_thread_ = thread(&PollWatchdog::run_monitor, this, interval);
+}
+
+void PollWatchdog::stop_monitor() {
+    {
+        lock_guard<mutex> _(mutex_);
+        monitor_running_ = false;
+    }
+    monitor_condition_.notify_all();
+    if (monitor_thread_.joinable()) {
+        monitor_thread_.join();
+    }
+}
+
+milliseconds PollWatchdog::get_poll_interval_limit() const {
+    return poll_interval_limit_;
+}
+
+milliseconds PollWatchdog::get_time_since_poll() const {
+    if (polling_) {
+        return milliseconds(0);
+    }
+    return to_duration(to_ticks(ClockType::now()) - last_poll_);
+}
+
+milliseconds PollWatchdog::get_max_poll_interval() const {
+    return to_duration(max_poll_interval_);
+}
+
+size_t PollWatchdog::get_late_poll_count() const {
+    return late_poll_count_;
+}
+
+PollWatchdog::PartitionProgress
+PollWatchdog::get_progress(const TopicPartition& topic_partition) const {
+    lock_guard<mutex> _(mutex_);
+    TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+    auto iter = partitions_.find(key);
+    if (iter == partitions_.end()) {
+        return PartitionProgress{ TopicPartition::OFFSET_INVALID, -1, 0, milliseconds(0),
+                                  false };
+    }
+    return iter->second.progress;
+}
+
+map<TopicPartition, PollWatchdog::PartitionProgress> PollWatchdog::get_progress() const {
+    lock_guard<mutex> _(mutex_);
+    map<TopicPartition, PartitionProgress> output;
+    for (const auto& partition : partitions_) {
+        output.emplace(partition.first, partition.second.progress);
+    }
+    return output;
+}
+
+void PollWatchdog::pause_partitions(const TopicPartitionList& topic_partitions) {
+    {
+        lock_guard<mutex> _(mutex_);
+        for (const TopicPartition& topic_partition : topic_partitions) {
+            paused_partitions_.emplace(topic_partition.get_topic(),
+                                       topic_partition.get_partition());
+        }
+    }
+    consumer_.pause_partitions(topic_partitions);
+}
+
+void PollWatchdog::resume_partitions(const TopicPartitionList& topic_partitions) {
+    {
+        lock_guard<mutex> _(mutex_);
+        const ClockType::time_point now = ClockType::now();
+        for (const TopicPartition& topic_partition : topic_partitions) {
+            TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+            paused_partitions_.erase(key);
+            auto iter = partitions_.find(key);
+            if (iter != partitions_.end()) {
+                iter->second.progress.stalled = false;
+                iter->second.last_advance = now;
+            }
+        }
+    }
+    consumer_.resume_partitions(topic_partitions);
+}
+
+TopicPartitionList PollWatchdog::get_assignment() const {
+    return consumer_.get_assignment();
+}
+
+Consumer& PollWatchdog::get_consumer() {
+    return consumer_;
+}
+
+milliseconds PollWatchdog::to_duration(int64_t ticks) {
+    return duration_cast<milliseconds>(ClockType::duration(ticks));
+}
+
+int64_t PollWatchdog::to_ticks(ClockType::time_point time_point) {
+    return time_point.time_since_epoch().count();
+}
+
+void PollWatchdog::check_poll_interval(ClockType::time_point now) {
+    if (polling_) {
+        return;
+    }
+    const milliseconds elapsed = to_duration(to_ticks(now) - last_poll_);
+    PollIntervalCallback callback;
+    {
+        lock_guard<mutex> _(mutex_);
+        if (elapsed.count() < poll_interval_limit_.count() * warning_ratio_) {
+            return;
+        }
+        callback = poll_interval_callback_;
+    }
+    // Only warn once per late poll
+    if (!poll_warned_.exchange(true)) {
+        late_poll_count_++;
+        if (callback) {
+            callback(elapsed, poll_interval_limit_);
+        }
+    }
+}
+
+void PollWatchdog::check_partitions(ClockType::time_point now) {
+    const TopicPartitionList assignment = consumer_.get_assignment();
+    TopicPartitionList positions;
+    if (!assignment.empty()) {
+        positions = consumer_.get_offsets_position(assignment);
+    }
+    // Nothing makes progress while polls are late, that's not the partitions' fault
+    const bool can_stall = !poll_warned_;
+
+    vector<pair<TopicPartition, PartitionProgress>> stalled_partitions;
+    TopicPartitionList paused_partitions;
+    StalledPartitionCallback callback;
+    {
+        lock_guard<mutex> _(mutex_);
+        map<TopicPartition, PartitionState> partitions;
+        for (const TopicPartition& topic_partition : positions) {
+            TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+            auto iter = partitions_.find(key);
+            PartitionState state;
+            if (iter != partitions_.end()) {
+                state = iter->second;
+            }
+            else {
+                state.progress = PartitionProgress{ TopicPartition::OFFSET_INVALID, -1, 0,
+                                                    milliseconds(0), false };
+                state.last_advance = now;
+                state.last_check = now;
+            }
+            if (update_partition(key, topic_partition.get_offset(), state, now, can_stall)) {
+                stalled_partitions.emplace_back(key, state.progress);
+                if (pause_stalled_partitions_) {
+                    paused_partitions_.insert(key);
+                    paused_partitions.push_back(key);
+                }
+            }
+            partitions.emplace(move(key), state);
+        }
+        // This drops the partitions that are no longer assigned
+        partitions_.swap(partitions);
+        // Partitions come back unpaused when they're reassigned, so forget the ones we lost
+        for (auto iter = paused_partitions_.begin(); iter != paused_partitions_.end();) {
+            if (partitions_.count(*iter) == 0) {
+                iter = paused_partitions_.erase(iter);
+            }
+            else {
+                ++iter;
+            }
+        }
+        callback = stalled_partition_callback_;
+    }
+    if (!paused_partitions.empty()) {
+        consumer_.pause_partitions(paused_partitions);
+    }
+    if (callback) {
+        for (const auto& stalled_partition : stalled_partitions) {
+            callback(stalled_partition.first, stalled_partition.second);
+        }
+    }
+}
+
+bool PollWatchdog::update_partition(const TopicPartition& topic_partition, int64_t position,
+                                    PartitionState& state, ClockType::time_point now,
+                                    bool can_stall) {
+    PartitionProgress& progress = state.progress;
+    const double elapsed = duration<double>(now - state.last_check).count();
+    if (position >= 0 && progress.position >= 0 && elapsed > 0) {
+        progress.rate = (position - progress.position) / elapsed;
+    }
+    else {
+        progress.rate = 0;
+    }
+    if (position != progress.position) {
+        progress.position = position;
+        progress.stalled = false;
+        state.last_advance = now;
+    }
+    state.last_check = now;
+    progress.idle_time = duration_cast<milliseconds>(now - state.last_advance);
+
+    progress.lag = -1;
+    if (position >= 0) {
+        try {
+            int64_t low;
+            int64_t high;
+            // This uses the watermarks cached by rdkafka so it doesn't hit the brokers
+            tie(low, high) = consumer_.get_offsets(topic_partition);
+            if (high >= 0) {
+                progress.lag = max<int64_t>(high - position, 0);
+            }
+        }
+        catch (const HandleException&) {
+            // No cached watermarks yet, lag is unknown
+        }
+    }
+
+    if (!can_stall || progress.stalled || progress.lag <= 0 ||
+        progress.idle_time < stall_timeout_ || paused_partitions_.count(topic_partition) != 0) {
+        return false;
+    }
+    progress.stalled = true;
+    return true;
+}
+
+void PollWatchdog::run_monitor(milliseconds interval) {
+    unique_lock<mutex> lock(mutex_);
+    while (monitor_running_) {
+        if (monitor_condition_.wait_for(lock, interval, [&] { return !monitor_running_; })) {
+            break;
+        }
+        lock.unlock();
+        check();
+        lock.lock();
+    }
+}
+
+} // cppkafka
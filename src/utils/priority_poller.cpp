@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include "utils/priority_poller.h"
+#include "exceptions.h"
+
+using std::string;
+using std::min;
+using std::max;
+using std::move;
+
+using std::chrono::milliseconds;
+
+namespace cppkafka {
+
+const milliseconds PriorityPoller::DEFAULT_IDLE_WAIT{10};
+
+PriorityPoller::PriorityPoller(Consumer& consumer, Mode mode)
+: consumer_(consumer), mode_(mode), consumer_queue_(consumer.get_consumer_queue()),
+  idle_wait_(DEFAULT_IDLE_WAIT) {
+    levels_.push_back(Level{ 0, 1, Queue() });
+    current_credits_ = levels_.front().weight;
+
+    // Save the current callbacks and set ours
+    original_assignment_callback_ = consumer_.get_assignment_callback();
+    original_revocation_callback_ = consumer_.get_revocation_callback();
+    consumer_.set_assignment_callback([&](TopicPartitionList& topic_partitions) {
+        if (original_assignment_callback_) {
+            original_assignment_callback_(topic_partitions);
+        }
+        on_assignment(topic_partitions);
+    });
+    consumer_.set_revocation_callback([&](const TopicPartitionList& topic_partitions) {
+        if (original_revocation_callback_) {
+            original_revocation_callback_(topic_partitions);
+        }
+        on_revocation(topic_partitions);
+    });
+}
+
+PriorityPoller::~PriorityPoller() {
+    consumer_.set_assignment_callback(original_assignment_callback_);
+    consumer_.set_revocation_callback(original_revocation_callback_);
+    // Don't leave partitions forwarding to queues that no one will consume
+    for (const auto& forwarded_partition : forwarded_partitions_) {
+        try {
+            Queue queue = consumer_.get_partition_queue(forwarded_partition.first);
+            queue.forward_to_queue(consumer_queue_);
+        }
+        catch (const Exception&) {
+            // The partition is gone, nothing to restore
+        }
+    }
+}
+
+void PriorityPoller::add_topic(const string& topic, unsigned priority, unsigned weight) {
+    get_level(priority, weight);
+    topic_priorities_[topic] = priority;
+    on_assignment(consumer_.get_assignment());
+}
+
+void PriorityPoller::add_partition(const TopicPartition& topic_partition, unsigned priority,
+                                   unsigned weight) {
+    get_level(priority, weight);
+    TopicPartition key(topic_partition.get_topic(), topic_partition.get_partition());
+    partition_priorities_[key] = priority;
+    on_assignment(consumer_.get_assignment());
+}
+
+void PriorityPoller::set_default_weight(unsigned weight) {
+    get_level(0, weight);
+}
+
+void PriorityPoller::set_idle_wait(milliseconds value) {
+    idle_wait_ = max(value, milliseconds(1));
+}
+
+Message PriorityPoller::poll() {
+    return poll(consumer_.get_timeout());
+}
+
+Message PriorityPoller::poll(milliseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        Message msg = mode_ == Mode::STRICT ? poll_strict() : poll_weighted();
+        if (msg) {
+            return msg;
+        }
+        const auto remaining = std::chrono::duration_cast<milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+        if (remaining <= milliseconds(0)) {
+            return msg;
+        }
+        // Nothing anywhere, wait on the highest priority queue for a bit
+        msg = consume(levels_.front(), min(remaining, idle_wait_));
+        if (msg) {
+            return msg;
+        }
+    }
+}
+
+void PriorityPoller::pause_partitions(const TopicPartitionList& topic_partitions) {
+    consumer_.pause_partitions(topic_partitions);
+}
+
+void PriorityPoller::resume_partitions(const TopicPartitionList& topic_partitions) {
+    consumer_.resume_partitions(topic_partitions);
+}
+
+TopicPartitionList PriorityPoller::get_assignment() const {
+    return consumer_.get_assignment();
+}
+
+Consumer& PriorityPoller::get_consumer() {
+    return consumer_;
+}
+
+PriorityPoller::Level& PriorityPoller::get_level(unsigned priority, unsigned weight) {
+    weight = max(weight, 1u);
+    auto iter = levels_.begin();
+    while (iter != levels_.end() && iter->priority > priority) {
+        ++iter;
+    }
+    if (iter != levels_.end() && iter->priority == priority) {
+        iter->weight = weight;
+        return *iter;
+    }
+    const size_t index = iter - levels_.begin();
+    Queue queue(rd_kafka_queue_new(consumer_.get_handle()));
+    levels_.insert(iter, Level{ priority, weight, move(queue) });
+    // Keep pointing at the same level while polling in weighted mode
+    if (index <= current_level_) {
+        current_level_++;
+    }
+    return levels_[index];
+}
+
+PriorityPoller::Level* PriorityPoller::find_level(const TopicPartition& topic_partition) {
+    unsigned priority = 0;
+    auto partition_iter = partition_priorities_.find(topic_partition);
+    if (partition_iter != partition_priorities_.end()) {
+        priority = partition_iter->second;
+    }
+    else {
+        auto topic_iter = topic_priorities_.find(topic_partition.get_topic());
+        if (topic_iter == topic_priorities_.end()) {
+            return nullptr;
+        }
+        priority = topic_iter->second;
+    }
+    for (Level& level : levels_) {
+        if (level.priority == priority) {
+            return &level;
+        }
+    }
+    return nullptr;
+}
+
+void PriorityPoller::on_assignment(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& assigned : topic_partitions) {
+        TopicPartition topic_partition(assigned.get_topic(), assigned.get_partition());
+        Level* level = find_level(topic_partition);
+        if (!level || !level->queue) {
+            continue;
+        }
+        auto iter = forwarded_partitions_.find(topic_partition);
+        if (iter != forwarded_partitions_.end() && iter->second == level->priority) {
+            continue;
+        }
+        consumer_.get_partition_queue(topic_partition).forward_to_queue(level->queue);
+        forwarded_partitions_[topic_partition] = level->priority;
+    }
+}
+
+void PriorityPoller::on_revocation(const TopicPartitionList& topic_partitions) {
+    for (const TopicPartition& revoked : topic_partitions) {
+        auto iter = forwarded_partitions_.find({ revoked.get_topic(), revoked.get_partition() });
+        if (iter != forwarded_partitions_.end()) {
+            consumer_.get_partition_queue(iter->first).forward_to_queue(consumer_queue_);
+            forwarded_partitions_.erase(iter);
+        }
+    }
+}
+
+Message PriorityPoller::consume(const Level& level, milliseconds timeout) {
+    // The consumer queue is polled through the consumer so rebalances are handled
+    return level.queue ? level.queue.consume(timeout) : consumer_.poll(timeout);
+}
+
+Message PriorityPoller::poll_strict() {
+    for (const Level& level : levels_) {
+        Message msg = consume(level, milliseconds(0));
+        if (msg) {
+            return msg;
+        }
+    }
+    return Message();
+}
+
+Message PriorityPoller::poll_weighted() {
+    // Visit every level once, plus the current one again in case it ran out of credits
+    for (size_t i = 0; i <= levels_.size(); ++i) {
+        if (current_credits_ > 0) {
+            Message msg = consume(levels_[current_level_], milliseconds(0));
+            if (msg) {
+                current_credits_--;
+                return msg;
+            }
+        }
+        current_level_ = (current_level_ + 1) % levels_.size();
+        current_credits_ = levels_[current_level_].weight;
+    }
+    return Message();
+}
+
+} // cppkafka
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "utils/record_envelope.h"
+#include "exceptions.h"
+
+namespace cppkafka {
+
+// EnvelopeBuilder
+
+const uint8_t EnvelopeBuilder::ENVELOPE_MARKER = 0xEB;
+
+size_t EnvelopeBuilder::get_record_size(size_t record_size) {
+    size_t output = 1;
+    for (size_t value = record_size; value >= 0x80; value >>= 7) {
+        output++;
+    }
+    return output + record_size;
+}
+
+void EnvelopeBuilder::add_record(const Buffer& record) {
+    if (data_.empty()) {
+        data_.push_back(ENVELOPE_MARKER);
+    }
+    size_t size = record.get_size();
+    while (size >= 0x80) {
+        data_.push_back(static_cast<uint8_t>(size | 0x80));
+        size >>= 7;
+    }
+    data_.push_back(static_cast<uint8_t>(size));
+    data_.insert(data_.end(), record.begin(), record.end());
+    record_count_++;
+}
+
+void EnvelopeBuilder::reserve(size_t size) {
+    data_.reserve(size);
+}
+
+void EnvelopeBuilder::clear() {
+    data_.clear();
+    record_count_ = 0;
+}
+
+size_t EnvelopeBuilder::get_size() const {
+    return data_.size();
+}
+
+size_t EnvelopeBuilder::get_record_count() const {
+    return record_count_;
+}
+
+bool EnvelopeBuilder::empty() const {
+    return record_count_ == 0;
+}
+
+Buffer EnvelopeBuilder::get_buffer() const {
+    return Buffer(data_.data(), data_.size());
+}
+
+// EnvelopeReader::Iterator
+
+EnvelopeReader::Iterator::Iterator(const uint8_t* position, const uint8_t* end)
+: position_(position), next_(position), end_(end) {
+    read_record();
+}
+
+Buffer EnvelopeReader::Iterator::operator*() const {
+    return Buffer(record_data_, record_size_);
+}
+
+EnvelopeReader::Iterator& EnvelopeReader::Iterator::operator++() {
+    position_ = next_;
+    read_record();
+    return *this;
+}
+
+bool EnvelopeReader::Iterator::operator==(const Iterator& rhs) const {
+    return position_ == rhs.position_;
+}
+
+bool EnvelopeReader::Iterator::operator!=(const Iterator& rhs) const {
+    return !(*this == rhs);
+}
+
+void EnvelopeReader::Iterator::read_record() {
+    if (position_ == end_) {
+        return;
+    }
+    const uint8_t* ptr = position_;
+    uint64_t size = 0;
+    unsigned shift = 0;
+    while (true) {
+        if (ptr == end_ || shift > 63) {
+            throw Exception("Malformed record envelope");
+        }
+        const uint8_t byte = *ptr++;
+        size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+        shift += 7;
+    }
+    if (size > static_cast<uint64_t>(end_ - ptr)) {
+        throw Exception("Malformed record envelope");
+    }
+    record_data_ = ptr;
+    record_size_ = static_cast<size_t>(size);
+    next_ = ptr + size;
+}
+
+// EnvelopeReader
+
+bool EnvelopeReader::is_envelope(const Buffer& payload) {
+    return payload.get_size() > 0 && payload.get_data()[0] == EnvelopeBuilder::ENVELOPE_MARKER;
+}
+
+EnvelopeReader::EnvelopeReader(const Buffer& payload)
+: begin_(payload.get_data()), end_(payload.get_data() + payload.get_size()) {
+    if (!is_envelope(payload)) {
+        throw Exception("Payload is not a record envelope");
+    }
+    // Skip the marker
+    begin_++;
+}
+
+EnvelopeReader::Iterator EnvelopeReader::begin() const {
+    return Iterator(begin_, end_);
+}
+
+EnvelopeReader::Iterator EnvelopeReader::end() const {
+    return Iterator(end_, end_);
+}
+
+} // cppkafka
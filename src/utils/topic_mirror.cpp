@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "utils/topic_mirror.h"
+#include "exceptions.h"
+
+using std::move;
+using std::string;
+
+using std::chrono::milliseconds;
+
+namespace cppkafka {
+
+TopicMirror::PendingMessage::PendingMessage(Message msg, PartitionState& state)
+: message(move(msg)), owner(&state), delivered(false) {
+
+}
+
+TopicMirror::TopicMirror(Consumer& consumer, Configuration config)
+: consumer_(consumer), producer_(prepare_configuration(move(config))) {
+    producer_.set_payload_policy(Producer::PayloadPolicy::PASSTHROUGH_PAYLOAD);
+}
+
+void TopicMirror::mirror(Message message) {
+    TopicPartition topic_partition(message.get_topic(), message.get_partition());
+    PartitionState& state = partitions_[topic_partition];
+    // The entry has to be queued before producing, as it's the message's user data
+    state.messages.emplace_back(move(message), state);
+    pending_count_++;
+    try {
+        produce_message(state.messages.back());
+    }
+    catch (...) {
+        // It was never produced so no delivery report will ever release it
+        state.messages.pop_back();
+        pending_count_--;
+        throw;
+    }
+}
+
+int TopicMirror::poll() {
+    return producer_.poll(milliseconds(0));
+}
+
+void TopicMirror::commit() {
+    TopicPartitionList topic_partitions;
+    for (auto& partition_pair : partitions_) {
+        PartitionState& state = partition_pair.second;
+        if (state.needs_commit) {
+            const TopicPartition& topic_partition = partition_pair.first;
+            topic_partitions.emplace_back(topic_partition.get_topic(),
+                                          topic_partition.get_partition(),
+                                          state.next_offset);
+            state.needs_commit = false;
+        }
+    }
+    if (!topic_partitions.empty()) {
+        consumer_.async_commit(topic_partitions);
+    }
+}
+
+void TopicMirror::flush() {
+    while (pending_count_ > 0) {
+        try {
+            producer_.flush();
+        }
+        catch (const HandleException& ex) {
+            // If we just hit the timeout, keep going, otherwise re-throw
+            if (ex.get_error() != RD_KAFKA_RESP_ERR__TIMED_OUT) {
+                throw;
+            }
+        }
+    }
+    commit();
+}
+
+size_t TopicMirror::get_pending_count() const {
+    return pending_count_;
+}
+
+void TopicMirror::set_topic_mapper(TopicMapper callback) {
+    topic_mapper_ = move(callback);
+}
+
+void TopicMirror::set_preserve_partitions(bool value) {
+    preserve_partitions_ = value;
+}
+
+void TopicMirror::set_produce_failure_callback(ProduceFailureCallback callback) {
+    produce_failure_callback_ = move(callback);
+}
+
+Producer& TopicMirror::get_producer() {
+    return producer_;
+}
+
+const Producer& TopicMirror::get_producer() const {
+    return producer_;
+}
+
+Configuration TopicMirror::prepare_configuration(Configuration config) {
+    using std::placeholders::_2;
+    auto callback = std::bind(&TopicMirror::on_delivery_report, this, _2);
+    config.set_delivery_report_callback(move(callback));
+    return config;
+}
+
+void TopicMirror::produce_message(PendingMessage& pending) {
+    const Message& message = pending.message;
+    const Buffer& key = message.get_key();
+    const Buffer& payload = message.get_payload();
+    MessageBuilder builder(topic_mapper_ ? topic_mapper_(message) : message.get_topic());
+    // These are only views over the consumed message's buffers
+    builder.key(Buffer(key.get_data(), key.get_size()))
+           .payload(Buffer(payload.get_data(), payload.get_size()))
+           .user_data(&pending);
+    if (preserve_partitions_) {
+        builder.partition(message.get_partition());
+    }
+    if (message.get_timestamp()) {
+        builder.timestamp(message.get_timestamp()->get_timestamp());
+    }
+    bool sent = false;
+    while (!sent) {
+        try {
+            producer_.produce(builder);
+            sent = true;
+        }
+        catch (const HandleException& ex) {
+            // If the output queue is full, then just poll
+            if (ex.get_error() == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
+                producer_.poll();
+            }
+            else {
+                throw;
+            }
+        }
+    }
+}
+
+void TopicMirror::on_delivery_report(const Message& message) {
+    PendingMessage& pending = *static_cast<PendingMessage*>(message.get_private_data());
+    // Re-send it if it failed and we either don't have a callback or it says we should.
+    // The source message is still alive so the payload is still valid
+    bool should_produce = message.get_error() &&
+                          (!produce_failure_callback_ || produce_failure_callback_(message));
+    if (should_produce) {
+        produce_message(pending);
+        return;
+    }
+    pending.delivered = true;
+    pending_count_--;
+
+    // Release every delivered message at the front of this partition's queue and move the
+    // committable offset forward
+    PartitionState& state = *pending.owner;
+    while (!state.messages.empty() && state.messages.front().delivered) {
+        state.next_offset = state.messages.front().message.get_offset() + 1;
+        state.needs_commit = true;
+        state.messages.pop_front();
+    }
+}
+
+} // cppkafka
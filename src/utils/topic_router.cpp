@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <limits>
+#include "utils/topic_router.h"
+#include "topic.h"
+#include "exceptions.h"
+
+using std::move;
+using std::string;
+using std::numeric_limits;
+
+namespace cppkafka {
+
+const size_t TopicRouter::DEFAULT_ROUTE = numeric_limits<size_t>::max();
+
+TopicRouter::TopicRouter(Consumer& consumer)
+: consumer_(consumer) {
+
+}
+
+TopicRouter& TopicRouter::add_route(const string& topic, Handler handler) {
+    rd_kafka_topic_t* handle = get_topic_handle(topic);
+    auto iter = routes_.find(handle);
+    if (iter != routes_.end() && iter->second != DEFAULT_ROUTE) {
+        handlers_[iter->second] = move(handler);
+    }
+    else {
+        routes_[handle] = handlers_.size();
+        topics_.push_back(topic);
+        handlers_.push_back(move(handler));
+    }
+    return *this;
+}
+
+TopicRouter& TopicRouter::set_default_route(Handler handler) {
+    default_handler_ = move(handler);
+    return *this;
+}
+
+size_t TopicRouter::get_route_count() const {
+    return handlers_.size();
+}
+
+void TopicRouter::operator()(Message message) const {
+    const size_t route = get_route(message);
+    if (route != DEFAULT_ROUTE) {
+        handlers_[route](move(message));
+    }
+    else if (default_handler_) {
+        default_handler_(move(message));
+    }
+    else {
+        throw ElementNotFound("route", message.get_topic());
+    }
+}
+
+size_t TopicRouter::get_route(const Message& message) const {
+    rd_kafka_topic_t* handle = message.get_handle()->rkt;
+    auto iter = routes_.find(handle);
+    if (iter != routes_.end()) {
+        return iter->second;
+    }
+    // Only cache it if the consumer keeps this handle alive, otherwise its address could
+    // be reused by another topic later on
+    const string topic = message.get_topic();
+    if (get_topic_handle(topic) != handle) {
+        for (size_t i = 0; i < topics_.size(); ++i) {
+            if (topics_[i] == topic) {
+                return i;
+            }
+        }
+        return DEFAULT_ROUTE;
+    }
+    routes_.emplace(handle, DEFAULT_ROUTE);
+    return DEFAULT_ROUTE;
+}
+
+rd_kafka_topic_t* TopicRouter::get_topic_handle(const string& topic) const {
+    // The consumer owns the handles it hands out, so they're valid for as long as it lives
+    return consumer_.get_topic(topic).get_handle();
+}
+
+} // cppkafka
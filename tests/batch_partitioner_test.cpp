@@ -0,0 +1,104 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/batch_partitioner.h"
+#include "cppkafka/exceptions.h"
+
+using std::string;
+using std::vector;
+
+using namespace cppkafka;
+
+class BatchPartitionerTest : public testing::Test {
+public:
+
+};
+
+TEST_F(BatchPartitionerTest, Hashes) {
+    // Taken from the java client's murmur2 tests
+    EXPECT_EQ(-973932308, static_cast<int32_t>(BatchPartitioner::murmur2("21", 2)));
+    EXPECT_EQ(-790332482, static_cast<int32_t>(BatchPartitioner::murmur2("foobar", 6)));
+    const string long_key = "a-little-bit-long-string";
+    EXPECT_EQ(-985981536,
+              static_cast<int32_t>(BatchPartitioner::murmur2(long_key.data(), long_key.size())));
+    const string longer_key = "a-little-bit-longer-string";
+    EXPECT_EQ(-1486304829,
+              static_cast<int32_t>(BatchPartitioner::murmur2(longer_key.data(),
+                                                             longer_key.size())));
+    EXPECT_EQ(479470107, static_cast<int32_t>(BatchPartitioner::murmur2("abc", 3)));
+
+    EXPECT_EQ(1539077399, BatchPartitioner::crc32("kafka", 5));
+    EXPECT_EQ(0, BatchPartitioner::crc32(nullptr, 0));
+    EXPECT_EQ(0xd33c4e1, BatchPartitioner::fnv1a("kafka", 5));
+}
+
+TEST_F(BatchPartitionerTest, BatchMatchesSingleKeys) {
+    vector<string> keys_data;
+    for (size_t i = 0; i < 37; ++i) {
+        keys_data.push_back(string(i, 'a' + i % 26) + std::to_string(i * 7919));
+    }
+    vector<Buffer> keys;
+    for (const string& key : keys_data) {
+        keys.emplace_back(key);
+    }
+    for (auto algorithm : { BatchPartitioner::Algorithm::CONSISTENT,
+                            BatchPartitioner::Algorithm::MURMUR2,
+                            BatchPartitioner::Algorithm::FNV1A }) {
+        BatchPartitioner partitioner(algorithm);
+        vector<int32_t> partitions = partitioner.partition(keys, 7);
+        ASSERT_EQ(keys.size(), partitions.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            EXPECT_EQ(partitioner.partition(keys[i], 7), partitions[i]);
+            EXPECT_GE(partitions[i], 0);
+            EXPECT_LT(partitions[i], 7);
+        }
+    }
+    BatchPartitioner partitioner(BatchPartitioner::Algorithm::MURMUR2);
+    const string key = "foobar";
+    EXPECT_EQ(static_cast<int32_t>((-790332482 & 0x7fffffff) % 5),
+              partitioner.partition(Buffer(key), 5));
+}
+
+TEST_F(BatchPartitionerTest, Fnv1aNegativeHashes) {
+    // These keys hash to negative signed values: rdkafka uses the absolute value of the hash,
+    // so simply masking out the sign bit would pick a different partition
+    BatchPartitioner partitioner(BatchPartitioner::Algorithm::FNV1A);
+    const vector<string> keys_data = { "foobar", "a", "b", "kafka" };
+    vector<Buffer> keys;
+    for (const string& key : keys_data) {
+        keys.emplace_back(key);
+    }
+    EXPECT_EQ(vector<int32_t>({ 4, 6, 5, 4 }), partitioner.partition(keys, 7));
+    EXPECT_EQ(vector<int32_t>({ 6, 6, 9, 5 }), partitioner.partition(keys, 10));
+    // The empty key is hashed as well, and its hash is negative too
+    const string empty;
+    EXPECT_EQ(2, partitioner.partition(Buffer(empty), 7));
+}
+
+TEST_F(BatchPartitionerTest, KeylessMessages) {
+    const string key = "kafka";
+    vector<Buffer> keys;
+    keys.emplace_back();
+    keys.emplace_back(key);
+    keys.emplace_back(key.data(), 0);
+
+    BatchPartitioner partitioner(BatchPartitioner::Algorithm::MURMUR2_RANDOM);
+    vector<int32_t> partitions = partitioner.partition(keys, 3);
+    EXPECT_EQ(RD_KAFKA_PARTITION_UA, partitions[0]);
+    EXPECT_NE(RD_KAFKA_PARTITION_UA, partitions[1]);
+    EXPECT_NE(RD_KAFKA_PARTITION_UA, partitions[2]);
+
+    // The consistent one uses random partitions for empty keys as well
+    partitions = BatchPartitioner(BatchPartitioner::Algorithm::CONSISTENT_RANDOM)
+        .partition(keys, 3);
+    EXPECT_EQ(RD_KAFKA_PARTITION_UA, partitions[0]);
+    EXPECT_EQ(2, partitions[1]);
+    EXPECT_EQ(RD_KAFKA_PARTITION_UA, partitions[2]);
+
+    partitions = BatchPartitioner(BatchPartitioner::Algorithm::MURMUR2).partition(keys, 3);
+    EXPECT_NE(RD_KAFKA_PARTITION_UA, partitions[0]);
+
+    EXPECT_THROW(BatchPartitioner::get_algorithm("random"), Exception);
+    EXPECT_TRUE(BatchPartitioner::Algorithm::FNV1A_RANDOM ==
+                BatchPartitioner::get_algorithm("fnv1a_random"));
+}
@@ -0,0 +1,249 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <gtest/gtest.h>
+#include "cppkafka/producer.h"
+#include "cppkafka/consumer.h"
+#include "cppkafka/utils/chunked_producer.h"
+#include "cppkafka/utils/chunk_reassembler.h"
+#include "cppkafka/detail/chunk_header.h"
+#include "test_utils.h"
+
+using std::string;
+using std::vector;
+using std::move;
+using std::this_thread::sleep_for;
+
+using std::chrono::milliseconds;
+
+using namespace cppkafka;
+using cppkafka::detail::ChunkHeader;
+
+class ChunkReassemblerTest : public testing::Test {
+public:
+    static const string KAFKA_TOPIC;
+
+    // A chunk living in memory, so we can feed the reassembler without a broker
+    struct FakeChunk {
+        FakeChunk(const Topic& topic, int partition, int64_t offset, const ChunkHeader& header,
+                  const string& data)
+        : buffer(ChunkHeader::SIZE + data.size()) {
+            header.encode(buffer.data());
+            copy(data.begin(), data.end(), buffer.begin() + ChunkHeader::SIZE);
+            handle = rd_kafka_message_t();
+            handle.rkt = topic.get_handle();
+            handle.partition = partition;
+            handle.offset = offset;
+            handle.payload = buffer.data();
+            handle.len = buffer.size();
+        }
+
+        Message get_message() {
+            return Message::make_non_owning(&handle);
+        }
+
+        vector<uint8_t> buffer;
+        rd_kafka_message_t handle;
+    };
+
+    Configuration make_producer_config() {
+        Configuration config = {
+            { "metadata.broker.list", KAFKA_TEST_INSTANCE },
+            { "queue.buffering.max.ms", 0 },
+            { "max.in.flight.requests.per.connection", 1 }
+        };
+        return config;
+    }
+
+    Configuration make_consumer_config() {
+        Configuration config = {
+            { "metadata.broker.list", KAFKA_TEST_INSTANCE },
+            { "enable.auto.commit", false },
+            { "group.id", "chunk_reassembler_test" }
+        };
+        return config;
+    }
+
+    ChunkHeader make_header(uint64_t group_id, uint32_t index, uint32_t count,
+                            uint64_t total_size, uint64_t data_offset) {
+        ChunkHeader header;
+        header.group_id = group_id;
+        header.index = index;
+        header.count = count;
+        header.total_size = total_size;
+        header.data_offset = data_offset;
+        return header;
+    }
+};
+
+const string ChunkReassemblerTest::KAFKA_TOPIC = "cppkafka_test1";
+
+TEST_F(ChunkReassemblerTest, OutOfOrderAndInterleavedChunks) {
+    Producer producer(make_producer_config());
+    Topic topic = producer.get_topic(KAFKA_TOPIC);
+
+    vector<string> payloads;
+    ChunkReassembler reassembler([&](ReassembledMessage msg) {
+        const Buffer& payload = msg.get_payload();
+        payloads.emplace_back(payload.begin(), payload.end());
+    });
+
+    FakeChunk chunk1(topic, 0, 10, make_header(1, 0, 3, 9, 0), "foo");
+    FakeChunk chunk2(topic, 0, 11, make_header(2, 0, 2, 6, 0), "hel");
+    FakeChunk chunk3(topic, 0, 12, make_header(1, 2, 3, 9, 6), "baz");
+    FakeChunk chunk4(topic, 0, 13, make_header(1, 1, 3, 9, 3), "bar");
+    FakeChunk chunk5(topic, 0, 14, make_header(2, 1, 2, 6, 3), "lo!");
+
+    reassembler.add(chunk1.get_message());
+    reassembler.add(chunk2.get_message());
+    reassembler.add(chunk3.get_message());
+    // Duplicates are ignored
+    reassembler.add(chunk3.get_message());
+    EXPECT_EQ(2, reassembler.get_pending_count());
+    EXPECT_EQ(15, reassembler.get_buffered_bytes());
+    EXPECT_TRUE(payloads.empty());
+
+    reassembler.add(chunk4.get_message());
+    ASSERT_EQ(1, payloads.size());
+    EXPECT_EQ("foobarbaz", payloads[0]);
+
+    reassembler.add(chunk5.get_message());
+    ASSERT_EQ(2, payloads.size());
+    EXPECT_EQ("hello!", payloads[1]);
+    EXPECT_EQ(0, reassembler.get_pending_count());
+    EXPECT_EQ(0, reassembler.get_buffered_bytes());
+}
+
+TEST_F(ChunkReassemblerTest, ExpiredChunks) {
+    Producer producer(make_producer_config());
+    Topic topic = producer.get_topic(KAFKA_TOPIC);
+
+    size_t reassembled = 0;
+    vector<TopicPartition> expired;
+    ChunkReassembler reassembler([&](ReassembledMessage) {
+        reassembled++;
+    });
+    reassembler.set_timeout(milliseconds(10));
+    reassembler.set_expiration_callback([&](const TopicPartition& topic_partition) {
+        expired.push_back(topic_partition);
+    });
+
+    FakeChunk chunk1(topic, 1, 5, make_header(1, 0, 2, 6, 0), "foo");
+    FakeChunk chunk2(topic, 1, 6, make_header(1, 1, 2, 6, 3), "bar");
+    reassembler.add(chunk1.get_message());
+    sleep_for(milliseconds(20));
+    reassembler.evict_expired();
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(TopicPartition(KAFKA_TOPIC, 1), expired[0]);
+    EXPECT_EQ(5, expired[0].get_offset());
+
+    // The second chunk alone starts a new incomplete message
+    reassembler.add(chunk2.get_message());
+    EXPECT_EQ(0, reassembled);
+    EXPECT_EQ(1, reassembler.get_pending_count());
+}
+
+TEST_F(ChunkReassemblerTest, InvalidChunks) {
+    Producer producer(make_producer_config());
+    Topic topic = producer.get_topic(KAFKA_TOPIC);
+
+    size_t invalid = 0;
+    ChunkReassembler reassembler([&](ReassembledMessage) { });
+    FakeChunk chunk(topic, 0, 1, make_header(1, 0, 1, 10, 0), "too short");
+    EXPECT_THROW(reassembler.add(chunk.get_message()), Exception);
+
+    reassembler.set_invalid_message_callback([&](const Message&) {
+        invalid++;
+    });
+    reassembler.add(chunk.get_message());
+    EXPECT_EQ(1, invalid);
+}
+
+TEST_F(ChunkReassemblerTest, ChunksMustCoverTheWholeMessage) {
+    Producer producer(make_producer_config());
+    Topic topic = producer.get_topic(KAFKA_TOPIC);
+
+    size_t reassembled = 0;
+    size_t invalid = 0;
+    ChunkReassembler reassembler([&](ReassembledMessage) {
+        reassembled++;
+    });
+    reassembler.set_invalid_message_callback([&](const Message&) {
+        invalid++;
+    });
+
+    // Two tiny chunks claiming to make up a 1MB message
+    FakeChunk short_first(topic, 0, 1, make_header(1, 0, 2, 1024 * 1024, 0), "0123456789");
+    FakeChunk short_last(topic, 0, 2, make_header(1, 1, 2, 1024 * 1024, 10), "0123456789");
+    reassembler.add(short_first.get_message());
+    reassembler.add(short_last.get_message());
+    EXPECT_EQ(2, invalid);
+
+    // A chunk whose offset doesn't match its index
+    FakeChunk first(topic, 0, 3, make_header(2, 0, 3, 9, 0), "foo");
+    FakeChunk misplaced(topic, 0, 4, make_header(2, 1, 3, 9, 2), "bar");
+    reassembler.add(first.get_message());
+    reassembler.add(misplaced.get_message());
+    EXPECT_EQ(3, invalid);
+
+    // Chunks with a different size than the rest would overlap them
+    FakeChunk overlapping(topic, 0, 5, make_header(3, 1, 3, 12, 4), "barb");
+    FakeChunk other_first(topic, 0, 6, make_header(3, 0, 3, 12, 0), "foo");
+    reassembler.add(overlapping.get_message());
+    reassembler.add(other_first.get_message());
+    EXPECT_EQ(4, invalid);
+
+    // The first chunk of a message can't start past its beginning
+    FakeChunk shifted(topic, 0, 7, make_header(4, 0, 2, 6, 3), "foo");
+    reassembler.add(shifted.get_message());
+    EXPECT_EQ(5, invalid);
+
+    // The chunk count must match the total size and the chunk size, otherwise a corrupt
+    // count would make it track billions of chunks for a tiny message
+    FakeChunk huge_count(topic, 0, 8, make_header(5, 0, 0xffffffff, 6, 0), "foo");
+    FakeChunk few_chunks(topic, 0, 9, make_header(6, 0, 2, 9, 0), "foo");
+    reassembler.add(huge_count.get_message());
+    reassembler.add(few_chunks.get_message());
+    EXPECT_EQ(7, invalid);
+    EXPECT_EQ(0, reassembled);
+}
+
+TEST_F(ChunkReassemblerTest, ProduceAndReassemble) {
+    int partition = 0;
+
+    Consumer consumer(make_consumer_config());
+    consumer.assign({ TopicPartition(KAFKA_TOPIC, partition) });
+    ConsumerRunner runner(consumer, 5, 1);
+
+    Producer producer(make_producer_config());
+    ChunkedProducer chunked_producer(producer);
+    chunked_producer.set_chunk_size(10);
+    string key = "some_key";
+    string payload(45, 'x');
+    payload[0] = 'a';
+    payload[44] = 'z';
+    chunked_producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).key(key)
+                                                        .payload(payload));
+    runner.try_join();
+
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(5, messages.size());
+
+    vector<string> payloads;
+    ChunkReassembler reassembler([&](ReassembledMessage msg) {
+        EXPECT_EQ(KAFKA_TOPIC, msg.get_topic());
+        EXPECT_EQ(partition, msg.get_partition());
+        EXPECT_EQ(Buffer(key), msg.get_key());
+        EXPECT_EQ(messages[0].get_offset(), msg.get_offset());
+        EXPECT_EQ(messages[4].get_offset(), msg.get_last_offset());
+        const Buffer& payload = msg.get_payload();
+        payloads.emplace_back(payload.begin(), payload.end());
+    });
+    for (const auto& message : messages) {
+        EXPECT_EQ(Buffer(key), message.get_key());
+        reassembler.add(Message::make_non_owning(message.get_handle()));
+    }
+    ASSERT_EQ(1, payloads.size());
+    EXPECT_EQ(payload, payloads[0]);
+}
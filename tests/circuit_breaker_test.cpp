@@ -0,0 +1,111 @@
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/circuit_breaker.h"
+
+using std::vector;
+using std::this_thread::sleep_for;
+
+using std::chrono::milliseconds;
+
+using namespace cppkafka;
+
+using State = CircuitBreaker::State;
+
+class CircuitBreakerTest : public testing::Test {
+public:
+    CircuitBreakerTest() {
+        breaker.set_minimum_requests(4);
+        breaker.set_failure_ratio(0.5);
+        breaker.set_open_timeout(milliseconds(50));
+        breaker.set_probe_count(2);
+    }
+
+    void trip() {
+        for (int i = 0; i < 4; ++i) {
+            breaker.record_failure();
+        }
+    }
+
+    CircuitBreaker breaker;
+};
+
+TEST_F(CircuitBreakerTest, TripsOnFailureRatio) {
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+    // Not enough requests yet
+    breaker.record_failure();
+    breaker.record_failure();
+    breaker.record_failure();
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+    EXPECT_TRUE(breaker.allow());
+
+    breaker.record_failure();
+    EXPECT_EQ(State::OPEN, breaker.get_state());
+    EXPECT_FALSE(breaker.allow());
+    EXPECT_EQ(1, breaker.get_trip_count());
+}
+
+TEST_F(CircuitBreakerTest, SuccessesKeepItClosed) {
+    for (int i = 0; i < 10; ++i) {
+        breaker.record_success();
+    }
+    for (int i = 0; i < 9; ++i) {
+        breaker.record_failure();
+    }
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+    breaker.record_failure();
+    EXPECT_EQ(State::OPEN, breaker.get_state());
+}
+
+TEST_F(CircuitBreakerTest, ShedsByPriority) {
+    breaker.set_open_priority(5);
+    trip();
+    EXPECT_FALSE(breaker.allow());
+    EXPECT_FALSE(breaker.allow(4));
+    EXPECT_TRUE(breaker.allow(5));
+    EXPECT_TRUE(breaker.allow(10));
+}
+
+TEST_F(CircuitBreakerTest, ProbesAndCloses) {
+    vector<State> states;
+    breaker.set_state_change_callback([&](State state) {
+        states.push_back(state);
+    });
+    trip();
+    sleep_for(milliseconds(60));
+
+    // Only as many probes as configured go through
+    EXPECT_TRUE(breaker.allow());
+    EXPECT_EQ(State::HALF_OPEN, breaker.get_state());
+    EXPECT_TRUE(breaker.allow());
+    EXPECT_FALSE(breaker.allow());
+
+    breaker.record_success();
+    EXPECT_EQ(State::HALF_OPEN, breaker.get_state());
+    breaker.record_success();
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+    EXPECT_TRUE(breaker.allow());
+
+    EXPECT_EQ(vector<State>({ State::OPEN, State::HALF_OPEN, State::CLOSED }), states);
+}
+
+TEST_F(CircuitBreakerTest, FailedProbeReopens) {
+    trip();
+    sleep_for(milliseconds(60));
+    EXPECT_TRUE(breaker.allow());
+    breaker.record_failure();
+    EXPECT_EQ(State::OPEN, breaker.get_state());
+    EXPECT_FALSE(breaker.allow());
+    EXPECT_EQ(2, breaker.get_trip_count());
+}
+
+TEST_F(CircuitBreakerTest, Reset) {
+    trip();
+    breaker.reset();
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+    EXPECT_TRUE(breaker.allow());
+    // Previous failures are gone
+    breaker.record_failure();
+    EXPECT_EQ(State::CLOSED, breaker.get_state());
+}
@@ -0,0 +1,156 @@
+#include <string>
+#include <vector>
+#include <chrono>
+#include <gtest/gtest.h>
+#include "cppkafka/consumer.h"
+#include "cppkafka/utils/commit_coordinator.h"
+
+using std::string;
+using std::vector;
+
+using std::chrono::seconds;
+using std::chrono::milliseconds;
+
+using namespace cppkafka;
+
+class CommitCoordinatorTest : public testing::Test {
+public:
+    static const string KAFKA_TOPIC;
+
+    Configuration make_consumer_config() {
+        Configuration config = {
+            { "metadata.broker.list", KAFKA_TEST_INSTANCE },
+            { "enable.auto.commit", false },
+            { "group.id", "commit_coordinator_test" }
+        };
+        return config;
+    }
+};
+
+const string CommitCoordinatorTest::KAFKA_TOPIC = "cppkafka_test1";
+
+TEST_F(CommitCoordinatorTest, OffsetsMoveForwardInOrder) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    void* token1 = coordinator.track({ KAFKA_TOPIC, 0, 10 });
+    void* token2 = coordinator.track({ KAFKA_TOPIC, 0, 11 });
+    void* token3 = coordinator.track({ KAFKA_TOPIC, 0, 12 });
+    EXPECT_EQ(3, coordinator.get_pending_count());
+
+    // Acknowledging out of order doesn't move the watermark
+    coordinator.acknowledge(token2);
+    EXPECT_TRUE(coordinator.get_committable_offsets().empty());
+
+    coordinator.acknowledge(token1);
+    TopicPartitionList offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(TopicPartition(KAFKA_TOPIC, 0), offsets[0]);
+    EXPECT_EQ(12, offsets[0].get_offset());
+
+    coordinator.acknowledge(token3);
+    offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(13, offsets[0].get_offset());
+    EXPECT_EQ(0, coordinator.get_pending_count());
+}
+
+TEST_F(CommitCoordinatorTest, MultipleAcknowledgements) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    void* token = coordinator.track({ KAFKA_TOPIC, 1, 5 }, 2);
+    coordinator.acknowledge(token);
+    EXPECT_TRUE(coordinator.get_committable_offsets().empty());
+    coordinator.acknowledge(token);
+    TopicPartitionList offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(6, offsets[0].get_offset());
+}
+
+TEST_F(CommitCoordinatorTest, MessagesWithoutAcknowledgements) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    void* token = coordinator.track({ KAFKA_TOPIC, 0, 20 });
+    // This one doesn't depend on any produced message but has to wait for the previous one
+    EXPECT_EQ(nullptr, coordinator.track({ KAFKA_TOPIC, 0, 21 }, 0));
+    EXPECT_TRUE(coordinator.get_committable_offsets().empty());
+
+    coordinator.acknowledge(token);
+    TopicPartitionList offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(22, offsets[0].get_offset());
+}
+
+TEST_F(CommitCoordinatorTest, Release) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    void* token1 = coordinator.track({ KAFKA_TOPIC, 0, 40 });
+    void* token2 = coordinator.track({ KAFKA_TOPIC, 0, 41 }, 2);
+    coordinator.acknowledge(token2);
+
+    // The first message's output was dropped, it must not hold back the rest
+    coordinator.release(token1);
+    TopicPartitionList offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(41, offsets[0].get_offset());
+
+    // Releasing one of several expected acknowledgements counts as one of them
+    coordinator.release(token2);
+    offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(42, offsets[0].get_offset());
+    EXPECT_EQ(0, coordinator.get_pending_count());
+    EXPECT_EQ(2, coordinator.get_released_count());
+}
+
+TEST_F(CommitCoordinatorTest, Discard) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    void* token1 = coordinator.track({ KAFKA_TOPIC, 0, 1 });
+    void* token2 = coordinator.track({ KAFKA_TOPIC, 1, 1 });
+    coordinator.discard({ { KAFKA_TOPIC, 0 } });
+    EXPECT_EQ(1, coordinator.get_pending_count());
+
+    // Acknowledging a discarded token is fine but has no effect
+    coordinator.acknowledge(token1);
+    coordinator.acknowledge(token2);
+    TopicPartitionList offsets = coordinator.get_committable_offsets();
+    ASSERT_EQ(1, offsets.size());
+    EXPECT_EQ(TopicPartition(KAFKA_TOPIC, 1), offsets[0]);
+    EXPECT_EQ(0, coordinator.get_pending_count());
+}
+
+TEST_F(CommitCoordinatorTest, Drain) {
+    Consumer consumer(make_consumer_config());
+    CommitCoordinator coordinator(consumer);
+
+    vector<void*> tokens = {
+        coordinator.track({ KAFKA_TOPIC, 0, 30 }),
+        coordinator.track({ KAFKA_TOPIC, 0, 31 })
+    };
+    coordinator.track({ KAFKA_TOPIC, 1, 30 });
+    EXPECT_EQ(2, coordinator.get_pending_count({ { KAFKA_TOPIC, 0 } }));
+
+    // Acknowledge one token every time the callback is executed
+    size_t callback_count = 0;
+    EXPECT_TRUE(coordinator.drain({ { KAFKA_TOPIC, 0 } }, seconds(10), [&]() {
+        coordinator.acknowledge(tokens[callback_count++]);
+    }));
+    EXPECT_EQ(2, callback_count);
+    EXPECT_EQ(0, coordinator.get_pending_count({ { KAFKA_TOPIC, 0 } }));
+    EXPECT_EQ(1, coordinator.get_pending_count());
+
+    // The drained partition was committed and released
+    TopicPartitionList committed = consumer.get_offsets_committed({ { KAFKA_TOPIC, 0 } });
+    ASSERT_EQ(1, committed.size());
+    EXPECT_EQ(32, committed[0].get_offset());
+    EXPECT_TRUE(coordinator.get_committable_offsets().empty());
+
+    // Nothing acknowledges the other partition's message, so this one times out
+    EXPECT_FALSE(coordinator.drain({ { KAFKA_TOPIC, 1 } }, milliseconds(50), []() { }));
+    EXPECT_EQ(0, coordinator.get_pending_count());
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "cppkafka/configuration.h"
 #include "cppkafka/exceptions.h"
+#include "cppkafka/producer.h"
+#include "cppkafka/topic.h"
 
 using namespace cppkafka;
 
@@ -89,3 +91,43 @@ TEST_F(ConfigurationTest, TopicGetAll) {
     auto option_map = config.get_all();
     EXPECT_EQ("false", option_map.at("auto.commit.enable"));
 }
+
+TEST_F(ConfigurationTest, PartitionerCache) {
+    int calls = 0;
+    TopicConfiguration config;
+    config.set_partitioner_callback([&](const Topic&, const Buffer& key, int32_t count) {
+        calls++;
+        return static_cast<int32_t>(key.get_size() % count);
+    });
+    config.set_partitioner_cache_size(16);
+    EXPECT_EQ(16, config.get_partitioner_cache_size());
+
+    Producer producer(Configuration{});
+    Topic topic = producer.get_topic("foo");
+    auto partition = [&](const string& key, int32_t count) {
+        return partitioner_callback_proxy(topic.get_handle(), key.data(), key.size(), count,
+                                          &config, nullptr);
+    };
+    EXPECT_EQ(2, partition("hello", 3));
+    EXPECT_EQ(2, partition("hello", 3));
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ(0, partition("bye", 3));
+    EXPECT_EQ(2, calls);
+
+    // Changing the partition count invalidates the cached partitions
+    EXPECT_EQ(1, partition("hello", 4));
+    EXPECT_EQ(3, calls);
+
+    // So does setting a new callback
+    config.set_partitioner_callback([&](const Topic&, const Buffer&, int32_t) {
+        calls++;
+        return 0;
+    });
+    EXPECT_EQ(0, partition("hello", 4));
+    EXPECT_EQ(4, calls);
+
+    config.set_partitioner_cache_size(0);
+    EXPECT_EQ(0, config.get_partitioner_cache_size());
+    partition("hello", 4);
+    EXPECT_EQ(5, calls);
+}
@@ -1,29 +1,44 @@
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <thread>
 #include <set>
 #include <mutex>
 #include <chrono>
 #include <condition_variable>
+#include <stdexcept>
 #include <gtest/gtest.h>
 #include "cppkafka/consumer.h"
 #include "cppkafka/producer.h"
 #include "cppkafka/utils/consumer_dispatcher.h"
 #include "cppkafka/utils/buffered_producer.h"
+#include "cppkafka/utils/priority_poller.h"
+#include "cppkafka/utils/fair_poller.h"
+#include "cppkafka/utils/memory_governor.h"
+#include "cppkafka/utils/poll_watchdog.h"
+#include "cppkafka/utils/topic_router.h"
+#include "cppkafka/utils/topic_mirror.h"
+#include "cppkafka/utils/partition_scanner.h"
+#include "cppkafka/utils/offset_fetcher.h"
 #include "test_utils.h"
 
 using std::vector;
+using std::map;
 using std::move;
 using std::string;
 using std::thread;
 using std::set;
 using std::mutex;
 using std::tie;
+using std::find;
 using std::condition_variable;
 using std::lock_guard;
 using std::unique_lock;
 using std::chrono::seconds;
 using std::chrono::milliseconds;
 using std::chrono::system_clock;
+using std::chrono::steady_clock;
+using std::this_thread::sleep_for;
 
 using namespace cppkafka;
 
@@ -135,6 +150,59 @@ TEST_F(ConsumerTest, Rebalance) {
     EXPECT_EQ(1, runner1.get_messages().size() + runner2.get_messages().size());
 }
 
+#if RD_KAFKA_VERSION >= 0x010600ff
+
+TEST_F(ConsumerTest, CooperativeRebalance) {
+    set<int> assigned1;
+    vector<TopicPartition> revoked1;
+    vector<TopicPartition> assignment2;
+    int partition = 0;
+
+    Configuration config = make_consumer_config("cooperative_consumer_test");
+    config.set("partition.assignment.strategy", "cooperative-sticky");
+
+    // Create a consumer and subscribe to the topic
+    Consumer consumer1(config);
+    consumer1.set_assignment_callback([&](const vector<TopicPartition>& topic_partitions) {
+        for (const auto& topic_partition : topic_partitions) {
+            assigned1.insert(topic_partition.get_partition());
+        }
+    });
+    consumer1.set_revocation_callback([&](const vector<TopicPartition>& topic_partitions) {
+        revoked1.insert(revoked1.end(), topic_partitions.begin(), topic_partitions.end());
+    });
+    consumer1.subscribe({ KAFKA_TOPIC });
+    ConsumerRunner runner1(consumer1, 1, 3);
+    EXPECT_EQ("COOPERATIVE", consumer1.get_rebalance_protocol());
+
+    // Create a second consumer and subscribe to the topic
+    Consumer consumer2(config);
+    consumer2.set_assignment_callback([&](const vector<TopicPartition>& topic_partitions) {
+        assignment2 = topic_partitions;
+    });
+    consumer2.subscribe({ KAFKA_TOPIC });
+    ConsumerRunner runner2(consumer2, 1, 1);
+
+    // Produce a message just so we stop the consumer
+    Producer producer(make_producer_config());
+    string payload = "Hello world!";
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    runner1.try_join();
+    runner2.try_join();
+
+    // Only the partitions that moved to the second consumer were revoked from the first one
+    EXPECT_EQ(3, assigned1.size());
+    EXPECT_FALSE(revoked1.empty());
+    EXPECT_EQ(revoked1.size(), assignment2.size());
+    EXPECT_EQ(3 - revoked1.size(), consumer1.get_assignment().size());
+    for (const auto& topic_partition : revoked1) {
+        EXPECT_TRUE(find(assignment2.begin(), assignment2.end(), topic_partition) !=
+                    assignment2.end());
+    }
+}
+
+#endif // RD_KAFKA_VERSION >= 0x010600ff
+
 TEST_F(ConsumerTest, OffsetCommit) {
     int partition = 0;
     int64_t message_offset = 0;
@@ -171,6 +239,266 @@ TEST_F(ConsumerTest, OffsetCommit) {
     EXPECT_TRUE(offset_commit_called);
 }
 
+TEST_F(ConsumerTest, TopicMirror) {
+    const string destination_topic = "cppkafka_test2";
+    int partition = 0;
+    int64_t low;
+    int64_t high;
+
+    // Read whatever gets mirrored into the destination topic
+    Consumer destination_consumer(make_consumer_config("topic_mirror_destination"));
+    tie(low, high) = destination_consumer.query_offsets({ destination_topic, partition });
+    destination_consumer.assign({ { destination_topic, partition, high } });
+    ConsumerRunner runner(destination_consumer, 3, 1);
+
+    Consumer source_consumer(make_consumer_config("topic_mirror"));
+    tie(low, high) = source_consumer.query_offsets({ KAFKA_TOPIC, partition });
+    source_consumer.assign({ { KAFKA_TOPIC, partition, high } });
+    const int64_t initial_committed =
+        source_consumer.get_offsets_committed({ { KAFKA_TOPIC, partition } })[0].get_offset();
+
+    Producer producer(make_producer_config());
+    const vector<string> keys = { "key1", "key2", "key3" };
+    const vector<string> payloads = { "payload1", "payload2", "payload3" };
+    for (size_t i = 0; i < keys.size(); ++i) {
+        producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).key(keys[i])
+                                                   .payload(payloads[i]));
+    }
+    producer.flush();
+
+    TopicMirror mirror(source_consumer, make_producer_config());
+    EXPECT_EQ(Producer::PayloadPolicy::PASSTHROUGH_PAYLOAD,
+              mirror.get_producer().get_payload_policy());
+    mirror.set_topic_mapper([&](const Message&) {
+        return destination_topic;
+    });
+    mirror.set_preserve_partitions(true);
+
+    int64_t last_offset = -1;
+    size_t mirrored = 0;
+    const auto deadline = system_clock::now() + seconds(20);
+    while (mirrored < keys.size() && system_clock::now() < deadline) {
+        Message msg = source_consumer.poll();
+        if (msg && !msg.get_error()) {
+            last_offset = msg.get_offset();
+            mirror.mirror(move(msg));
+            mirrored++;
+        }
+    }
+    ASSERT_EQ(keys.size(), mirrored);
+
+    // Delivery reports are only served when polling, so nothing can be committed yet
+    EXPECT_EQ(keys.size(), mirror.get_pending_count());
+    mirror.commit();
+    EXPECT_EQ(initial_committed,
+              source_consumer.get_offsets_committed({ { KAFKA_TOPIC, partition } })[0]
+                             .get_offset());
+
+    mirror.flush();
+    EXPECT_EQ(0, mirror.get_pending_count());
+    // Commits are asynchronous, so wait until the broker has the new offset
+    int64_t committed = TopicPartition::OFFSET_INVALID;
+    while (committed != last_offset + 1 && system_clock::now() < deadline) {
+        source_consumer.poll(milliseconds(100));
+        committed = source_consumer.get_offsets_committed({ { KAFKA_TOPIC, partition } })[0]
+                                   .get_offset();
+    }
+    EXPECT_EQ(last_offset + 1, committed);
+
+    runner.try_join();
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(keys.size(), messages.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        EXPECT_EQ(destination_topic, messages[i].get_topic());
+        EXPECT_EQ(partition, messages[i].get_partition());
+        EXPECT_EQ(Buffer(keys[i]), messages[i].get_key());
+        EXPECT_EQ(Buffer(payloads[i]), messages[i].get_payload());
+    }
+}
+
+TEST_F(ConsumerTest, TopicMirrorProduceFailure) {
+    int partition = 0;
+    int64_t low;
+    int64_t high;
+    Consumer consumer(make_consumer_config("topic_mirror_failure"));
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+    consumer.assign({ { KAFKA_TOPIC, partition, high } });
+
+    Producer producer(make_producer_config());
+    const string payload(2000, 'x');
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    producer.flush();
+
+    Message msg;
+    const auto deadline = system_clock::now() + seconds(20);
+    while (!(msg && !msg.get_error()) && system_clock::now() < deadline) {
+        msg = consumer.poll();
+    }
+    ASSERT_TRUE(msg && !msg.get_error());
+
+    // The mirror's producer rejects this message right away as it's too large
+    Configuration config = make_producer_config();
+    config.set("message.max.bytes", 1000);
+    TopicMirror mirror(consumer, move(config));
+    mirror.set_topic_mapper([](const Message&) {
+        return string("cppkafka_test2");
+    });
+    EXPECT_THROW(mirror.mirror(move(msg)), HandleException);
+    // It isn't left pending, so flushing doesn't wait for it forever
+    EXPECT_EQ(0, mirror.get_pending_count());
+    mirror.flush();
+}
+
+TEST_F(ConsumerTest, PartitionScanner) {
+    int partition = 0;
+    Consumer consumer(make_consumer_config("partition_scanner"));
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+
+    Producer producer(make_producer_config());
+    const vector<string> payloads = { "scan0", "scan1", "scan2", "scan3", "scan4" };
+    for (const string& payload : payloads) {
+        producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    }
+    producer.flush();
+
+    // Read [high + 1, high + 4), leaving the first and last messages out
+    PartitionScanner scanner(consumer);
+    scanner.add_range({ KAFKA_TOPIC, partition, high + 1 }, high + 4);
+    EXPECT_EQ(1, scanner.get_pending_ranges());
+    vector<int64_t> offsets;
+    vector<string> scanned_payloads;
+    scanner.scan([&](Message msg) {
+        offsets.push_back(msg.get_offset());
+        scanned_payloads.push_back(msg.get_payload());
+    });
+
+    EXPECT_EQ(vector<int64_t>({ high + 1, high + 2, high + 3 }), offsets);
+    EXPECT_EQ(vector<string>({ "scan1", "scan2", "scan3" }), scanned_payloads);
+    EXPECT_EQ(0, scanner.get_pending_ranges());
+    EXPECT_TRUE(consumer.get_assignment().empty());
+}
+
+TEST_F(ConsumerTest, PartitionScannerResetsOnError) {
+    int partition = 0;
+    Consumer consumer(make_consumer_config("partition_scanner"));
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+
+    Producer producer(make_producer_config());
+    const string payload = "Hello world!";
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    producer.flush();
+
+    PartitionScanner scanner(consumer);
+    scanner.add_range({ KAFKA_TOPIC, partition, high }, high + 2);
+    EXPECT_THROW(scanner.scan([](Message) { throw std::runtime_error("failed"); }),
+                 std::runtime_error);
+    // Nothing from the failed scan is left behind
+    EXPECT_EQ(0, scanner.get_pending_ranges());
+    EXPECT_TRUE(consumer.get_assignment().empty());
+
+    // The same range can be added and scanned again
+    scanner.add_range({ KAFKA_TOPIC, partition, high }, high + 2);
+    size_t count = 0;
+    scanner.scan([&](Message) {
+        count++;
+    });
+    EXPECT_EQ(2, count);
+}
+
+TEST_F(ConsumerTest, Seek) {
+    int partition = 0;
+    Consumer consumer(make_consumer_config("seek"));
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+    consumer.assign({ { KAFKA_TOPIC, partition, high } });
+
+    Producer producer(make_producer_config());
+    const vector<string> payloads = { "seek0", "seek1", "seek2" };
+    for (const string& payload : payloads) {
+        producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    }
+    producer.flush();
+
+    auto poll_offsets = [&](size_t count) {
+        vector<int64_t> offsets;
+        const auto deadline = system_clock::now() + seconds(20);
+        while (offsets.size() < count && system_clock::now() < deadline) {
+            Message msg = consumer.poll();
+            if (msg && !msg.get_error()) {
+                offsets.push_back(msg.get_offset());
+            }
+        }
+        return offsets;
+    };
+    EXPECT_EQ(vector<int64_t>({ high, high + 1, high + 2 }), poll_offsets(3));
+
+    // Go back to the second message and read the rest again
+    consumer.seek({ KAFKA_TOPIC, partition, high + 1 });
+    EXPECT_EQ(vector<int64_t>({ high + 1, high + 2 }), poll_offsets(2));
+
+    // Seeking a partition that isn't assigned fails
+    EXPECT_THROW(consumer.seek({ KAFKA_TOPIC, 1, 0 }), HandleException);
+}
+
+TEST_F(ConsumerTest, OffsetFetcher) {
+    int partition = 0;
+    Producer producer(make_producer_config());
+    int64_t low;
+    int64_t high;
+    tie(low, high) = producer.query_offsets({ KAFKA_TOPIC, partition });
+    const vector<string> payloads = { "fetch0", "fetch1", "fetch2", "fetch3" };
+    for (const string& payload : payloads) {
+        producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    }
+    producer.flush();
+
+    OffsetFetcher fetcher(make_consumer_config("offset_fetcher"));
+    fetcher.set_fetch_timeout(seconds(2));
+
+    // A single offset
+    const Message& msg = fetcher.fetch({ KAFKA_TOPIC, partition, high + 2 });
+    ASSERT_TRUE(msg);
+    EXPECT_EQ(high + 2, msg.get_offset());
+    EXPECT_EQ(Buffer(payloads[2]), msg.get_payload());
+
+    // Several offsets, in any order
+    map<int64_t, string> fetched;
+    fetcher.fetch({ { KAFKA_TOPIC, partition, high + 3 }, { KAFKA_TOPIC, partition, high } },
+                  [&](const Message& msg) {
+        fetched[msg.get_offset()] = msg.get_payload();
+    });
+    EXPECT_EQ((map<int64_t, string>{ { high, payloads[0] }, { high + 3, payloads[3] } }),
+              fetched);
+
+    // Offsets past the end of the partition can't be found and aren't waited for
+    fetcher.clear_cache();
+    const auto start = steady_clock::now();
+    EXPECT_FALSE(fetcher.fetch({ KAFKA_TOPIC, partition, high + 100 }));
+    fetched.clear();
+    fetcher.fetch({ { KAFKA_TOPIC, partition, high + 100 } }, [&](const Message& msg) {
+        fetched[msg.get_offset()] = msg.get_payload();
+    });
+    EXPECT_TRUE(fetched.empty());
+    EXPECT_LT(steady_clock::now() - start, seconds(2));
+
+    // Neither can offsets below the low watermark
+    tie(low, high) = producer.query_offsets({ KAFKA_TOPIC, partition });
+    if (low > 0) {
+        fetcher.clear_cache();
+        EXPECT_FALSE(fetcher.fetch({ KAFKA_TOPIC, partition, low - 1 }));
+    }
+    // The first available offset is still there
+    const Message& first = fetcher.fetch({ KAFKA_TOPIC, partition, low });
+    ASSERT_TRUE(first);
+    EXPECT_EQ(low, first.get_offset());
+}
+
 TEST_F(ConsumerTest, Throttle) {
     int partition = 0;
 
@@ -210,3 +538,343 @@ TEST_F(ConsumerTest, Throttle) {
 
     EXPECT_EQ(3, callback_executed_count);
 }
+
+TEST_F(ConsumerTest, DeadLetterQueue) {
+    const string dead_letter_topic = "cppkafka_test2";
+    int partition = 0;
+    int64_t low;
+    int64_t high;
+
+    // Dead lettered messages aren't given a partition, so read all of them
+    Consumer dead_letter_consumer(make_consumer_config("dead_letter_queue_reader"));
+    const TopicMetadata metadata =
+        dead_letter_consumer.get_metadata(dead_letter_consumer.get_topic(dead_letter_topic));
+    TopicPartitionList dead_letter_partitions;
+    for (const PartitionMetadata& partition_metadata : metadata.get_partitions()) {
+        const TopicPartition topic_partition(dead_letter_topic, partition_metadata.get_id());
+        tie(low, high) = dead_letter_consumer.query_offsets(topic_partition);
+        dead_letter_partitions.emplace_back(dead_letter_topic, partition_metadata.get_id(), high);
+    }
+    dead_letter_consumer.assign(dead_letter_partitions);
+    ConsumerRunner runner(dead_letter_consumer, 1, dead_letter_partitions.size());
+
+    Consumer consumer(make_consumer_config("dead_letter_queue"));
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+    consumer.assign({ { KAFKA_TOPIC, partition, high } });
+
+    // Delivery reports of dead lettered messages are checked
+    Configuration producer_config = make_producer_config();
+    producer_config.set_delivery_report_callback([](Producer&, const Message&) { });
+    Producer producer(move(producer_config));
+    const string poison_key = "poison key";
+    const string poison_payload = "poison";
+    const string payload = "Hello world!";
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).key(poison_key)
+                                               .payload(poison_payload));
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    producer.flush();
+
+    size_t poison_attempts = 0;
+    int64_t poison_offset = -1;
+    vector<string> dead_letter_errors;
+    ConsumerDispatcher dispatcher(consumer);
+    dispatcher.set_dead_letter_queue(producer, dead_letter_topic, 3);
+    dispatcher.set_dead_letter_callback([&](const Message& msg, const string& error) {
+        EXPECT_EQ(Buffer(poison_payload), msg.get_payload());
+        dead_letter_errors.push_back(error);
+    });
+    dispatcher.run(
+        [&](Message msg) {
+            if (msg.get_payload() == Buffer(poison_payload)) {
+                poison_attempts++;
+                poison_offset = msg.get_offset();
+                throw std::runtime_error("can't handle this");
+            }
+            // The message after the poison one is consumed once it's dead lettered
+            dispatcher.stop();
+        }
+    );
+
+    EXPECT_EQ(3, poison_attempts);
+    EXPECT_EQ(1, dispatcher.get_dead_letter_count());
+    ASSERT_EQ(1, dead_letter_errors.size());
+    EXPECT_EQ("can't handle this", dead_letter_errors[0]);
+
+    // The record must have actually been written to the dead letter topic
+    runner.try_join();
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(1, messages.size());
+    const Message& dead_letter = messages[0];
+    EXPECT_EQ(dead_letter_topic, dead_letter.get_topic());
+    EXPECT_EQ(Buffer(poison_key), dead_letter.get_key());
+    EXPECT_EQ(Buffer(poison_payload), dead_letter.get_payload());
+#if RD_KAFKA_VERSION >= 0x000b04ff
+    EXPECT_EQ("can't handle this",
+              string(dead_letter.get_header(ConsumerDispatcher::DEAD_LETTER_ERROR_HEADER)));
+    EXPECT_EQ(KAFKA_TOPIC,
+              string(dead_letter.get_header(ConsumerDispatcher::DEAD_LETTER_TOPIC_HEADER)));
+    EXPECT_EQ(std::to_string(partition),
+              string(dead_letter.get_header(ConsumerDispatcher::DEAD_LETTER_PARTITION_HEADER)));
+    EXPECT_EQ(std::to_string(poison_offset),
+              string(dead_letter.get_header(ConsumerDispatcher::DEAD_LETTER_OFFSET_HEADER)));
+    EXPECT_EQ("3",
+              string(dead_letter.get_header(ConsumerDispatcher::DEAD_LETTER_ATTEMPTS_HEADER)));
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+}
+
+TEST_F(ConsumerTest, DeadLetterQueueRevocationCallback) {
+    int partition = 0;
+    Consumer consumer(make_consumer_config("dead_letter_queue_revocation"));
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+    // Delivery reports of dead lettered messages are checked
+    Configuration producer_config = make_producer_config();
+    producer_config.set_delivery_report_callback([](Producer&, const Message&) { });
+    Producer producer(move(producer_config));
+    const string poison_payload = "poison";
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(poison_payload));
+    producer.flush();
+
+    // Start right at the message we just produced
+    consumer.set_assignment_callback([&](TopicPartitionList& topic_partitions) {
+        for (TopicPartition& topic_partition : topic_partitions) {
+            if (topic_partition.get_partition() == partition) {
+                topic_partition.set_offset(high);
+            }
+        }
+    });
+    size_t revocations = 0;
+    consumer.set_revocation_callback([&](const TopicPartitionList&) {
+        revocations++;
+    });
+    consumer.subscribe({ KAFKA_TOPIC });
+
+    // Fail on the message and then give the partitions up
+    size_t attempts = 0;
+    bool unsubscribed = false;
+    ConsumerDispatcher dispatcher(consumer);
+    dispatcher.set_dead_letter_queue(producer, "cppkafka_test2", 3);
+    const auto deadline = system_clock::now() + seconds(20);
+    dispatcher.run(
+        [&](Message msg) {
+            if (msg.get_payload() == Buffer(poison_payload)) {
+                attempts++;
+                throw std::runtime_error("can't handle this");
+            }
+        },
+        [&](ConsumerDispatcher::Event) {
+            if (attempts > 0 && !unsubscribed) {
+                consumer.unsubscribe();
+                unsubscribed = true;
+            }
+            if (revocations > 0 || system_clock::now() >= deadline) {
+                dispatcher.stop();
+            }
+        }
+    );
+    // The dispatcher chains its own revocation callback in front of ours while running
+    EXPECT_EQ(1, revocations);
+    EXPECT_GE(attempts, 1);
+    EXPECT_EQ(0, dispatcher.get_dead_letter_count());
+
+    // And restores ours once it's done
+    consumer.get_revocation_callback()({});
+    EXPECT_EQ(2, revocations);
+}
+
+TEST_F(ConsumerTest, TopicRouter) {
+    const string other_topic = "cppkafka_test2";
+    int partition = 0;
+    Consumer consumer(make_consumer_config("topic_router"));
+    TopicPartitionList topic_partitions;
+    for (const string& topic : { KAFKA_TOPIC, other_topic }) {
+        int64_t low;
+        int64_t high;
+        tie(low, high) = consumer.query_offsets({ topic, partition });
+        topic_partitions.emplace_back(topic, partition, high);
+    }
+    consumer.assign(topic_partitions);
+
+    Producer producer(make_producer_config());
+    const string payload = "Hello world!";
+    const string other_payload = "Hello other world!";
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(partition).payload(payload));
+    producer.produce(MessageBuilder(other_topic).partition(partition).payload(other_payload));
+    producer.flush();
+
+    vector<string> routed;
+    vector<string> defaulted;
+    ConsumerDispatcher dispatcher(consumer);
+    auto stop_when_done = [&] {
+        if (routed.size() + defaulted.size() == 2) {
+            dispatcher.stop();
+        }
+    };
+    TopicRouter router(consumer);
+    router.add_route(KAFKA_TOPIC, [&](Message msg) {
+        routed.push_back(msg.get_payload());
+        stop_when_done();
+    });
+    router.set_default_route([&](Message msg) {
+        defaulted.push_back(msg.get_payload());
+        stop_when_done();
+    });
+    EXPECT_EQ(1, router.get_route_count());
+    dispatcher.run(router);
+
+    EXPECT_EQ(vector<string>{ payload }, routed);
+    EXPECT_EQ(vector<string>{ other_payload }, defaulted);
+}
+
+TEST_F(ConsumerTest, PriorityPoller) {
+    // Start reading both partitions from their current end
+    Consumer consumer(make_consumer_config("priority_poller"));
+    TopicPartitionList topic_partitions;
+    for (int partition : { 0, 1 }) {
+        int64_t low;
+        int64_t high;
+        tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+        topic_partitions.emplace_back(KAFKA_TOPIC, partition, high);
+    }
+    consumer.assign(topic_partitions);
+
+    PriorityPoller poller(consumer);
+    poller.add_partition({ KAFKA_TOPIC, 1 }, 10);
+
+    // Produce a backlog on the low priority partition before the high priority message
+    BufferedProducer<string> producer(make_producer_config());
+    string payload = "Hello world!";
+    for (size_t i = 0; i < 3; ++i) {
+        producer.add_message(MessageBuilder(KAFKA_TOPIC).partition(0).payload(payload));
+    }
+    producer.flush();
+    producer.produce(MessageBuilder(KAFKA_TOPIC).partition(1).payload(payload));
+    producer.flush();
+    // Give the consumer time to fetch everything
+    sleep_for(seconds(2));
+
+    vector<int> partitions;
+    BasicConsumerDispatcher<PriorityPoller> dispatcher(poller);
+    dispatcher.run(
+        [&](Message msg) {
+            partitions.push_back(msg.get_partition());
+            if (partitions.size() == 4) {
+                dispatcher.stop();
+            }
+        }
+    );
+    EXPECT_EQ(vector<int>({ 1, 0, 0, 0 }), partitions);
+}
+
+TEST_F(ConsumerTest, FairPoller) {
+    // Start reading both partitions from their current end
+    Consumer consumer(make_consumer_config("fair_poller"));
+    TopicPartitionList topic_partitions;
+    for (int partition : { 0, 1 }) {
+        int64_t low;
+        int64_t high;
+        tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, partition });
+        topic_partitions.emplace_back(KAFKA_TOPIC, partition, high);
+    }
+    consumer.assign(topic_partitions);
+    FairPoller poller(consumer);
+
+    // Partition 0 has a much larger backlog than partition 1
+    BufferedProducer<string> producer(make_producer_config());
+    string payload = "Hello world!";
+    for (size_t i = 0; i < 10; ++i) {
+        producer.add_message(MessageBuilder(KAFKA_TOPIC).partition(0).payload(payload));
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        producer.add_message(MessageBuilder(KAFKA_TOPIC).partition(1).payload(payload));
+    }
+    producer.flush();
+    // Give the consumer time to fetch everything
+    sleep_for(seconds(2));
+
+    size_t consumed = 0;
+    while (consumed < 4) {
+        Message msg = poller.poll();
+        if (msg && !msg.get_error()) {
+            consumed++;
+        }
+    }
+    // Both partitions got the same share
+    EXPECT_EQ(2, poller.get_service_count({ KAFKA_TOPIC, 0 }).messages);
+    EXPECT_EQ(2, poller.get_service_count({ KAFKA_TOPIC, 1 }).messages);
+    EXPECT_EQ(2 * payload.size(), poller.get_service_count({ KAFKA_TOPIC, 1 }).bytes);
+}
+
+TEST_F(ConsumerTest, MemoryGovernor) {
+    Consumer consumer(make_consumer_config("memory_governor"));
+    int64_t low;
+    int64_t high;
+    tie(low, high) = consumer.query_offsets({ KAFKA_TOPIC, 0 });
+    consumer.assign({ { KAFKA_TOPIC, 0, high } });
+
+    string payload = "Hello world!";
+    // Allow holding 3 messages at a time
+    MemoryGovernor governor(consumer, 3 * payload.size());
+    BufferedProducer<string> producer(make_producer_config());
+    for (size_t i = 0; i < 5; ++i) {
+        producer.add_message(MessageBuilder(KAFKA_TOPIC).partition(0).payload(payload));
+    }
+    producer.flush();
+
+    vector<Message> messages;
+    while (!governor.is_paused()) {
+        Message msg = governor.poll();
+        if (msg && !msg.get_error()) {
+            messages.push_back(move(msg));
+        }
+    }
+    EXPECT_EQ(4, messages.size());
+    EXPECT_EQ(4 * payload.size(), governor.get_usage());
+    EXPECT_EQ(4 * payload.size(), MemoryGovernor::get_global_usage());
+
+    // Moving messages around doesn't release anything, destroying them does
+    Message moved = move(messages.back());
+    messages.pop_back();
+    EXPECT_EQ(4 * payload.size(), governor.get_usage());
+    messages.clear();
+    EXPECT_EQ(payload.size(), governor.get_usage());
+    EXPECT_TRUE(governor.is_paused());
+
+    governor.poll(milliseconds(10));
+    EXPECT_FALSE(governor.is_paused());
+    moved = Message();
+    EXPECT_EQ(0, governor.get_usage());
+}
+
+TEST_F(ConsumerTest, PollWatchdog) {
+    Configuration config = make_consumer_config("poll_watchdog");
+    config.set("session.timeout.ms", 6000);
+    config.set("max.poll.interval.ms", 6000);
+    Consumer consumer(config);
+    consumer.assign({ { KAFKA_TOPIC, 0, TopicPartition::OFFSET_END } });
+
+    PollWatchdog watchdog(consumer);
+    EXPECT_EQ(milliseconds(6000), watchdog.get_poll_interval_limit());
+    // Consider polls late after 300ms
+    watchdog.set_warning_ratio(0.05);
+    size_t warnings = 0;
+    watchdog.set_poll_interval_callback([&](milliseconds elapsed, milliseconds limit) {
+        EXPECT_GE(elapsed.count(), 300);
+        EXPECT_EQ(6000, limit.count());
+        warnings++;
+    });
+
+    watchdog.poll(milliseconds(10));
+    watchdog.start_monitor(milliseconds(50));
+    // Simulate a slow handler
+    sleep_for(milliseconds(600));
+    watchdog.stop_monitor();
+    EXPECT_EQ(1, warnings);
+    EXPECT_EQ(1, watchdog.get_late_poll_count());
+    EXPECT_GE(watchdog.get_time_since_poll().count(), 600);
+
+    watchdog.poll(milliseconds(10));
+    EXPECT_GE(watchdog.get_max_poll_interval().count(), 600);
+    EXPECT_FALSE(watchdog.get_progress({ KAFKA_TOPIC, 0 }).stalled);
+}
@@ -0,0 +1,100 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/dictionary_codec.h"
+#include "cppkafka/utils/dictionary_trainer.h"
+#include "cppkafka/exceptions.h"
+
+using std::string;
+using std::vector;
+using std::to_string;
+
+using namespace cppkafka;
+
+class DictionaryCodecTest : public testing::Test {
+public:
+    static vector<uint8_t> make_dictionary() {
+        DictionaryTrainer trainer;
+        for (size_t i = 0; i < 2000; ++i) {
+            const string payload = make_payload(i);
+            trainer.add_sample(payload);
+        }
+        return trainer.train(4096);
+    }
+
+    static string make_payload(size_t index) {
+        return "{\"event\":\"page_view\",\"user_id\":" + to_string(index * 7919 % 100000) +
+               ",\"country\":\"" + (index % 3 == 0 ? "AR" : "US") +
+               "\",\"timestamp\":" + to_string(1500000000 + index) + "}";
+    }
+};
+
+TEST_F(DictionaryCodecTest, RoundTripWithDictionary) {
+    const vector<uint8_t> dictionary = make_dictionary();
+    DictionaryCodec producer_codec;
+    const uint32_t id = producer_codec.add_dictionary(dictionary);
+    producer_codec.set_compression_dictionary(id);
+
+    // The consumer side fetches the dictionary when it first sees it
+    size_t loads = 0;
+    DictionaryCodec consumer_codec;
+    consumer_codec.set_dictionary_loader([&](uint32_t requested_id) {
+        loads++;
+        return requested_id == id ? dictionary : vector<uint8_t>();
+    });
+
+    DictionaryCodec plain_codec;
+    for (size_t i = 5000; i < 5010; ++i) {
+        const string payload = make_payload(i);
+        const Buffer compressed = producer_codec.compress(payload);
+        EXPECT_LT(compressed.get_size(), plain_codec.compress(payload).get_size());
+        EXPECT_EQ(payload, static_cast<string>(consumer_codec.decompress(compressed)));
+    }
+    EXPECT_EQ(1, loads);
+    EXPECT_TRUE(consumer_codec.has_dictionary(id));
+}
+
+TEST_F(DictionaryCodecTest, RoundTripWithoutDictionary) {
+    DictionaryCodec codec;
+    const string payload = make_payload(42);
+    const string compressed = codec.compress(payload);
+    EXPECT_EQ(payload, static_cast<string>(codec.decompress(compressed)));
+}
+
+TEST_F(DictionaryCodecTest, UnknownDictionary) {
+    const vector<uint8_t> dictionary = make_dictionary();
+    const string payload = make_payload(1);
+    DictionaryCodec producer_codec;
+    producer_codec.set_compression_dictionary(producer_codec.add_dictionary(dictionary));
+    const string compressed = producer_codec.compress(payload);
+
+    DictionaryCodec consumer_codec;
+    EXPECT_THROW(consumer_codec.decompress(compressed), Exception);
+    const string not_compressed = "not zstd";
+    EXPECT_THROW(consumer_codec.decompress(not_compressed), Exception);
+}
+
+TEST_F(DictionaryCodecTest, LoadedDictionaryWithWrongId) {
+    const vector<uint8_t> dictionary = make_dictionary();
+    DictionaryCodec producer_codec;
+    const uint32_t id = producer_codec.add_dictionary(dictionary);
+    producer_codec.set_compression_dictionary(id);
+    const string payload = make_payload(1);
+    const string compressed = producer_codec.compress(payload);
+
+    // Same dictionary content but a different id (stored little endian right after the magic)
+    vector<uint8_t> other_dictionary = dictionary;
+    other_dictionary[4] ^= 0x01;
+    DictionaryCodec other_codec;
+    const uint32_t other_id = other_codec.add_dictionary(other_dictionary);
+    ASSERT_NE(id, other_id);
+
+    // The loaded dictionary must be rejected without being cached under its own id
+    DictionaryCodec consumer_codec;
+    consumer_codec.set_dictionary_loader([&](uint32_t) {
+        return other_dictionary;
+    });
+    EXPECT_THROW(consumer_codec.decompress(compressed), Exception);
+    EXPECT_FALSE(consumer_codec.has_dictionary(id));
+    EXPECT_FALSE(consumer_codec.has_dictionary(other_id));
+}
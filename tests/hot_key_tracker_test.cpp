@@ -0,0 +1,126 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/hot_key_tracker.h"
+#include "cppkafka/producer.h"
+
+using std::string;
+using std::vector;
+using std::to_string;
+
+using namespace cppkafka;
+
+class HotKeyTrackerTest : public testing::Test {
+public:
+    static const string TOPIC;
+};
+
+const string HotKeyTrackerTest::TOPIC = "some_topic";
+
+TEST_F(HotKeyTrackerTest, FindsHeavyHitters) {
+    HotKeyTracker tracker(8);
+    const string hot_key = "hot";
+    const string warm_key = "warm";
+    // 30% of the traffic goes to a single key, 20% to another one, the rest is spread out
+    for (size_t i = 0; i < 1000; ++i) {
+        string key;
+        if (i % 10 < 3) {
+            key = hot_key;
+        }
+        else if (i % 10 < 5) {
+            key = warm_key;
+        }
+        else {
+            key = "cold" + to_string(i);
+        }
+        tracker.record(TOPIC, 0, key, 10);
+    }
+    vector<HotKeyTracker::HeavyHitter> hitters = tracker.get_heavy_hitters({ TOPIC, 0 }, 2);
+    ASSERT_EQ(2, hitters.size());
+    EXPECT_EQ(hot_key, hitters[0].key);
+    EXPECT_EQ(warm_key, hitters[1].key);
+    // Counts are upper bounds and count - error are lower bounds
+    EXPECT_GE(hitters[0].count, 300);
+    EXPECT_LE(hitters[0].count - hitters[0].error, 300);
+    EXPECT_GE(tracker.get_key_skew({ TOPIC, 0 }), 0.3);
+
+    HotKeyTracker::PartitionStats stats = tracker.get_partition_stats({ TOPIC, 0 });
+    EXPECT_EQ(1000, stats.messages);
+    EXPECT_EQ(10000, stats.bytes);
+    EXPECT_TRUE(tracker.get_heavy_hitters({ TOPIC, 1 }, 2).empty());
+}
+
+TEST_F(HotKeyTrackerTest, PartitionSkew) {
+    HotKeyTracker tracker;
+    const string key = "key";
+    for (size_t i = 0; i < 100; ++i) {
+        tracker.record(TOPIC, 0, key, 1);
+        tracker.record(TOPIC, 1, key, 1);
+    }
+    EXPECT_DOUBLE_EQ(1.0, tracker.get_partition_skew(TOPIC));
+    for (size_t i = 0; i < 200; ++i) {
+        tracker.record(TOPIC, 2, key, 1);
+    }
+    // Partition 2 has twice as many messages as the 400 / 3 mean
+    EXPECT_DOUBLE_EQ(1.5, tracker.get_partition_skew(TOPIC));
+    // Unpartitioned messages don't count towards the skew
+    tracker.record(MessageBuilder(TOPIC).key(key));
+    EXPECT_DOUBLE_EQ(1.5, tracker.get_partition_skew(TOPIC));
+    EXPECT_EQ(1, tracker.get_partition_stats({ TOPIC, RD_KAFKA_PARTITION_UA }).messages);
+
+    tracker.reset();
+    EXPECT_EQ(0, tracker.get_partition_stats().size());
+    EXPECT_EQ(0, tracker.get_partition_skew(TOPIC));
+}
+
+TEST_F(HotKeyTrackerTest, Sampling) {
+    HotKeyTracker tracker;
+    tracker.set_sample_rate(4);
+    const string key = "key";
+    for (size_t i = 0; i < 100; ++i) {
+        tracker.record(TOPIC, 0, key, 1);
+    }
+    vector<HotKeyTracker::HeavyHitter> hitters = tracker.get_heavy_hitters({ TOPIC, 0 }, 1);
+    ASSERT_EQ(1, hitters.size());
+    EXPECT_EQ(100, hitters[0].count);
+    EXPECT_EQ(100, tracker.get_partition_stats({ TOPIC, 0 }).messages);
+    // Keyless messages are only counted
+    tracker.record(TOPIC, 0, Buffer(), 1);
+    EXPECT_EQ(101, tracker.get_partition_stats({ TOPIC, 0 }).messages);
+    EXPECT_DOUBLE_EQ(1.0, tracker.get_key_skew({ TOPIC, 0 }));
+}
+
+TEST_F(HotKeyTrackerTest, RecordMessages) {
+    // Messages living in memory, pointing to topic handles owned by the producer
+    Producer producer(Configuration{ { "metadata.broker.list", KAFKA_TEST_INSTANCE } });
+    const Topic topic = producer.get_topic(TOPIC);
+    const Topic other_topic = producer.get_topic("other_topic");
+    HotKeyTracker tracker;
+    const string key = "key";
+    const string payload = "payload";
+    for (size_t i = 0; i < 30; ++i) {
+        rd_kafka_message_t handle = rd_kafka_message_t();
+        handle.rkt = (i % 3 == 0 ? other_topic : topic).get_handle();
+        handle.partition = i % 2;
+        handle.key = (void*)key.data();
+        handle.key_len = key.size();
+        handle.payload = (void*)payload.data();
+        handle.len = payload.size();
+        tracker.record(Message::make_non_owning(&handle));
+    }
+    EXPECT_EQ(10, tracker.get_partition_stats({ TOPIC, 0 }).messages);
+    EXPECT_EQ(10, tracker.get_partition_stats({ TOPIC, 1 }).messages);
+    EXPECT_EQ(5, tracker.get_partition_stats({ "other_topic", 0 }).messages);
+    EXPECT_EQ(5, tracker.get_partition_stats({ "other_topic", 1 }).messages);
+    EXPECT_EQ(10 * (key.size() + payload.size()),
+              tracker.get_partition_stats({ TOPIC, 0 }).bytes);
+    vector<HotKeyTracker::HeavyHitter> hitters = tracker.get_heavy_hitters({ TOPIC, 1 }, 1);
+    ASSERT_EQ(1, hitters.size());
+    EXPECT_EQ(key, hitters[0].key);
+    EXPECT_EQ(10, hitters[0].count);
+
+    // Messages recorded by name end up in the same place
+    tracker.record(TOPIC, 0, key, 1);
+    EXPECT_EQ(11, tracker.get_partition_stats({ TOPIC, 0 }).messages);
+    EXPECT_EQ(4, tracker.get_partition_stats().size());
+}
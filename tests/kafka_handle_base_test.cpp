@@ -1,5 +1,6 @@
 #include <set>
 #include <unordered_set>
+#include <thread>
 #include <gtest/gtest.h>
 #include "cppkafka/consumer.h"
 #include "cppkafka/producer.h"
@@ -11,6 +12,7 @@ using std::vector;
 using std::set;
 using std::unordered_set;
 using std::string;
+using std::thread;
 
 using namespace cppkafka;
 
@@ -139,3 +141,32 @@ TEST_F(KafkaHandleBaseTest, ConsumerGroups) {
     }
     std::cout << std::endl;*/
 }
+
+TEST_F(KafkaHandleBaseTest, TopicHandlesAreCached) {
+    Producer producer(make_config());
+    Topic topic1 = producer.get_topic(KAFKA_TOPIC);
+    Topic topic2 = producer.get_topic(KAFKA_TOPIC);
+    Topic topic3 = producer.get_topic(KAFKA_TOPIC, TopicConfiguration{});
+    EXPECT_EQ(topic1.get_handle(), topic2.get_handle());
+    EXPECT_EQ(topic1.get_handle(), topic3.get_handle());
+    EXPECT_EQ(KAFKA_TOPIC, topic1.get_name());
+
+    // Concurrent lookups for different topics get one handle per topic
+    const vector<string> topic_names = { "cppkafka_cache1", "cppkafka_cache2",
+                                         "cppkafka_cache3" };
+    vector<vector<rd_kafka_topic_t*>> handles(4);
+    vector<thread> threads;
+    for (size_t i = 0; i < handles.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            for (size_t j = 0; j < 100; ++j) {
+                handles[i].push_back(producer.get_topic(topic_names[j % 3]).get_handle());
+            }
+        });
+    }
+    for (thread& th : threads) {
+        th.join();
+    }
+    for (size_t i = 1; i < handles.size(); ++i) {
+        EXPECT_EQ(handles[0], handles[i]);
+    }
+}
@@ -0,0 +1,114 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/message_tracer.h"
+#include "cppkafka/message_builder.h"
+#include "cppkafka/exceptions.h"
+
+using std::string;
+using std::vector;
+
+using std::chrono::milliseconds;
+
+using namespace cppkafka;
+
+class MessageTracerTest : public testing::Test {
+public:
+    static MessageTracer::TraceContext make_context() {
+        MessageTracer::TraceContext context{ 0x0123456789abcdefULL, milliseconds(1500000000000),
+                                             {}, milliseconds(0) };
+        context.hops.push_back({ milliseconds(1500000000010), milliseconds(1500000000015) });
+        // Clock skew can make a service receive a message before it was sent
+        context.hops.push_back({ milliseconds(1500000000013), milliseconds(1500000000100) });
+        return context;
+    }
+};
+
+TEST_F(MessageTracerTest, EncodeDecode) {
+    const MessageTracer::TraceContext context = make_context();
+    const string encoded = MessageTracer::encode(context);
+    // Version, id, origin, hop count and a couple of bytes per hop timestamp
+    EXPECT_LT(encoded.size(), 25);
+
+    const MessageTracer::TraceContext decoded = MessageTracer::decode(encoded);
+    EXPECT_EQ(context.trace_id, decoded.trace_id);
+    EXPECT_EQ(context.origin, decoded.origin);
+    ASSERT_EQ(2, decoded.hops.size());
+    for (size_t i = 0; i < decoded.hops.size(); ++i) {
+        EXPECT_EQ(context.hops[i].received, decoded.hops[i].received);
+        EXPECT_EQ(context.hops[i].sent, decoded.hops[i].sent);
+    }
+
+    const string truncated = encoded.substr(0, encoded.size() - 1);
+    EXPECT_THROW(MessageTracer::decode(truncated), Exception);
+    const string unknown_version = "\x02" + encoded.substr(1);
+    EXPECT_THROW(MessageTracer::decode(unknown_version), Exception);
+}
+
+TEST_F(MessageTracerTest, LatencyBreakdown) {
+    MessageTracer::TraceContext context = make_context();
+    context.received = milliseconds(1500000000130);
+    vector<MessageTracer::HopLatency> breakdown = MessageTracer::get_latency_breakdown(context);
+    ASSERT_EQ(3, breakdown.size());
+    EXPECT_EQ(10, breakdown[0].queueing.count());
+    EXPECT_EQ(5, breakdown[0].processing.count());
+    EXPECT_EQ(-2, breakdown[1].queueing.count());
+    EXPECT_EQ(87, breakdown[1].processing.count());
+    EXPECT_EQ(30, breakdown[2].queueing.count());
+    EXPECT_EQ(0, breakdown[2].processing.count());
+    EXPECT_EQ(130, MessageTracer::get_end_to_end_latency(context).count());
+}
+
+TEST_F(MessageTracerTest, PropagatesAcrossHops) {
+    MessageTracer tracer;
+    size_t traces = 0;
+    tracer.set_trace_callback([&](const MessageTracer::TraceContext&) {
+        traces++;
+    });
+    MessageTracer::TraceContext context = tracer.start();
+    ASSERT_TRUE(context);
+
+    ConcreteMessageBuilder<string> origin("topic");
+    tracer.inject(context, origin);
+    ASSERT_EQ(1, origin.headers().size());
+    EXPECT_EQ(MessageTracer::DEFAULT_HEADER_NAME, origin.headers()[0].first);
+
+    // A service in between receives it and produces it again
+    MessageTracer::TraceContext received = tracer.extract(origin.headers()[0].second);
+    ASSERT_TRUE(received);
+    EXPECT_EQ(context.trace_id, received.trace_id);
+    EXPECT_TRUE(received.hops.empty());
+    ConcreteMessageBuilder<string> forwarded("other_topic");
+    tracer.inject(received, forwarded);
+
+    MessageTracer::TraceContext last = tracer.extract(forwarded.headers()[0].second);
+    ASSERT_EQ(1, last.hops.size());
+    EXPECT_EQ(received.received, last.hops[0].received);
+    EXPECT_EQ(2, MessageTracer::get_latency_breakdown(last).size());
+    EXPECT_EQ(2, traces);
+}
+
+TEST_F(MessageTracerTest, Sampling) {
+    MessageTracer tracer(0.0);
+    for (size_t i = 0; i < 100; ++i) {
+        MessageTracer::TraceContext context = tracer.start();
+        EXPECT_FALSE(context);
+        ConcreteMessageBuilder<string> builder("topic");
+        tracer.inject(context, builder);
+        EXPECT_TRUE(builder.headers().empty());
+    }
+    tracer.set_sample_rate(0.5);
+    size_t sampled = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        if (tracer.start()) {
+            sampled++;
+        }
+    }
+    EXPECT_GT(sampled, 350);
+    EXPECT_LT(sampled, 650);
+
+    // Untraced or corrupt headers aren't traced
+    EXPECT_FALSE(tracer.extract(Buffer()));
+    const string garbage = "garbage";
+    EXPECT_FALSE(tracer.extract(garbage));
+}
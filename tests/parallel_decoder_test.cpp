@@ -0,0 +1,122 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <gtest/gtest.h>
+#include "cppkafka/producer.h"
+#include "cppkafka/utils/parallel_decoder.h"
+#include "test_utils.h"
+
+using std::string;
+using std::vector;
+using std::map;
+using std::move;
+using std::to_string;
+using std::runtime_error;
+using std::this_thread::sleep_for;
+
+using std::chrono::milliseconds;
+
+using namespace cppkafka;
+
+class ParallelDecoderTest : public testing::Test {
+public:
+    // Messages living in memory, so we can feed the decoder without a broker
+    struct FakeMessage {
+        FakeMessage(const Topic& topic, int partition, int64_t offset)
+        : payload(to_string(offset)) {
+            handle = rd_kafka_message_t();
+            handle.rkt = topic.get_handle();
+            handle.partition = partition;
+            handle.offset = offset;
+            handle.payload = &payload[0];
+            handle.len = payload.size();
+        }
+
+        Message get_message() {
+            return Message::make_non_owning(&handle);
+        }
+
+        string payload;
+        rd_kafka_message_t handle;
+    };
+
+    ParallelDecoderTest()
+    : producer(Configuration{ { "metadata.broker.list", KAFKA_TEST_INSTANCE } }),
+      topic(producer.get_topic("parallel_decoder_test")) {
+
+    }
+
+    // Make lower offsets take longer so they finish out of order
+    static int64_t decode(const Message& message) {
+        const int64_t offset = std::stoll(message.get_payload());
+        sleep_for(milliseconds((10 - offset % 10) * 2));
+        return offset;
+    }
+
+    Producer producer;
+    Topic topic;
+};
+
+TEST_F(ParallelDecoderTest, KeepsPartitionOrder) {
+    vector<FakeMessage> messages;
+    // Messages point to their own payloads, so they can't be moved around
+    messages.reserve(40);
+    for (int64_t offset = 0; offset < 40; ++offset) {
+        messages.emplace_back(topic, offset % 2, offset);
+    }
+
+    map<int, vector<int64_t>> values;
+    auto handler = [&](Message message, int64_t value) {
+        EXPECT_EQ(message.get_offset(), value);
+        values[message.get_partition()].push_back(value);
+    };
+    ParallelDecoder<int64_t> decoder(&ParallelDecoderTest::decode, 4);
+    EXPECT_EQ(4, decoder.get_thread_count());
+    decoder.set_maximum_pending(8);
+    for (FakeMessage& message : messages) {
+        decoder.process(message.get_message(), handler);
+        EXPECT_LT(decoder.get_pending(), 8);
+    }
+    decoder.flush(handler);
+    EXPECT_EQ(0, decoder.get_pending());
+
+    ASSERT_EQ(2, values.size());
+    for (int partition = 0; partition < 2; ++partition) {
+        const vector<int64_t>& partition_values = values[partition];
+        ASSERT_EQ(20, partition_values.size());
+        for (size_t i = 0; i < partition_values.size(); ++i) {
+            EXPECT_EQ(static_cast<int64_t>(i * 2 + partition), partition_values[i]);
+        }
+    }
+}
+
+TEST_F(ParallelDecoderTest, DecodeErrorsAreRethrownInOrder) {
+    vector<FakeMessage> messages;
+    messages.reserve(3);
+    for (int64_t offset = 0; offset < 3; ++offset) {
+        messages.emplace_back(topic, 0, offset);
+    }
+
+    vector<int64_t> values;
+    auto handler = [&](Message, int64_t value) {
+        values.push_back(value);
+    };
+    ParallelDecoder<int64_t> decoder([](const Message& message) -> int64_t {
+        if (message.get_offset() == 1) {
+            throw runtime_error("bad payload");
+        }
+        return message.get_offset();
+    }, 2);
+    for (FakeMessage& message : messages) {
+        decoder.push(message.get_message());
+    }
+    EXPECT_THROW(decoder.flush(handler), runtime_error);
+    EXPECT_EQ(vector<int64_t>{ 0 }, values);
+
+    // Processing continues after the failed message
+    decoder.flush(handler);
+    EXPECT_EQ(vector<int64_t>({ 0, 2 }), values);
+}
@@ -2,16 +2,21 @@
 #include <mutex>
 #include <chrono>
 #include <set>
+#include <vector>
 #include <condition_variable>
 #include <gtest/gtest.h>
 #include "cppkafka/producer.h"
 #include "cppkafka/consumer.h"
 #include "cppkafka/utils/buffered_producer.h"
+#include "cppkafka/utils/message_tracer.h"
+#include "cppkafka/utils/typed_producer.h"
+#include "cppkafka/utils/typed_consumer.h"
 #include "test_utils.h"
 
 using std::string;
 using std::to_string;
 using std::set;
+using std::vector;
 using std::tie;
 using std::move;
 using std::thread;
@@ -106,6 +111,68 @@ TEST_F(ProducerTest, OneMessageUsingKey) {
     EXPECT_FALSE(message.get_timestamp());
 }
 
+TEST_F(ProducerTest, TypedProducer) {
+    int partition = 0;
+
+    // Create a consumer and assign this topic/partition
+    Consumer consumer(make_consumer_config());
+    consumer.assign({ TopicPartition(KAFKA_TOPIC, partition) });
+    ConsumerRunner runner(consumer, 2, 1);
+
+    // Now create a producer and produce a couple of messages
+    Producer producer(make_producer_config());
+    TypedProducer<uint64_t, string> typed_producer(producer);
+    MessageBuilder builder(KAFKA_TOPIC);
+    builder.partition(partition);
+    typed_producer.produce(builder, 1337, "Hello world! typed");
+    typed_producer.produce(builder, 42, "Hi");
+    runner.try_join();
+
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(2, messages.size());
+    TypedMessage<uint64_t, string> message(Message::make_non_owning(messages[0].get_handle()));
+    EXPECT_FALSE(message.get_error());
+    EXPECT_EQ(1337, message.get_key());
+    EXPECT_EQ("Hello world! typed", message.get_value());
+    message = TypedMessage<uint64_t, string>(Message::make_non_owning(messages[1].get_handle()));
+    EXPECT_EQ(42, message.get_key());
+    EXPECT_EQ("Hi", message.get_value());
+}
+
+#if RD_KAFKA_VERSION >= 0x000b04ff
+
+TEST_F(ProducerTest, MessageHeaders) {
+    int partition = 0;
+
+    Consumer consumer(make_consumer_config());
+    consumer.assign({ TopicPartition(KAFKA_TOPIC, partition) });
+    ConsumerRunner runner(consumer, 1, 1);
+
+    Producer producer(make_producer_config());
+    string payload = "Hello world! 3";
+    MessageTracer tracer;
+    MessageTracer::TraceContext context = tracer.start();
+    MessageBuilder builder(KAFKA_TOPIC);
+    builder.partition(partition).payload(payload).header("some-header", "some value");
+    tracer.inject(context, builder);
+    producer.produce(builder);
+    runner.try_join();
+
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(1, messages.size());
+    const auto& message = messages[0];
+    EXPECT_EQ(Buffer(payload), message.get_payload());
+    EXPECT_EQ("some value", string(message.get_header("some-header")));
+    EXPECT_FALSE(message.get_header("missing-header"));
+
+    MessageTracer::TraceContext extracted = tracer.extract(message);
+    ASSERT_TRUE(extracted);
+    EXPECT_EQ(context.trace_id, extracted.trace_id);
+    EXPECT_GE(MessageTracer::get_end_to_end_latency(extracted).count(), 0);
+}
+
+#endif // RD_KAFKA_VERSION >= 0x000b04ff
+
 TEST_F(ProducerTest, MultipleMessagesUnassignedPartitions) {
     size_t message_count = 10;
     int partitions = 3;
@@ -182,6 +249,53 @@ TEST_F(ProducerTest, Callbacks) {
     EXPECT_TRUE(delivery_report_called);
 }
 
+TEST_F(ProducerTest, PerMessageCallbacks) {
+    int partition = 0;
+
+    // Create a consumer and assign this topic/partition
+    Consumer consumer(make_consumer_config());
+    consumer.assign({ TopicPartition(KAFKA_TOPIC, partition) });
+    ConsumerRunner runner(consumer, 2, 1);
+
+    string payload1 = "Hello world! 5";
+    string payload2 = "Hello world! 6";
+    int user_data = 42;
+    vector<string> delivered;
+    bool delivery_report_called = false;
+    Configuration config = make_producer_config();
+    config.set_delivery_report_callback([&](Producer&, const Message& msg) {
+        // The original user data is kept
+        EXPECT_EQ(&user_data, msg.get_private_data());
+        delivery_report_called = true;
+    });
+
+    Producer producer(move(config));
+    MessageBuilder builder(KAFKA_TOPIC);
+    builder.partition(partition).user_data(&user_data);
+    producer.produce(builder.payload(payload1), [&](const Message& msg) {
+        EXPECT_EQ(&user_data, msg.get_private_data());
+        delivered.push_back(msg.get_payload());
+    });
+    producer.produce(builder.payload(payload2), [&](const Message& msg) {
+        delivered.push_back(msg.get_payload());
+    });
+    producer.flush();
+    runner.try_join();
+
+    EXPECT_EQ(2, runner.get_messages().size());
+    EXPECT_EQ(vector<string>({ payload1, payload2 }), delivered);
+    EXPECT_TRUE(delivery_report_called);
+}
+
+TEST_F(ProducerTest, PerMessageCallbacksRequireDeliveryReports) {
+    // Without a delivery report callback rdkafka doesn't generate delivery reports at all
+    Producer producer(make_producer_config());
+    string payload = "Hello world! 7";
+    EXPECT_THROW(producer.produce(MessageBuilder(KAFKA_TOPIC).payload(payload),
+                                  [](const Message&) { }),
+                 Exception);
+}
+
 TEST_F(ProducerTest, PartitionerCallbackOnDefaultTopicConfig) {
     int partition = 0;
 
@@ -257,3 +371,68 @@ TEST_F(ProducerTest, BufferedProducer) {
         EXPECT_EQ(Buffer(payload), message.get_payload());
     }
 }
+
+TEST_F(ProducerTest, BufferedProducerWithBatchPartitioner) {
+    size_t message_count = 12;
+    int partitions = 3;
+
+    // Create a consumer and subscribe to this topic
+    Consumer consumer(make_consumer_config());
+    consumer.subscribe({ KAFKA_TOPIC });
+    ConsumerRunner runner(consumer, message_count, partitions);
+
+    // The topic uses the default partitioner, so messages should end up where it'd put them
+    BatchPartitioner partitioner(BatchPartitioner::Algorithm::CONSISTENT_RANDOM);
+    BufferedProducer<string> producer(make_producer_config());
+    producer.set_batch_partitioner(partitioner);
+    for (size_t i = 0; i < message_count; ++i) {
+        producer.add_message(producer.make_builder(KAFKA_TOPIC).key("key " + to_string(i))
+                                                               .payload("batch"));
+    }
+    producer.flush();
+    runner.try_join();
+
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(message_count, messages.size());
+    for (const auto& message : messages) {
+        EXPECT_FALSE(message.get_error());
+        EXPECT_EQ(partitioner.partition(message.get_key(), partitions),
+                  message.get_partition());
+    }
+}
+
+TEST_F(ProducerTest, BufferedProducerWithEnvelopes) {
+    int partition = 0;
+
+    // Create a consumer and assign this topic/partition
+    Consumer consumer(make_consumer_config());
+    consumer.assign({ TopicPartition(KAFKA_TOPIC, partition) });
+    ConsumerRunner runner(consumer, 3, 1);
+
+    // Records with different keys can't share an envelope and the last one won't fit in the
+    // first envelope, so this should produce 3 messages
+    BufferedProducer<string> producer(make_producer_config());
+    producer.set_max_envelope_size(64);
+    string key = "such key";
+    producer.add_message(producer.make_builder(KAFKA_TOPIC).partition(partition).payload("foo"));
+    producer.add_message(producer.make_builder(KAFKA_TOPIC).partition(partition).key(key)
+                                                           .payload("bar"));
+    producer.add_message(producer.make_builder(KAFKA_TOPIC).partition(partition).payload("baz"));
+    producer.add_message(producer.make_builder(KAFKA_TOPIC).partition(partition)
+                                                           .payload(string(60, 'x')));
+    producer.flush();
+    runner.try_join();
+
+    const auto& messages = runner.get_messages();
+    ASSERT_EQ(3, messages.size());
+    vector<string> unkeyed_records;
+    vector<string> keyed_records;
+    for (const auto& message : messages) {
+        vector<string>& records = message.get_key() ? keyed_records : unkeyed_records;
+        for (const Buffer& record : EnvelopeReader(message.get_payload())) {
+            records.emplace_back(record.begin(), record.end());
+        }
+    }
+    EXPECT_EQ(vector<string>({ "bar" }), keyed_records);
+    EXPECT_EQ(vector<string>({ "foo", "baz", string(60, 'x') }), unkeyed_records);
+}
@@ -0,0 +1,57 @@
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/record_envelope.h"
+#include "cppkafka/exceptions.h"
+
+using std::string;
+using std::vector;
+
+using namespace cppkafka;
+
+class RecordEnvelopeTest : public testing::Test {
+public:
+    vector<string> read_records(const Buffer& payload) {
+        vector<string> output;
+        for (const Buffer& record : EnvelopeReader(payload)) {
+            output.emplace_back(record.begin(), record.end());
+        }
+        return output;
+    }
+};
+
+TEST_F(RecordEnvelopeTest, RoundTrip) {
+    const vector<string> records = { "foo", "", string(200, 'x'), string(70000, 'y') };
+    EnvelopeBuilder builder;
+    size_t expected_size = 1;
+    for (const string& record : records) {
+        builder.add_record(record);
+        expected_size += EnvelopeBuilder::get_record_size(record.size());
+    }
+    EXPECT_EQ(records.size(), builder.get_record_count());
+    EXPECT_EQ(expected_size, builder.get_size());
+    EXPECT_TRUE(EnvelopeReader::is_envelope(builder.get_buffer()));
+    EXPECT_EQ(records, read_records(builder.get_buffer()));
+}
+
+TEST_F(RecordEnvelopeTest, RecordSize) {
+    EXPECT_EQ(1, EnvelopeBuilder::get_record_size(0));
+    EXPECT_EQ(128, EnvelopeBuilder::get_record_size(127));
+    EXPECT_EQ(130, EnvelopeBuilder::get_record_size(128));
+    EXPECT_EQ(16384 + 3, EnvelopeBuilder::get_record_size(16384));
+}
+
+TEST_F(RecordEnvelopeTest, EmptyEnvelope) {
+    const vector<uint8_t> data = { EnvelopeBuilder::ENVELOPE_MARKER };
+    EXPECT_TRUE(read_records(data).empty());
+}
+
+TEST_F(RecordEnvelopeTest, MalformedEnvelope) {
+    const string not_an_envelope = "hello";
+    EXPECT_FALSE(EnvelopeReader::is_envelope(not_an_envelope));
+    EXPECT_THROW(EnvelopeReader reader(not_an_envelope), Exception);
+
+    // The record claims to be 5 bytes long but there's only 3
+    const vector<uint8_t> truncated = { EnvelopeBuilder::ENVELOPE_MARKER, 5, 'a', 'b', 'c' };
+    EXPECT_THROW(read_records(truncated), Exception);
+}
@@ -0,0 +1,89 @@
+#include <string>
+#include <vector>
+#include <limits>
+#include <gtest/gtest.h>
+#include "cppkafka/utils/serializer.h"
+#include "cppkafka/utils/typed_consumer.h"
+
+using std::string;
+using std::vector;
+using std::numeric_limits;
+
+using namespace cppkafka;
+
+class SerializerTest : public testing::Test {
+public:
+    template <typename T>
+    T round_trip(const T& value) {
+        string output;
+        Serializer<T>::serialize(value, output);
+        return Serializer<T>::deserialize(output);
+    }
+};
+
+// Counts how many times values get decoded
+struct CountingSerializer {
+    static string deserialize(const Buffer& buffer) {
+        calls++;
+        return buffer;
+    }
+
+    static int calls;
+};
+
+int CountingSerializer::calls = 0;
+
+TEST_F(SerializerTest, Integers) {
+    EXPECT_EQ(0, round_trip<int32_t>(0));
+    EXPECT_EQ(-1, round_trip<int32_t>(-1));
+    EXPECT_EQ(numeric_limits<int64_t>::min(), round_trip(numeric_limits<int64_t>::min()));
+    EXPECT_EQ(numeric_limits<uint64_t>::max(), round_trip(numeric_limits<uint64_t>::max()));
+    EXPECT_EQ(200, round_trip<uint8_t>(200));
+    EXPECT_EQ(-300, round_trip<int16_t>(-300));
+}
+
+TEST_F(SerializerTest, IntegersAreBigEndian) {
+    string output;
+    Serializer<uint32_t>::serialize(0x01020304, output);
+    EXPECT_EQ(string("\x01\x02\x03\x04"), output);
+}
+
+TEST_F(SerializerTest, IntegerWithInvalidSize) {
+    const string input = "abc";
+    EXPECT_THROW(Serializer<uint32_t>::deserialize(input), ParseException);
+}
+
+TEST_F(SerializerTest, StringsAndBytes) {
+    EXPECT_EQ("", round_trip<string>(""));
+    EXPECT_EQ("Hello world", round_trip<string>("Hello world"));
+    const vector<uint8_t> bytes = { 0, 1, 255, 3 };
+    EXPECT_EQ(bytes, round_trip(bytes));
+}
+
+TEST_F(SerializerTest, SerializeAppends) {
+    string output = "prefix";
+    Serializer<string>::serialize("-suffix", output);
+    EXPECT_EQ("prefix-suffix", output);
+}
+
+TEST_F(SerializerTest, TypedMessageDecodesLazily) {
+    string key;
+    Serializer<uint64_t>::serialize(1337, key);
+    const string payload = "Hello world";
+    rd_kafka_message_t handle = rd_kafka_message_t();
+    handle.key = const_cast<char*>(key.data());
+    handle.key_len = key.size();
+    handle.payload = const_cast<char*>(payload.data());
+    handle.len = payload.size();
+
+    CountingSerializer::calls = 0;
+    TypedMessage<uint64_t, string, Serializer<uint64_t>, CountingSerializer> message(
+        Message::make_non_owning(&handle));
+    EXPECT_TRUE(message);
+    EXPECT_EQ(1337, message.get_key());
+    EXPECT_EQ(0, CountingSerializer::calls);
+
+    EXPECT_EQ(payload, message.get_value());
+    EXPECT_EQ(payload, message.get_value());
+    EXPECT_EQ(1, CountingSerializer::calls);
+}